@@ -47,6 +47,7 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 // The number of columns comprising a state in AES. This is a constant in AES. Value=4
 #define Nb 4
 #define BLOCKLEN 16 //Block length in bytes AES is 128b block only
+#define BATCH 8 // The number of blocks handed to the backend at once.
 
 #if defined(AES256) && (AES256 == 1)
     #define Nk 8
@@ -76,20 +77,13 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 /*****************************************************************************/
 /* Private variables:                                                        */
 /*****************************************************************************/
+// The variables are thread local, since telegrams can be decrypted in several decode threads.
 // state - array holding the intermediate results during decryption.
 typedef uint8_t state_t[4][4];
-static state_t* state;
+static thread_local state_t* state;
 
-// The array that stores the round keys.
-static uint8_t RoundKey[keyExpSize];
-
-// The Key input to the AES Program
-static const uint8_t* Key;
-
-#if defined(CBC) && CBC
-  // Initial Vector used only for CBC mode
-  static uint8_t* Iv;
-#endif
+// The round keys used by the cipher, expanded once per key into AESRoundKeys.
+static thread_local const uint8_t* RoundKey;
 
 // The lookup-tables are marked const so they can be placed in read-only storage instead of RAM
 // The numbers below can be computed dynamically trading ROM for RAM -
@@ -181,7 +175,7 @@ static uint8_t getSBoxInvert(uint8_t num)
 }
 
 // This function produces Nb(Nr+1) round keys. The round keys are used in each round to decrypt the states.
-static void KeyExpansion(void)
+static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key)
 {
   uint32_t i, k;
   uint8_t tempa[4]; // Used for the column/row operations
@@ -472,33 +466,83 @@ static void InvCipher(void)
 /*****************************************************************************/
 /* Public functions:                                                         */
 /*****************************************************************************/
-#if defined(ECB) && (ECB == 1)
 
+static void portableExpandKey(const uint8_t* key, AESRoundKeys* rk)
+{
+  // The inverse cipher walks the same round keys backwards.
+  KeyExpansion(rk->enc, key);
+  memcpy(rk->dec, rk->enc, keyExpSize);
+}
 
-void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t* output, const uint32_t length)
+static void portableEncryptBlock(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output)
 {
-  // Copy input to output, and work in-memory on output
-  memcpy(output, input, length);
+  if (output != input) memcpy(output, input, BLOCKLEN);
   state = (state_t*)output;
-
-  Key = key;
-  KeyExpansion();
-
-  // The next function call encrypts the PlainText with the Key using AES algorithm.
+  RoundKey = rk->enc;
   Cipher();
 }
 
-void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length)
+static void portableDecryptBlock(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output)
 {
-  // Copy input to output, and work in-memory on output
-  memcpy(output, input, length);
+  if (output != input) memcpy(output, input, BLOCKLEN);
   state = (state_t*)output;
+  RoundKey = rk->dec;
+  InvCipher();
+}
 
-  // The KeyExpansion routine must be called before encryption.
-  Key = key;
-  KeyExpansion();
+static void portableEncryptBlocks(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    portableEncryptBlock(rk, input+i*BLOCKLEN, output+i*BLOCKLEN);
+  }
+}
 
-  InvCipher();
+static void portableDecryptBlocks(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    portableDecryptBlock(rk, input+i*BLOCKLEN, output+i*BLOCKLEN);
+  }
+}
+
+static const AESBackend portable_backend_ = {
+  "portable",
+  portableExpandKey,
+  portableEncryptBlock,
+  portableDecryptBlock,
+  portableEncryptBlocks,
+  portableDecryptBlocks
+};
+
+const AESBackend* aesPortableBackend()
+{
+  return &portable_backend_;
+}
+
+const AESBackend* aesBackend()
+{
+  static const AESBackend* backend = aesHardwareBackend() ? aesHardwareBackend() : aesPortableBackend();
+  return backend;
+}
+
+#if defined(ECB) && (ECB == 1)
+
+
+void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t* output, const uint32_t length)
+{
+  const AESBackend* aes = aesBackend();
+  AESRoundKeys rk;
+  aes->expandKey(key, &rk);
+  aes->encryptBlock(&rk, input, output);
+}
+
+void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length)
+{
+  const AESBackend* aes = aesBackend();
+  AESRoundKeys rk;
+  aes->expandKey(key, &rk);
+  aes->decryptBlock(&rk, input, output);
 }
 
 
@@ -511,7 +555,7 @@ void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output,
 #if defined(CBC) && (CBC == 1)
 
 
-static void XorWithIv(uint8_t* buf)
+static void XorWithIv(uint8_t* buf, const uint8_t* Iv)
 {
   uint8_t i;
   for (i = 0; i < BLOCKLEN; ++i) //WAS for(i = 0; i < KEYLEN; ++i) but the block in AES is always 128bit so 16 bytes!
@@ -524,63 +568,40 @@ void AES_CBC_encrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, co
 {
   uintptr_t i;
   uint8_t extra = length % BLOCKLEN; /* Remaining bytes in the last non-full block */
+  const AESBackend* aes = aesBackend();
+  AESRoundKeys rk;
+  const uint8_t* Iv = iv;
 
-  // Skip the key expansion if key is passed as 0
-  if (0 != key)
-  {
-    Key = key;
-    KeyExpansion();
-  }
-
-  if (iv != 0)
-  {
-    Iv = (uint8_t*)iv;
-  }
+  aes->expandKey(key, &rk);
 
   for (i = 0; i < length; i += BLOCKLEN)
   {
-    XorWithIv(input);
     memcpy(output, input, BLOCKLEN);
-    state = (state_t*)output;
-    Cipher();
+    XorWithIv(output, Iv);
+    aes->encryptBlock(&rk, output, output);
     Iv = output;
     input += BLOCKLEN;
     output += BLOCKLEN;
-    //printf("Step %d - %d", i/16, i);
   }
 
   if (extra)
   {
     memcpy(output, input, extra);
-    state = (state_t*)output;
-    Cipher();
+    aes->encryptBlock(&rk, output, output);
   }
 }
 
-void AES_CBC_decrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, const uint8_t* key, const uint8_t* iv)
+void AES_CBC_decrypt(const AESRoundKeys* rk, uint8_t* output, const uint8_t* input, uint32_t length, const uint8_t* iv)
 {
   uintptr_t i;
   uint8_t extra = length % BLOCKLEN; /* Remaining bytes in the last non-full block */
-
-  // Skip the key expansion if key is passed as 0
-  if (0 != key)
-  {
-    Key = key;
-    KeyExpansion();
-  }
-
-  // If iv is passed as 0, we continue to encrypt without re-setting the Iv
-  if (iv != 0)
-  {
-    Iv = (uint8_t*)iv;
-  }
+  const AESBackend* aes = aesBackend();
+  const uint8_t* Iv = iv;
 
   for (i = 0; i < length; i += BLOCKLEN)
   {
-    memcpy(output, input, BLOCKLEN);
-    state = (state_t*)output;
-    InvCipher();
-    XorWithIv(output);
+    aes->decryptBlock(rk, input, output);
+    XorWithIv(output, Iv);
     Iv = input;
     input += BLOCKLEN;
     output += BLOCKLEN;
@@ -589,9 +610,71 @@ void AES_CBC_decrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, co
   if (extra)
   {
     memcpy(output, input, extra);
-    state = (state_t*)output;
-    InvCipher();
+    aes->decryptBlock(rk, output, output);
+  }
+}
+
+void AES_CBC_decrypt_in_place(const AESRoundKeys* rk, uint8_t* buf, uint32_t length, const uint8_t* iv)
+{
+  const AESBackend* aes = aesBackend();
+  uint8_t cipher[BATCH*BLOCKLEN];
+  uint8_t prev[BLOCKLEN];
+  uint32_t i, j;
+
+  memcpy(prev, iv, BLOCKLEN);
+  for (i = 0; i < length; i += BATCH*BLOCKLEN)
+  {
+    uint32_t n = (length-i < BATCH*BLOCKLEN) ? (length-i)/BLOCKLEN : BATCH;
+    // Keep the cipher text of the batch, each block is xored with the previous cipher block.
+    memcpy(cipher, buf+i, n*BLOCKLEN);
+    aes->decryptBlocks(rk, cipher, buf+i, n);
+    XorWithIv(buf+i, prev);
+    for (j = 1; j < n; ++j)
+    {
+      XorWithIv(buf+i+j*BLOCKLEN, cipher+(j-1)*BLOCKLEN);
+    }
+    memcpy(prev, cipher+(n-1)*BLOCKLEN, BLOCKLEN);
   }
 }
 
+void AES_CBC_decrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, const uint8_t* key, const uint8_t* iv)
+{
+  AESRoundKeys rk;
+  aesBackend()->expandKey(key, &rk);
+  AES_CBC_decrypt(&rk, output, input, length, iv);
+}
+
 #endif // #if defined(CBC) && (CBC == 1)
+
+static void IncrementCounter(uint8_t* ctr)
+{
+  int i;
+  for (i = BLOCKLEN-1; i >= 0; --i)
+  {
+    if (++ctr[i] != 0) break;
+  }
+}
+
+void AES_CTR_xcrypt(const AESRoundKeys* rk, uint8_t* iv, uint8_t* buf, uint32_t length)
+{
+  const AESBackend* aes = aesBackend();
+  uint8_t counters[BATCH*BLOCKLEN];
+  uint8_t keystream[BATCH*BLOCKLEN];
+  uint32_t i, j;
+
+  for (i = 0; i < length; i += BATCH*BLOCKLEN)
+  {
+    uint32_t len = (length-i < BATCH*BLOCKLEN) ? length-i : BATCH*BLOCKLEN;
+    uint32_t n = (len+BLOCKLEN-1)/BLOCKLEN;
+    for (j = 0; j < n; ++j)
+    {
+      memcpy(counters+j*BLOCKLEN, iv, BLOCKLEN);
+      IncrementCounter(iv);
+    }
+    aes->encryptBlocks(rk, counters, keystream, n);
+    for (j = 0; j < len; ++j)
+    {
+      buf[i+j] ^= keystream[j];
+    }
+  }
+}
@@ -3,6 +3,7 @@
 #ifndef _AES_H_
 #define _AES_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -24,6 +25,38 @@
 //#define AES192 1
 //#define AES256 1
 
+#define AES_KEY_EXP_SIZE 176
+
+// The expanded round keys of an AES-128 key. Each backend decides the
+// layout of the decryption round keys, use them with the backend that expanded them.
+struct AESRoundKeys
+{
+  alignas(16) uint8_t enc[AES_KEY_EXP_SIZE];
+  alignas(16) uint8_t dec[AES_KEY_EXP_SIZE];
+};
+
+// An AES-128 implementation. Expand a key once, then encrypt or decrypt
+// any number of 16 byte blocks with it. Input and output may be the same block.
+struct AESBackend
+{
+  const char* name;
+  void (*expandKey)(const uint8_t* key, AESRoundKeys* rk);
+  void (*encryptBlock)(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output);
+  void (*decryptBlock)(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output);
+  // Encrypt or decrypt n independent blocks (ECB). The hardware backends
+  // keep several blocks in flight at once, which is much faster than one at a time.
+  void (*encryptBlocks)(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output, size_t n);
+  void (*decryptBlocks)(const AESRoundKeys* rk, const uint8_t* input, uint8_t* output, size_t n);
+};
+
+// The byte oriented implementation below, works everywhere.
+const AESBackend* aesPortableBackend();
+// The implementation using the AES instructions of the cpu, AES-NI on x86 or
+// the crypto extension on ARMv8. NULL if not built in or not supported by this cpu.
+const AESBackend* aesHardwareBackend();
+// The hardware backend if available, otherwise the portable backend.
+const AESBackend* aesBackend();
+
 #if defined(ECB) && (ECB == 1)
 
 void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length);
@@ -36,8 +69,15 @@ void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output,
 
 void AES_CBC_encrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, const uint8_t* key, const uint8_t* iv);
 void AES_CBC_decrypt_buffer(uint8_t* output, uint8_t* input, uint32_t length, const uint8_t* key, const uint8_t* iv);
+// Decrypt with round keys already expanded by aesBackend().
+void AES_CBC_decrypt(const AESRoundKeys* rk, uint8_t* output, const uint8_t* input, uint32_t length, const uint8_t* iv);
+// Decrypt buf in place, the length must be a multiple of 16.
+void AES_CBC_decrypt_in_place(const AESRoundKeys* rk, uint8_t* buf, uint32_t length, const uint8_t* iv);
 
 #endif // #if defined(CBC) && (CBC == 1)
 
+// Encrypt or decrypt buf in place in CTR mode, the keystream is the encrypted iv,
+// incremented as a 128 bit big endian counter for each block. The iv is updated.
+void AES_CTR_xcrypt(const AESRoundKeys* rk, uint8_t* iv, uint8_t* buf, uint32_t length);
 
 #endif //_AES_H_
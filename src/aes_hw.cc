@@ -0,0 +1,323 @@
+/*
+ Copyright (C) 2021 Fredrik Öhrström
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include"aes.h"
+
+#include<stddef.h>
+
+// The AES instructions are compiled using function target attributes,
+// the rest of the binary does not require them. Whether they are used
+// is decided at runtime by asking the cpu.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include<cpuid.h>
+#include<wmmintrin.h>
+
+#define AESNI __attribute__((target("aes,sse2")))
+
+AESNI static inline __m128i aesniExpandStep(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// The round constant must be an immediate, hence the macro.
+#define EXPAND(i, rcon) enc[i] = aesniExpandStep(enc[i-1], _mm_aeskeygenassist_si128(enc[i-1], rcon))
+
+AESNI static void aesniExpandKey(const uint8_t *key, AESRoundKeys *rk)
+{
+    __m128i *enc = (__m128i*)rk->enc;
+    __m128i *dec = (__m128i*)rk->dec;
+
+    enc[0] = _mm_loadu_si128((const __m128i*)key);
+    EXPAND(1, 0x01);
+    EXPAND(2, 0x02);
+    EXPAND(3, 0x04);
+    EXPAND(4, 0x08);
+    EXPAND(5, 0x10);
+    EXPAND(6, 0x20);
+    EXPAND(7, 0x40);
+    EXPAND(8, 0x80);
+    EXPAND(9, 0x1b);
+    EXPAND(10, 0x36);
+
+    // The equivalent inverse cipher uses the round keys in reverse,
+    // with inverse mix columns applied to all but the first and last.
+    dec[0] = enc[10];
+    for (int i = 1; i < 10; ++i)
+    {
+        dec[i] = _mm_aesimc_si128(enc[10-i]);
+    }
+    dec[10] = enc[0];
+}
+
+#undef EXPAND
+
+AESNI static void aesniEncryptBlock(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output)
+{
+    const __m128i *enc = (const __m128i*)rk->enc;
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), enc[0]);
+    for (int i = 1; i < 10; ++i)
+    {
+        b = _mm_aesenc_si128(b, enc[i]);
+    }
+    b = _mm_aesenclast_si128(b, enc[10]);
+    _mm_storeu_si128((__m128i*)output, b);
+}
+
+AESNI static void aesniDecryptBlock(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output)
+{
+    const __m128i *dec = (const __m128i*)rk->dec;
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input), dec[0]);
+    for (int i = 1; i < 10; ++i)
+    {
+        b = _mm_aesdec_si128(b, dec[i]);
+    }
+    b = _mm_aesdeclast_si128(b, dec[10]);
+    _mm_storeu_si128((__m128i*)output, b);
+}
+
+// Four blocks are interleaved to hide the latency of the aes instructions.
+AESNI static void aesniEncryptBlocks(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output, size_t n)
+{
+    const __m128i *enc = (const __m128i*)rk->enc;
+    const __m128i *in = (const __m128i*)input;
+    __m128i *out = (__m128i*)output;
+    size_t i = 0;
+
+    for (; i+4 <= n; i += 4)
+    {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128(in+i+0), enc[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128(in+i+1), enc[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128(in+i+2), enc[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128(in+i+3), enc[0]);
+        for (int r = 1; r < 10; ++r)
+        {
+            b0 = _mm_aesenc_si128(b0, enc[r]);
+            b1 = _mm_aesenc_si128(b1, enc[r]);
+            b2 = _mm_aesenc_si128(b2, enc[r]);
+            b3 = _mm_aesenc_si128(b3, enc[r]);
+        }
+        _mm_storeu_si128(out+i+0, _mm_aesenclast_si128(b0, enc[10]));
+        _mm_storeu_si128(out+i+1, _mm_aesenclast_si128(b1, enc[10]));
+        _mm_storeu_si128(out+i+2, _mm_aesenclast_si128(b2, enc[10]));
+        _mm_storeu_si128(out+i+3, _mm_aesenclast_si128(b3, enc[10]));
+    }
+    for (; i < n; ++i)
+    {
+        aesniEncryptBlock(rk, input+16*i, output+16*i);
+    }
+}
+
+AESNI static void aesniDecryptBlocks(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output, size_t n)
+{
+    const __m128i *dec = (const __m128i*)rk->dec;
+    const __m128i *in = (const __m128i*)input;
+    __m128i *out = (__m128i*)output;
+    size_t i = 0;
+
+    for (; i+4 <= n; i += 4)
+    {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128(in+i+0), dec[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128(in+i+1), dec[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128(in+i+2), dec[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128(in+i+3), dec[0]);
+        for (int r = 1; r < 10; ++r)
+        {
+            b0 = _mm_aesdec_si128(b0, dec[r]);
+            b1 = _mm_aesdec_si128(b1, dec[r]);
+            b2 = _mm_aesdec_si128(b2, dec[r]);
+            b3 = _mm_aesdec_si128(b3, dec[r]);
+        }
+        _mm_storeu_si128(out+i+0, _mm_aesdeclast_si128(b0, dec[10]));
+        _mm_storeu_si128(out+i+1, _mm_aesdeclast_si128(b1, dec[10]));
+        _mm_storeu_si128(out+i+2, _mm_aesdeclast_si128(b2, dec[10]));
+        _mm_storeu_si128(out+i+3, _mm_aesdeclast_si128(b3, dec[10]));
+    }
+    for (; i < n; ++i)
+    {
+        aesniDecryptBlock(rk, input+16*i, output+16*i);
+    }
+}
+
+static const AESBackend aesni_backend_ = {
+    "aesni",
+    aesniExpandKey,
+    aesniEncryptBlock,
+    aesniDecryptBlock,
+    aesniEncryptBlocks,
+    aesniDecryptBlocks
+};
+
+static bool cpuHasAES()
+{
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+    return (c & bit_AES) && (d & bit_SSE2);
+}
+
+const AESBackend *aesHardwareBackend()
+{
+    static bool has_aes = cpuHasAES();
+    return has_aes ? &aesni_backend_ : NULL;
+}
+
+#elif defined(__aarch64__) && defined(__linux__)
+
+#include<arm_neon.h>
+#include<asm/hwcap.h>
+#include<sys/auxv.h>
+
+#define ARMV8_CRYPTO __attribute__((target("+crypto")))
+
+ARMV8_CRYPTO static void armv8ExpandKey(const uint8_t *key, AESRoundKeys *rk)
+{
+    // The key schedule is not worth accelerating, it is expanded once per key.
+    aesPortableBackend()->expandKey(key, rk);
+
+    // The equivalent inverse cipher uses the round keys in reverse,
+    // with inverse mix columns applied to all but the first and last.
+    uint8x16_t enc[11];
+    for (int i = 0; i < 11; ++i) enc[i] = vld1q_u8(rk->enc+16*i);
+    vst1q_u8(rk->dec, enc[10]);
+    for (int i = 1; i < 10; ++i)
+    {
+        vst1q_u8(rk->dec+16*i, vaesimcq_u8(enc[10-i]));
+    }
+    vst1q_u8(rk->dec+160, enc[0]);
+}
+
+// The aese/aesd instructions add the round key first, therefore the last
+// round key is added with a plain xor.
+ARMV8_CRYPTO static void armv8EncryptBlock(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output)
+{
+    uint8x16_t b = vld1q_u8(input);
+    for (int i = 0; i < 9; ++i)
+    {
+        b = vaesmcq_u8(vaeseq_u8(b, vld1q_u8(rk->enc+16*i)));
+    }
+    b = vaeseq_u8(b, vld1q_u8(rk->enc+144));
+    b = veorq_u8(b, vld1q_u8(rk->enc+160));
+    vst1q_u8(output, b);
+}
+
+ARMV8_CRYPTO static void armv8DecryptBlock(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output)
+{
+    uint8x16_t b = vld1q_u8(input);
+    for (int i = 0; i < 9; ++i)
+    {
+        b = vaesimcq_u8(vaesdq_u8(b, vld1q_u8(rk->dec+16*i)));
+    }
+    b = vaesdq_u8(b, vld1q_u8(rk->dec+144));
+    b = veorq_u8(b, vld1q_u8(rk->dec+160));
+    vst1q_u8(output, b);
+}
+
+// Four blocks are interleaved to hide the latency of the aes instructions.
+ARMV8_CRYPTO static void armv8EncryptBlocks(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output, size_t n)
+{
+    size_t i = 0;
+
+    for (; i+4 <= n; i += 4)
+    {
+        const uint8_t *in = input+16*i;
+        uint8x16_t b0 = vld1q_u8(in+0);
+        uint8x16_t b1 = vld1q_u8(in+16);
+        uint8x16_t b2 = vld1q_u8(in+32);
+        uint8x16_t b3 = vld1q_u8(in+48);
+        for (int r = 0; r < 9; ++r)
+        {
+            uint8x16_t k = vld1q_u8(rk->enc+16*r);
+            b0 = vaesmcq_u8(vaeseq_u8(b0, k));
+            b1 = vaesmcq_u8(vaeseq_u8(b1, k));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, k));
+            b3 = vaesmcq_u8(vaeseq_u8(b3, k));
+        }
+        uint8x16_t k9 = vld1q_u8(rk->enc+144);
+        uint8x16_t k10 = vld1q_u8(rk->enc+160);
+        uint8_t *out = output+16*i;
+        vst1q_u8(out+0, veorq_u8(vaeseq_u8(b0, k9), k10));
+        vst1q_u8(out+16, veorq_u8(vaeseq_u8(b1, k9), k10));
+        vst1q_u8(out+32, veorq_u8(vaeseq_u8(b2, k9), k10));
+        vst1q_u8(out+48, veorq_u8(vaeseq_u8(b3, k9), k10));
+    }
+    for (; i < n; ++i)
+    {
+        armv8EncryptBlock(rk, input+16*i, output+16*i);
+    }
+}
+
+ARMV8_CRYPTO static void armv8DecryptBlocks(const AESRoundKeys *rk, const uint8_t *input, uint8_t *output, size_t n)
+{
+    size_t i = 0;
+
+    for (; i+4 <= n; i += 4)
+    {
+        const uint8_t *in = input+16*i;
+        uint8x16_t b0 = vld1q_u8(in+0);
+        uint8x16_t b1 = vld1q_u8(in+16);
+        uint8x16_t b2 = vld1q_u8(in+32);
+        uint8x16_t b3 = vld1q_u8(in+48);
+        for (int r = 0; r < 9; ++r)
+        {
+            uint8x16_t k = vld1q_u8(rk->dec+16*r);
+            b0 = vaesimcq_u8(vaesdq_u8(b0, k));
+            b1 = vaesimcq_u8(vaesdq_u8(b1, k));
+            b2 = vaesimcq_u8(vaesdq_u8(b2, k));
+            b3 = vaesimcq_u8(vaesdq_u8(b3, k));
+        }
+        uint8x16_t k9 = vld1q_u8(rk->dec+144);
+        uint8x16_t k10 = vld1q_u8(rk->dec+160);
+        uint8_t *out = output+16*i;
+        vst1q_u8(out+0, veorq_u8(vaesdq_u8(b0, k9), k10));
+        vst1q_u8(out+16, veorq_u8(vaesdq_u8(b1, k9), k10));
+        vst1q_u8(out+32, veorq_u8(vaesdq_u8(b2, k9), k10));
+        vst1q_u8(out+48, veorq_u8(vaesdq_u8(b3, k9), k10));
+    }
+    for (; i < n; ++i)
+    {
+        armv8DecryptBlock(rk, input+16*i, output+16*i);
+    }
+}
+
+static const AESBackend armv8_backend_ = {
+    "armv8",
+    armv8ExpandKey,
+    armv8EncryptBlock,
+    armv8DecryptBlock,
+    armv8EncryptBlocks,
+    armv8DecryptBlocks
+};
+
+const AESBackend *aesHardwareBackend()
+{
+    static bool has_aes = (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+    return has_aes ? &armv8_backend_ : NULL;
+}
+
+#else
+
+const AESBackend *aesHardwareBackend()
+{
+    return NULL;
+}
+
+#endif
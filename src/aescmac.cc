@@ -26,15 +26,20 @@ uchar vec87[16] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x87
 };
 
-void generateSubkeys(uchar *key, uchar *K1, uchar *K2)
+void expandCMACKey(const uchar *key, AESCMACKey *ck)
 {
+    const AESBackend *aes = aesBackend();
+    uchar *K1 = ck->K1;
+    uchar *K2 = ck->K2;
     uchar L[16];
     uchar Z[16];
     uchar tmp[16];
 
+    aes->expandKey(key, &ck->rk);
+
     memset(Z, 0, 16);
 
-    AES_ECB_encrypt(Z, key, L, 16);
+    aes->encryptBlock(&ck->rk, Z, L);
 
     if (!(L[0] & 0x80))
     {
@@ -57,7 +62,7 @@ void generateSubkeys(uchar *key, uchar *K1, uchar *K2)
     }
 }
 
-void pad(uchar *in, uchar *out, int len)
+void pad(const uchar *in, uchar *out, int len)
 {
     for (int i = 0; i < 16; i++)
     {
@@ -76,15 +81,13 @@ void pad(uchar *in, uchar *out, int len)
     }
 }
 
-void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac)
+void AES_CMAC(const AESCMACKey *ck, const uchar *input, int len, uchar *mac)
 {
+    const AESBackend *aes = aesBackend();
     bool len_is_multiple_of_block;
     uchar X[16], Y[16];
-    uchar K1[16], K2[16];
     uchar M_last[16], padded[16];
 
-    generateSubkeys(key, K1, K2);
-
     int num_blocks = (len+15)/16;
 
     if (!num_blocks)
@@ -99,12 +102,12 @@ void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac)
 
     if (len_is_multiple_of_block)
     {
-        xorit(input+(16*(num_blocks-1)), K1, M_last, 16);
+        xorit(input+(16*(num_blocks-1)), ck->K1, M_last, 16);
     }
     else
     {
         pad(input+(16*(num_blocks-1)), padded, len%16);
-        xorit(padded, K2, M_last, 16);
+        xorit(padded, ck->K2, M_last, 16);
     }
 
     memset(X, 0, 16);
@@ -112,11 +115,18 @@ void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac)
     for (int i=0; i<num_blocks-1; i++)
     {
         xorit(X, input+(16*i), Y, 16);
-        AES_ECB_encrypt(Y, key, X, 16);
+        aes->encryptBlock(&ck->rk, Y, X);
     }
 
     xorit(X,M_last,Y, 16);
-    AES_ECB_encrypt(Y, key, X, 16);
+    aes->encryptBlock(&ck->rk, Y, X);
 
     memcpy(mac, X, 16);
 }
+
+void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac)
+{
+    AESCMACKey ck;
+    expandCMACKey(key, &ck);
+    AES_CMAC(&ck, input, len, mac);
+}
@@ -18,8 +18,20 @@
 #ifndef _AESCMAC_H_
 #define _AESCMAC_H_
 
+#include"aes.h"
+
 typedef unsigned char uchar;
 
+// An AES-128 key prepared for CMAC, the round keys and the subkeys K1 and K2.
+struct AESCMACKey
+{
+    AESRoundKeys rk;
+    uchar K1[16];
+    uchar K2[16];
+};
+
+void expandCMACKey(const uchar *key, AESCMACKey *ck);
+void AES_CMAC (const AESCMACKey *ck, const uchar *input, int length, uchar *mac);
 void AES_CMAC (uchar *key, uchar *input, int length, uchar *mac);
 
 #endif //_AESCMAC_H_
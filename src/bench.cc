@@ -0,0 +1,575 @@
+/*
+ Copyright (C) 2021 Fredrik Öhrström
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include"aes.h"
+#include"dvparser.h"
+#include"manufacturer_specificities.h"
+#include"meters.h"
+#include"meter_detection.h"
+#include"shell.h"
+#include"util.h"
+#include"wmbus.h"
+
+#include<chrono>
+#include<string.h>
+#include<sys/wait.h>
+#include<unistd.h>
+
+using namespace std;
+
+// Run with: make bench
+// Each benchmark prints the average cost of a single operation.
+
+void bench_meter_dispatch();
+void bench_id_match();
+void bench_driver_detection();
+void bench_explanations();
+void bench_find_key();
+void bench_manufacturer();
+void bench_crc();
+void bench_aes();
+void bench_diehl_lfsr();
+void bench_spawn();
+void bench_json();
+
+int main(int argc, char **argv)
+{
+    onExit([](){});
+
+    bench_meter_dispatch();
+    bench_id_match();
+    bench_driver_detection();
+    bench_explanations();
+    bench_find_key();
+    bench_manufacturer();
+    bench_crc();
+    bench_aes();
+    bench_diehl_lfsr();
+    bench_json();
+    bench_spawn();
+    return 0;
+}
+
+double nanosSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double,nano>(chrono::steady_clock::now()-start).count();
+}
+
+void bench_meter_dispatch()
+{
+    // A plain unencrypted supercom587 telegram from id 33225544.
+    vector<uchar> frame;
+    hex2bin("1844AE4C4455223368077A55000000041389E20100023B0000", &frame);
+    vector<uchar> unknown_frame;
+    hex2bin("1844AE4C9999999968077A55000000041389E20100023B0000", &unknown_frame);
+
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    const int rounds = 10000;
+
+    printf("meter dispatch (ns per telegram)\n");
+    printf("%10s %12s %12s\n", "meters", "owned", "not owned");
+
+    for (int num_meters : { 10, 100, 1000, 10000, 100000 })
+    {
+        shared_ptr<MeterManager> manager = createMeterManager(false);
+
+        // The meter with the id of the telegram is added last.
+        vector<string> shells, jsons;
+        for (int i = 0; i < num_meters; ++i)
+        {
+            string id = (i == num_meters-1) ? "33225544" : tostrprintf("%08d", 10000000+i);
+            vector<string> ids = { id };
+            MeterInfo mi("", "m", MeterDriver::AUTO, "", ids, "", LinkModeSet(), 0, shells, jsons);
+            manager->addMeter(createMeter(&mi));
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            manager->handleTelegram(about, frame, false);
+        }
+        double owned = nanosSince(start)/rounds;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            manager->handleTelegram(about, unknown_frame, false);
+        }
+        double not_owned = nanosSince(start)/rounds;
+
+        printf("%10d %12.0f %12.0f\n", num_meters, owned, not_owned);
+    }
+}
+
+void bench_id_match()
+{
+    vector<string> ids = { "12366666" };
+    const int rounds = 1000000;
+
+    printf("id matching (ns per match)\n");
+    printf("%-36s %12s %12s\n", "expressions", "strings", "compiled");
+
+    for (string mes : { "12366666", "123*,!1234*,!1235*,!1236*", "*,!00156327,!00048713,!12345678" })
+    {
+        vector<string> expressions = splitMatchExpressions(mes);
+        IdMatcher matcher(expressions);
+        bool uw = false;
+        int n = 0;
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            n += doesIdsMatchExpressions(ids, expressions, &uw);
+        }
+        double strings = nanosSince(start)/rounds;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            n += matcher.matches(ids, &uw);
+        }
+        double compiled = nanosSince(start)/rounds;
+
+        printf("%-36s %12.1f %12.1f%s\n", mes.c_str(), strings, compiled, n < 0 ? "!" : "");
+    }
+}
+
+// The if-chain that pickMeterDriver used to expand METER_DETECTION into.
+MeterDriver pickMeterDriverChain(int manufacturer, int media, int version)
+{
+#define X(TY,MA,ME,VE) { if (manufacturer == MA && (media == ME || ME == -1) && (version == VE || VE == -1)) { return MeterDriver::TY; }}
+METER_DETECTION
+#undef X
+    return MeterDriver::UNKNOWN;
+}
+
+void bench_driver_detection()
+{
+    struct { const char *name; int mfct, media, version; } cases[] = {
+        { "first in list (amiplus)", MANUFACTURER_APA, 0x02, 0x02 },
+        { "last in list", 0, 0, 0 },
+        { "wildcard version (izar)", MANUFACTURER_SAP, 0x04, 0x42 },
+        { "unknown", 0x1234, 0x99, 0x99 },
+    };
+    // Find the entry at the end of the list.
+    int last_ma = 0, last_me = 0, last_ve = 0;
+#define X(TY,MA,ME,VE) { last_ma = MA; last_me = ME; last_ve = VE; }
+METER_DETECTION
+#undef X
+    cases[1].mfct = last_ma;
+    cases[1].media = last_me;
+    cases[1].version = last_ve;
+
+    const int rounds = 1000000;
+
+    printf("driver detection (ns per lookup)\n");
+    printf("%-28s %12s %12s\n", "telegram", "if-chain", "table");
+
+    for (auto &c : cases)
+    {
+        int n = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            n += (int)pickMeterDriverChain(c.mfct, c.media, c.version);
+        }
+        double chain = nanosSince(start)/rounds;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            n += (int)pickMeterDriver(c.mfct, c.media, c.version);
+        }
+        double table = nanosSince(start)/rounds;
+
+        if (pickMeterDriverChain(c.mfct, c.media, c.version) != pickMeterDriver(c.mfct, c.media, c.version))
+        {
+            printf("ERROR: table and if-chain disagree for %s\n", c.name);
+        }
+        printf("%-28s %12.1f %12.1f%s\n", c.name, chain, table, n < 0 ? "!" : "");
+    }
+}
+
+void bench_explanations()
+{
+    // A short and a long unencrypted telegram with plain data records.
+    struct { const char *name; const char *hex; } cases[] = {
+        { "supercom587", "1844AE4C4455223368077A55000000041389E20100023B0000" },
+        { "apator162", "6E4401068426500005077A8B0060052F2F0413000000000406000000000415000000000412000000000440000000000444000000000446000000000442000000000F0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000" },
+    };
+    const int rounds = 100000;
+
+    printf("telegram parse (ns per telegram)\n");
+    printf("%-28s %12s %12s\n", "telegram", "explained", "quiet");
+
+    for (auto &c : cases)
+    {
+        vector<uchar> frame;
+        hex2bin(c.hex, &frame);
+        AboutTelegram about("", 0, FrameType::WMBUS);
+        MeterKeys mk;
+        size_t n = 0;
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            Telegram t;
+            t.about = about;
+            t.enableExplanations(true);
+            t.parse(frame, &mk, false);
+            n += t.values.size();
+        }
+        double explained = nanosSince(start)/rounds;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            Telegram t;
+            t.about = about;
+            t.parse(frame, &mk, false);
+            n += t.values.size();
+        }
+        double quiet = nanosSince(start)/rounds;
+
+        printf("%-28s %12.1f %12.1f%s\n", c.name, explained, quiet, n == 0 ? "!" : "");
+    }
+}
+
+void bench_find_key()
+{
+    // Look up a dozen fields, like a heat meter driver does, in the plain telegrams of the simulations.
+    ValueInformation fields[] = {
+        ValueInformation::EnergyWh, ValueInformation::EnergyMJ, ValueInformation::Volume,
+        ValueInformation::VolumeFlow, ValueInformation::PowerW, ValueInformation::FlowTemperature,
+        ValueInformation::ReturnTemperature, ValueInformation::TemperatureDifference,
+        ValueInformation::ExternalTemperature, ValueInformation::Date, ValueInformation::DateTime,
+        ValueInformation::OperatingTime,
+    };
+    const int rounds = 10000;
+
+    printf("find key (ns per telegram with %zu lookups)\n", sizeof(fields)/sizeof(fields[0]));
+    printf("%-36s %8s %12s %12s\n", "simulation", "records", "scan", "index");
+
+    for (const char *file : { "simulations/simulation_t1.txt", "simulations/simulation_c1.txt" })
+    {
+        vector<string> lines;
+        loadFile(file, &lines);
+
+        vector<unique_ptr<Telegram>> telegrams;
+        size_t records = 0;
+        MeterKeys mk;
+        for (string &line : lines)
+        {
+            if (line.compare(0, 10, "telegram=|") != 0) continue;
+            string hex;
+            for (char c : line.substr(9)) if (c != '|') hex += c;
+            vector<uchar> frame;
+            hex2bin(hex, &frame);
+            unique_ptr<Telegram> t(new Telegram);
+            t->about = AboutTelegram("", 0, FrameType::WMBUS);
+            if (!t->parse(frame, &mk, false) || t->values.size() == 0) continue;
+            records += t->values.size();
+            telegrams.push_back(move(t));
+        }
+        if (telegrams.size() == 0) continue;
+
+        size_t n = 0;
+        string key;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            for (auto &t : telegrams)
+            {
+                for (ValueInformation vi : fields)
+                {
+                    n += findKey(MeasurementType::Unknown, vi, 0, 0, &key, &t->values);
+                }
+            }
+        }
+        double scan = nanosSince(start)/rounds/telegrams.size();
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            for (auto &t : telegrams)
+            {
+                for (ValueInformation vi : fields)
+                {
+                    n += findKey(MeasurementType::Unknown, vi, 0, 0, &key, t.get());
+                }
+            }
+        }
+        double index = nanosSince(start)/rounds/telegrams.size();
+
+        printf("%-36s %8zu %12.1f %12.1f%s\n", file, records/telegrams.size(), scan, index, n == 0 ? "!" : "");
+    }
+}
+
+void bench_manufacturer()
+{
+    // Census mode looks up the manufacturer of every telegram heard,
+    // so walk through all possible m_fields, known or not.
+    const int rounds = 100;
+    size_t n = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        for (int m = 0; m < 32768; ++m)
+        {
+            n += strlen(manufacturer(m));
+            n += manufacturerFlag(m).c_str()[0];
+        }
+    }
+    double lookup = nanosSince(start)/rounds/32768;
+
+    printf("manufacturer lookup (ns per m_field)\n");
+    printf("%-28s %12.1f%s\n", "name and flag", lookup, n == 0 ? "!" : "");
+}
+
+void bench_crc()
+{
+    // Frame format a has a crc for every 16 bytes, format b for up to 126 bytes.
+    size_t lens[] = { 10, 16, 126, 255 };
+    uchar bytes[255];
+    for (size_t i = 0; i < sizeof(bytes); ++i) bytes[i] = i*37;
+    const int rounds = 1000000;
+
+    printf("crc16 EN13757 (ns per block)\n");
+    printf("%-28s %12s %12s\n", "block", "ns", "MB/s");
+
+    for (size_t len : lens)
+    {
+        size_t x = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            bytes[0] = i;
+            x += crc16_EN13757(bytes, len);
+        }
+        double ns = nanosSince(start)/rounds;
+        string name = to_string(len)+" bytes";
+        printf("%-28s %12.1f %12.1f%s\n", name.c_str(), ns, len*1000.0/ns, x == 0 ? "!" : "");
+    }
+
+    // A 16 block frame format a telegram, trimmed for every round.
+    vector<uchar> frame;
+    for (size_t i = 0; i < 10+16*15; ++i) frame.push_back(i*13);
+    frame[0] = frame.size()-1;
+    vector<uchar> with_crcs;
+    for (size_t pos = 0; pos < frame.size(); pos += (pos == 0 ? 10 : 16))
+    {
+        size_t len = pos == 0 ? 10 : 16;
+        uint16_t crc = crc16_EN13757(&frame[pos], len);
+        with_crcs.insert(with_crcs.end(), frame.begin()+pos, frame.begin()+pos+len);
+        with_crcs.push_back(crc >> 8);
+        with_crcs.push_back(crc & 0xff);
+    }
+    const int trims = 100000;
+    vector<uchar> payload;
+    size_t n = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < trims; ++i)
+    {
+        payload = with_crcs;
+        n += trimCRCsFrameFormatA(payload);
+    }
+    printf("%-28s %12.1f%s\n", "trim frame format a", nanosSince(start)/trims, n == 0 ? "!" : "");
+}
+
+void bench_aes()
+{
+    const AESBackend *backends[] = { aesPortableBackend(), aesHardwareBackend() };
+    uchar key[16] = { 0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c };
+    const int rounds = 1000000;
+
+    printf("aes-128 (ns per block)\n");
+    printf("%-28s %12s %12s %12s %12s\n", "backend", "expand", "encrypt", "decrypt", "encrypt x8");
+
+    for (const AESBackend *aes : backends)
+    {
+        if (aes == NULL) continue;
+
+        AESRoundKeys rk;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            key[0] = i;
+            aes->expandKey(key, &rk);
+        }
+        double expand = nanosSince(start)/rounds;
+
+        uchar block[16] = {};
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            aes->encryptBlock(&rk, block, block);
+        }
+        double encrypt = nanosSince(start)/rounds;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            aes->decryptBlock(&rk, block, block);
+        }
+        double decrypt = nanosSince(start)/rounds;
+
+        // Eight independent blocks at once, as the ctr and cbc decryption does.
+        uchar blocks[16*8] = {};
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds/8; ++i)
+        {
+            aes->encryptBlocks(&rk, blocks, blocks, 8);
+        }
+        double batched = nanosSince(start)/(rounds/8*8);
+
+        printf("%-28s %12.1f %12.1f %12.1f %12.1f\n", aes->name, expand, encrypt, decrypt, batched);
+    }
+}
+
+void bench_diehl_lfsr()
+{
+    // An izar telegram from the simulation, a wrong key is tried before the default keys.
+    vector<uchar> origin, frame;
+    hex2bin("1944304C72242421D401A2013D4013DD8B46A4999C1293E582CC", &origin);
+    frame = origin;
+    transformDiehlAddress(frame, mustTransformDiehlAddress(frame));
+    vector<uint32_t> keys;
+    initializeDiehlDefaultKeySupport(vector<uchar>(), keys);
+    keys.insert(keys.begin(), 0x12345678);
+    const int rounds = 1000000;
+
+    printf("diehl lfsr (ns per telegram)\n");
+    printf("%-28s %12s\n", "keys", "ns");
+
+    size_t n = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        n += decodeDiehlLfsr(origin, frame, keys[0], DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF, 0).size();
+    }
+    printf("%-28s %12.1f\n", "one key, checksum", nanosSince(start)/rounds);
+
+    size_t first = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        first = 0;
+        n += decodeDiehlLfsr(origin, frame, keys, &first, DiehlLfsrCheckMethod::HEADER_1_BYTE, 0x4B).size();
+    }
+    printf("%-28s %12.1f\n", "all keys", nanosSince(start)/rounds);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        n += decodeDiehlLfsr(origin, frame, keys, &first, DiehlLfsrCheckMethod::HEADER_1_BYTE, 0x4B).size();
+    }
+    printf("%-28s %12.1f%s\n", "last good key first", nanosSince(start)/rounds, n == 0 ? "!" : "");
+}
+
+// What invokeShell did before, fork copies the page tables of the whole process.
+static void forkAndWait(const char *program)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl(program, program, (char*)NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+}
+
+void bench_spawn()
+{
+    const int rounds = 200;
+    vector<string> args, envs;
+    envs.push_back("METER_ID=12345678");
+    envs.push_back("METER_TOTAL_M3=123.456");
+
+    printf("spawn latency (us per command)\n");
+    printf("%-28s %12s %12s\n", "rss", "fork", "posix_spawn");
+
+    vector<vector<uchar>> ballast;
+    for (int mb : { 0, 256, 1024 })
+    {
+        // Grow the resident set, every page is touched so it is really mapped.
+        while ((int)ballast.size() < mb/64) ballast.push_back(vector<uchar>(64*1024*1024, 1));
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) forkAndWait("/bin/true");
+        double forked = nanosSince(start)/rounds/1000;
+
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) invokeShell("/bin/true", args, envs);
+        double spawned = nanosSince(start)/rounds/1000;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%d MiB", mb);
+        printf("%-28s %12.1f %12.1f\n", name, forked, spawned);
+    }
+}
+
+void bench_json()
+{
+    // A decrypted multical21 telegram, printed as json, fields and shell envs.
+    vector<uchar> frame;
+    hex2bin("2A442D2C998734761B168D2091D37CAC21E1D68CDAFFCD3DC452BD802913FF7B1706CA9E355D6C2701CC24", &frame);
+    shared_ptr<MeterManager> manager = createMeterManager(false);
+    vector<string> shells, jsons = { "floor=5", "address=RoodRd 42" };
+    vector<string> ids = { "76348799" };
+    MeterInfo mi("", "Water", MeterDriver::MULTICAL21, "", ids, "28F64A24988064A079AA2C807D6102AE", LinkModeSet(), 0, shells, jsons);
+    manager->addMeter(createMeter(&mi));
+    Meter *meter = manager->lastAddedMeter();
+    AboutTelegram about("rtlwmbus[00000001]", -77, FrameType::WMBUS);
+    Telegram t;
+    meter->onUpdate([&](Telegram *tt, Meter *m) { t.ids = tt->ids; t.about = tt->about; t.dll_type = tt->dll_type; t.dll_mfct = tt->dll_mfct; });
+    manager->handleTelegram(about, frame, false);
+    const int rounds = 100000;
+
+    printf("json rendering (ns per telegram)\n");
+    printf("%-28s %12s\n", "what", "ns");
+
+    vector<string> more_json, selected_fields;
+    size_t n = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        string human_readable, fields, json;
+        vector<string> envs;
+        meter->printMeter(&t, &human_readable, &fields, ';', &json, &envs, &more_json, &selected_fields);
+        n += json.length();
+    }
+    printf("%-28s %12.1f%s\n", "printMeter", nanosSince(start)/rounds, n == 0 ? "!" : "");
+
+    double values[] = { 6.408, 0, 127, 19, 1234.5678, -0.25, 0.001 };
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        for (double v : values) n += to_string(v).length();
+    }
+    printf("%-28s %12.1f\n", "to_string x7", nanosSince(start)/rounds);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        string s;
+        for (double v : values) appendNumber(&s, v);
+        n += s.length();
+    }
+    printf("%-28s %12.1f%s\n", "appendNumber x7", nanosSince(start)/rounds, n == 0 ? "!" : "");
+}
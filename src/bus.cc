@@ -59,6 +59,16 @@ BusManager::BusManager(shared_ptr<SerialCommunicationManager> serial_manager,
 {
 }
 
+void BusManager::forEachBusDevice(std::function<void(WMBus*)> cb)
+{
+    LOCK_BUS_DEVICES(for_each_bus_device);
+
+    for (auto &w : bus_devices_)
+    {
+        cb(w.get());
+    }
+}
+
 void BusManager::removeAllBusDevices()
 {
     bus_devices_.clear();
@@ -165,7 +175,7 @@ void BusManager::openBusDeviceAndPotentiallySetLinkmodes(Configuration *config,
         debug("(main) added %s to files\n", detected->found_file.c_str());
         simulation_files_.insert(detected->specified_device.file);
     }
-    wmbus->onTelegram([&, simulated](AboutTelegram &about,vector<uchar> data){return meter_manager_->handleTelegram(about, data, simulated);});
+    wmbus->onTelegram([&, simulated](AboutTelegram &about,const vector<uchar> &data){return meter_manager_->handleTelegram(about, data, simulated);});
     wmbus->setTimeout(config->alarm_timeout, config->alarm_expected_activity);
 }
 
@@ -49,6 +49,7 @@ struct BusManager
 
     int numBusDevices() { return  bus_devices_.size(); }
     WMBus *findBus(string name);
+    void forEachBusDevice(std::function<void(WMBus*)> cb);
 
 private:
 
@@ -424,6 +424,14 @@ shared_ptr<Configuration> parseCommandLine(int argc, char **argv) {
             i++;
             continue;
         }
+        if (!strncmp(argv[i], "--duplicatewindow=", 18) && strlen(argv[i]) > 18) {
+            c->duplicate_window = parseTime(argv[i]+18);
+            if (c->duplicate_window <= 0) {
+                error("Not a valid time to remember telegrams when ignoring duplicates. \"%s\"\n", argv[i]+18);
+            }
+            i++;
+            continue;
+        }
         if (!strncmp(argv[i], "--usestdoutforlogging", 13)) {
             c->use_stderr_for_log = false;
             i++;
@@ -438,6 +446,15 @@ shared_ptr<Configuration> parseCommandLine(int argc, char **argv) {
             i++;
             continue;
         }
+        if (!strncmp(argv[i], "--pipeshell=", 12)) {
+            string cmd = string(argv[i]+12);
+            if (cmd == "") {
+                error("The pipe shell command cannot be empty.\n");
+            }
+            c->pipe_shells.push_back(cmd);
+            i++;
+            continue;
+        }
         if (!strncmp(argv[i], "--alarmshell=", 13)) {
             string cmd = string(argv[i]+13);
             if (cmd == "") {
@@ -510,6 +527,46 @@ shared_ptr<Configuration> parseCommandLine(int argc, char **argv) {
             i++;
             continue;
         }
+        if (!strncmp(argv[i], "--maxmeters=", 12) && strlen(argv[i]) > 12) {
+            c->max_meters = atoi(argv[i]+12);
+            if (c->max_meters <= 0) {
+                error("Not a valid maximum number of meters. \"%s\"\n", argv[i]+12);
+            }
+            i++;
+            continue;
+        }
+        if (!strncmp(argv[i], "--meterspill=", 13) && strlen(argv[i]) > 13) {
+            c->meter_spill_dir = string(argv[i]+13);
+            if (!checkIfDirExists(c->meter_spill_dir.c_str())) {
+                error("Cannot write meter spill files into dir \"%s\"\n", c->meter_spill_dir.c_str());
+            }
+            i++;
+            continue;
+        }
+        if (!strncmp(argv[i], "--decodethreads=", 16) && strlen(argv[i]) > 16) {
+            c->decode_threads = atoi(argv[i]+16);
+            if (c->decode_threads <= 0) {
+                error("Not a valid number of decode threads. \"%s\"\n", argv[i]+16);
+            }
+            i++;
+            continue;
+        }
+        if (!strncmp(argv[i], "--shellprocesses=", 17) && strlen(argv[i]) > 17) {
+            c->shell_processes = atoi(argv[i]+17);
+            if (c->shell_processes <= 0) {
+                error("Not a valid number of shell processes. \"%s\"\n", argv[i]+17);
+            }
+            i++;
+            continue;
+        }
+        if (!strncmp(argv[i], "--shellqueue=", 13) && strlen(argv[i]) > 13) {
+            c->shell_queue = atoi(argv[i]+13);
+            if (c->shell_queue <= 0) {
+                error("Not a valid shell queue length. \"%s\"\n", argv[i]+13);
+            }
+            i++;
+            continue;
+        }
         if (!strncmp(argv[i], "--alarmtimeout=", 15)) {
             c->alarm_timeout = parseTime(argv[i]+15);
             if (c->alarm_timeout <= 0) {
@@ -240,6 +240,16 @@ void handleIgnoreDuplicateTelegrams(Configuration *c, string value)
     }
 }
 
+void handleDuplicateWindow(Configuration *c, string s)
+{
+    c->duplicate_window = parseTime(s.c_str());
+    if (c->duplicate_window <= 0)
+    {
+        warning("Not a valid time to remember telegrams when ignoring duplicates. \"%s\"\n", s.c_str());
+        c->duplicate_window = 10;
+    }
+}
+
 void handleResetAfter(Configuration *c, string s)
 {
     if (s.length() >= 1)
@@ -256,6 +266,57 @@ void handleResetAfter(Configuration *c, string s)
     }
 }
 
+void handleMaxMeters(Configuration *c, string s)
+{
+    c->max_meters = atoi(s.c_str());
+    if (c->max_meters <= 0)
+    {
+        warning("Not a valid maximum number of meters. \"%s\"\n", s.c_str());
+        c->max_meters = 0;
+    }
+}
+
+void handleDecodeThreads(Configuration *c, string s)
+{
+    c->decode_threads = atoi(s.c_str());
+    if (c->decode_threads <= 0)
+    {
+        warning("Not a valid number of decode threads. \"%s\"\n", s.c_str());
+        c->decode_threads = 0;
+    }
+}
+
+void handleShellProcesses(Configuration *c, string s)
+{
+    c->shell_processes = atoi(s.c_str());
+    if (c->shell_processes <= 0)
+    {
+        warning("Not a valid number of shell processes. \"%s\"\n", s.c_str());
+        c->shell_processes = 4;
+    }
+}
+
+void handleShellQueue(Configuration *c, string s)
+{
+    c->shell_queue = atoi(s.c_str());
+    if (c->shell_queue <= 0)
+    {
+        warning("Not a valid shell queue length. \"%s\"\n", s.c_str());
+        c->shell_queue = 1000;
+    }
+}
+
+void handleMeterSpill(Configuration *c, string dir)
+{
+    if (dir.length() > 0)
+    {
+        c->meter_spill_dir = dir;
+        if (!checkIfDirExists(c->meter_spill_dir.c_str())) {
+            warning("Cannot write meter spill files into dir \"%s\"\n", c->meter_spill_dir.c_str());
+        }
+    }
+}
+
 bool handleDevice(Configuration *c, string devicefile)
 {
     SpecifiedDevice specified_device;
@@ -567,6 +628,11 @@ void handleShell(Configuration *c, string cmdline)
     c->telegram_shells.push_back(cmdline);
 }
 
+void handlePipeShell(Configuration *c, string cmdline)
+{
+    c->pipe_shells.push_back(cmdline);
+}
+
 void handleAlarmShell(Configuration *c, string cmdline)
 {
     c->alarm_shells.push_back(cmdline);
@@ -604,6 +670,7 @@ shared_ptr<Configuration> loadConfiguration(string root, string device_override,
         if (p.first == "loglevel") handleLoglevel(c, p.second);
         else if (p.first == "internaltesting") handleInternalTesting(c, p.second);
         else if (p.first == "ignoreduplicates") handleIgnoreDuplicateTelegrams(c, p.second);
+        else if (p.first == "duplicatewindow") handleDuplicateWindow(c, p.second);
         else if (p.first == "device") handleDevice(c, p.second);
         else if (p.first == "donotprobe") handleDoNotProbe(c, p.second);
         else if (p.first == "listento") handleListenTo(c, p.second);
@@ -621,7 +688,13 @@ shared_ptr<Configuration> loadConfiguration(string root, string device_override,
         else if (p.first == "logtimestamps") handleLogTimestamps(c, p.second);
         else if (p.first == "selectfields") handleSelectedFields(c, p.second);
         else if (p.first == "shell") handleShell(c, p.second);
+        else if (p.first == "pipeshell") handlePipeShell(c, p.second);
         else if (p.first == "resetafter") handleResetAfter(c, p.second);
+        else if (p.first == "maxmeters") handleMaxMeters(c, p.second);
+        else if (p.first == "meterspill") handleMeterSpill(c, p.second);
+        else if (p.first == "decodethreads") handleDecodeThreads(c, p.second);
+        else if (p.first == "shellprocesses") handleShellProcesses(c, p.second);
+        else if (p.first == "shellqueue") handleShellQueue(c, p.second);
         else if (p.first == "alarmshell") handleAlarmShell(c, p.second);
         else if (startsWith(p.first, "json_"))
         {
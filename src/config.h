@@ -72,11 +72,13 @@ struct Configuration
     bool use_logfile {};
     bool use_stderr_for_log = true; // Default is to use stderr for logging.
     bool ignore_duplicate_telegrams = true; // Default is to ignore duplicates.
+    int duplicate_window = 10; // Seconds to remember a telegram, when ignoring duplicates.
     std::string logfile;
     bool json {};
     bool fields {};
     char separator { ';' };
     std::vector<std::string> telegram_shells;
+    std::vector<std::string> pipe_shells; // Started once, receives one json line per telegram on stdin.
     std::vector<std::string> alarm_shells;
     int alarm_timeout {}; // Maximum number of seconds between dongle receiving two telegrams.
     std::string alarm_expected_activity; // Only warn when within these time periods.
@@ -91,6 +93,11 @@ struct Configuration
     int  exitafter {}; // Seconds to exit.
     bool nodeviceexit {}; // If no wmbus receiver device is found, then exit immediately!
     int  resetafter {}; // Reset the wmbus devices regularly.
+    int  max_meters {}; // Evict meters created from templates when there are more than this. 0 means no limit.
+    std::string meter_spill_dir; // Store the last telegram of evicted meters here.
+    int  decode_threads {}; // Decode telegrams in this many threads. 0 means in the event loop thread.
+    int  shell_processes {4}; // Run at most this many shell commands at the same time.
+    int  shell_queue {1000}; // Coalesce or drop shell commands when this many are waiting.
     std::vector<SpecifiedDevice> supplied_bus_devices; // /dev/ttyUSB0, simulation.txt, rtlwmbus, /dev/ttyUSB1:9600 /dev/ttyUSB2:mbus
     int num_wmbus_devices {};
     int num_mbus_devices {};
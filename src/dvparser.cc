@@ -16,8 +16,10 @@
 */
 
 #include"dvparser.h"
+#include"threads.h"
 #include"util.h"
 
+#include<algorithm>
 #include<assert.h>
 #include<memory.h>
 
@@ -48,10 +50,34 @@ LIST_OF_VALUETYPES
     return ValueInformation::None;
 }
 
+static const char hex_digits[] = "0123456789ABCDEF";
+
+DVEntry::DVEntry(MeasurementType mt, int vi, int st, int ta, int su, string &val) :
+    type(mt), value_information(vi), storagenr(st), tariff(ta), subunit(su)
+{
+    hex2bin(val, &owned_);
+}
+
+string DVEntry::value() const
+{
+    const uchar *v = bytes();
+    string s;
+    s.reserve(length()*2);
+    for (size_t i = 0; i < length(); ++i) {
+        s += hex_digits[v[i] >> 4];
+        s += hex_digits[v[i] & 0x0f];
+    }
+    return s;
+}
+
 map<uint16_t,string> hash_to_format_;
+// Telegrams can be parsed in several decode threads.
+RecursiveMutex hash_to_format_mutex_("hash_to_format_mutex");
 
 bool loadFormatBytesFromSignature(uint16_t format_signature, vector<uchar> *format_bytes)
 {
+    WITH(hash_to_format_mutex_, hash_to_format_mutex, loadFormatBytesFromSignature);
+
     if (hash_to_format_.count(format_signature) > 0) {
         debug("(dvparser) found remembered format for hash %x\n", format_signature);
         // Return the proper hash!
@@ -141,7 +167,7 @@ bool parseDV(Telegram *t,
             {
                 DEBUG_PARSER("(dvparser) reached manufacturer specific data 0f, parsing is done.\n");
                 datalen = std::distance(data,data_end);
-                string value = bin2hex(data+1, data_end, datalen-1);
+                string value = t->explanationsEnabled() ? bin2hex(data+1, data_end, datalen-1) : "";
                 t->mfct_0f_index = 1+std::distance(data_start, data);
                 assert(t->mfct_0f_index >= 0);
                 t->addExplanationAndIncrementPos(data, datalen, "%02X manufacturer specific data %s", dif, value.c_str());
@@ -163,7 +189,8 @@ bool parseDV(Telegram *t,
         if (data_has_difvifs) {
             format_bytes.push_back(dif);
             id_bytes.push_back(dif);
-            t->addExplanationAndIncrementPos(*format, 1, "%02X dif (%s)", dif, difType(dif).c_str());
+            t->addExplanationAndIncrementPos(*format, 1, "%02X dif (%s)", dif,
+                                             t->explanationsEnabled() ? difType(dif).c_str() : "");
         } else {
             id_bytes.push_back(**format);
             (*format)++;
@@ -207,11 +234,12 @@ bool parseDV(Telegram *t,
         if (*format == format_end) { debug("(dvparser) warning: unexpected end of data (vif expected)\n"); break; }
 
         uchar vif = **format;
-        DEBUG_PARSER("(dvparser debug) vif=%02x \"%s\"\n", vif, vifType(vif).c_str());
+        DEBUG_PARSER("(dvparser debug) vif=%02x \"%s\"\n", vif, vifType(vif));
         if (data_has_difvifs) {
             format_bytes.push_back(vif);
             id_bytes.push_back(vif);
-            t->addExplanationAndIncrementPos(*format, 1, "%02X vif (%s)", vif, vifType(vif).c_str());
+            t->addExplanationAndIncrementPos(*format, 1, "%02X vif (%s)", vif,
+                                             t->explanationsEnabled() ? vifType(vif) : "");
         } else {
             id_bytes.push_back(**format);
             (*format)++;
@@ -221,11 +249,12 @@ bool parseDV(Telegram *t,
         while (has_another_vife) {
             if (*format == format_end) { debug("(dvparser) warning: unexpected end of data (vife expected)\n"); break; }
             uchar vife = **format;
-            DEBUG_PARSER("(dvparser debug) vife=%02x (%s)\n", vife, vifeType(dif, vif, vife).c_str());
+            DEBUG_PARSER("(dvparser debug) vife=%02x (%s)\n", vife, vifeType(dif, vif, vife));
             if (data_has_difvifs) {
                 format_bytes.push_back(vife);
                 id_bytes.push_back(vife);
-                t->addExplanationAndIncrementPos(*format, 1, "%02X vife (%s)", vife, vifeType(dif, vif, vife).c_str());
+                t->addExplanationAndIncrementPos(*format, 1, "%02X vife (%s)", vife,
+                                                 t->explanationsEnabled() ? vifeType(dif, vif, vife) : "");
             } else {
                 id_bytes.push_back(**format);
                 (*format)++;
@@ -233,12 +262,10 @@ bool parseDV(Telegram *t,
             has_another_vife = (vife & 0x80) == 0x80;
         }
 
-        dv = "";
+        dv.clear();
         for (uchar c : id_bytes) {
-            char hex[3];
-            hex[2] = 0;
-            snprintf(hex, 3, "%02X", c);
-            dv.append(hex);
+            dv += hex_digits[c >> 4];
+            dv += hex_digits[c & 0x0f];
         }
         DEBUG_PARSER("(dvparser debug) key \"%s\"\n", dv.c_str());
 
@@ -269,10 +296,14 @@ bool parseDV(Telegram *t,
         if (variable_length) {
             t->addExplanationAndIncrementPos(data, 1, "%02X varlen=%d", datalen, datalen);
         }
-        string value = bin2hex(data, data_end, datalen);
+        int value_len = std::min(datalen, (int)std::distance(data, data_end));
+        if (value_len < 0) value_len = 0;
         int offset = start_parse_here+data-data_start;
-        (*values)[key] = { offset, DVEntry(mt, vif&0x7f, storage_nr, tariff, subunit, value) };
-        if (value.length() > 0) {
+        auto i = values->insert(make_pair(key, pair<int,DVEntry>())).first;
+        i->second = { offset, DVEntry(mt, vif&0x7f, storage_nr, tariff, subunit, dif, vif,
+                                      value_len > 0 ? &*data : NULL, value_len) };
+        if (value_len > 0) {
+            string value = t->explanationsEnabled() ? bin2hex(data, data_end, datalen) : "";
             // This call increments data with datalen.
             t->addExplanationAndIncrementPos(data, datalen, "%s", value.c_str());
             DEBUG_PARSER("(dvparser debug) data \"%s\"\n\n", value.c_str());
@@ -283,10 +314,17 @@ bool parseDV(Telegram *t,
         }
     }
 
+    if (values == &t->values) {
+        // Only the telegram's own values are indexed for findKey. The values can be
+        // parsed in several parts, or again, the index always covers all of them.
+        t->dv_index.rebuild(t->values);
+    }
+
     string format_string = bin2hex(format_bytes);
     uint16_t hash = crc16_EN13757(&format_bytes[0], format_bytes.size());
 
     if (data_has_difvifs) {
+        WITH(hash_to_format_mutex_, hash_to_format_mutex, parseDV);
         if (hash_to_format_.count(hash) == 0) {
             hash_to_format_[hash] = format_string;
             debug("(dvparser) found new format \"%s\" with hash %x, remembering!\n", format_string.c_str(), hash);
@@ -307,6 +345,46 @@ LIST_OF_VALUETYPES
     assert(0);
 }
 
+void DVIndex::rebuild(const map<string,pair<int,DVEntry>> &values)
+{
+    entries_.clear();
+    sorted_ = true;
+    for (auto &v : values)
+    {
+        const DVEntry *entry = &v.second.second;
+        if (entries_.size() > 0 && entries_.back().value_information > entry->value_information) sorted_ = false;
+        entries_.push_back({ entry->value_information, &v.first, entry });
+    }
+}
+
+bool DVIndex::find(MeasurementType mt, int vi_low, int vi_high, int storagenr, int tariffnr, string *key)
+{
+    if (!sorted_) {
+        stable_sort(entries_.begin(), entries_.end(),
+                    [](const Entry &a, const Entry &b) { return a.value_information < b.value_information; });
+        sorted_ = true;
+    }
+
+    auto i = lower_bound(entries_.begin(), entries_.end(), vi_low,
+                         [](const Entry &e, int vi) { return e.value_information < vi; });
+
+    const string *found = NULL;
+    for (; i != entries_.end() && i->value_information <= vi_high; ++i)
+    {
+        const DVEntry *e = i->entry;
+        if ((mt == MeasurementType::Unknown || mt == e->type)
+            && (storagenr == ANY_STORAGENR || storagenr == e->storagenr)
+            && (tariffnr == ANY_TARIFFNR || tariffnr == e->tariff)
+            && (found == NULL || *i->key < *found))
+        {
+            found = i->key;
+        }
+    }
+    if (found == NULL) return false;
+    *key = *found;
+    return true;
+}
+
 bool hasKey(std::map<std::string,std::pair<int,DVEntry>> *values, std::string key)
 {
     return values->count(key) > 0;
@@ -347,6 +425,15 @@ bool findKey(MeasurementType mit, ValueInformation vif, int storagenr, int tarif
     return false;
 }
 
+bool findKey(MeasurementType mit, ValueInformation vif, int storagenr, int tariffnr,
+             std::string *key, Telegram *t)
+{
+    int low, hi;
+    valueInfoRange(vif, &low, &hi);
+
+    return t->dv_index.find(mit, low, hi, storagenr, tariffnr, key);
+}
+
 void extractDV(string &s, uchar *dif, uchar *vif)
 {
     vector<uchar> bytes;
@@ -368,50 +455,95 @@ void extractDV(string &s, uchar *dif, uchar *vif)
     *vif = bytes[i];
 }
 
-bool extractDVuint8(map<string,pair<int,DVEntry>> *values,
-                    string key,
-                    int *offset,
-                    uchar *value)
+// Find the entry stored under the key. Entries created from hex strings
+// by the drivers do not know their dif and vif, these are then decoded from the key.
+pair<int,DVEntry> *findDV(map<string,pair<int,DVEntry>> *values, string &key, uchar *dif, uchar *vif)
 {
-    if ((*values).count(key) == 0) {
-        verbose("(dvparser) warning: cannot extract uint16 from non-existant key \"%s\"\n", key.c_str());
-        *offset = -1;
-        *value = 0;
-        return false;
+    auto i = values->find(key);
+    if (i == values->end()) return NULL;
+
+    DVEntry &e = i->second.second;
+    if (e.has_difvif) {
+        *dif = e.dif;
+        *vif = e.vif;
+    } else {
+        extractDV(key, dif, vif);
     }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
+    return &i->second;
+}
+
+// Little endian binary integer of 1 to 8 bytes.
+uint64_t decodeBinary(const uchar *v, size_t len)
+{
+    uint64_t raw = 0;
+    for (size_t i = len; i > 0; --i) {
+        raw = (raw << 8) | v[i-1];
+    }
+    return raw;
+}
 
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    vector<uchar> v;
-    hex2bin(p.second.value, &v);
+// Nibbles above 9 are not valid bcd, they are weighted
+// as the distance from '0' to their hex digit 'A'-'F'.
+int bcdDigit(uchar nibble)
+{
+    return nibble < 10 ? nibble : nibble+7;
+}
 
-    *value = v[0];
-    return true;
+// Little endian bcd with two digits per byte, 74140000 -> 00001474
+uint64_t decodeBCD(const uchar *v, size_t len)
+{
+    uint64_t raw = 0;
+    for (size_t i = len; i > 0; --i) {
+        raw = raw*100 + bcdDigit(v[i-1] >> 4)*10 + bcdDigit(v[i-1] & 0x0f);
+    }
+    return raw;
 }
 
-bool extractDVuint16(map<string,pair<int,DVEntry>> *values,
-                     string key,
-                     int *offset,
-                     uint16_t *value)
+bool extractDVuint(map<string,pair<int,DVEntry>> *values,
+                   string &key,
+                   int *offset,
+                   size_t len,
+                   uint64_t *value,
+                   const char *name)
 {
-    if ((*values).count(key) == 0) {
-        verbose("(dvparser) warning: cannot extract uint16 from non-existant key \"%s\"\n", key.c_str());
+    uchar dif, vif;
+    pair<int,DVEntry> *p = findDV(values, key, &dif, &vif);
+    if (p == NULL) {
+        verbose("(dvparser) warning: cannot extract %s from non-existant key \"%s\"\n", name, key.c_str());
         *offset = -1;
         *value = 0;
         return false;
     }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
+    *offset = p->first;
+    if (p->second.length() < len) {
+        verbose("(dvparser) warning: too little data for %s in key \"%s\"\n", name, key.c_str());
+        *value = 0;
+        return false;
+    }
+    *value = decodeBinary(p->second.bytes(), len);
+    return true;
+}
 
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    vector<uchar> v;
-    hex2bin(p.second.value, &v);
+bool extractDVuint8(map<string,pair<int,DVEntry>> *values,
+                    string key,
+                    int *offset,
+                    uchar *value)
+{
+    uint64_t v;
+    bool ok = extractDVuint(values, key, offset, 1, &v, "uint8");
+    *value = v;
+    return ok;
+}
 
-    *value = v[1]<<8 | v[0];
-    return true;
+bool extractDVuint16(map<string,pair<int,DVEntry>> *values,
+                     string key,
+                     int *offset,
+                     uint16_t *value)
+{
+    uint64_t v;
+    bool ok = extractDVuint(values, key, offset, 2, &v, "uint16");
+    *value = v;
+    return ok;
 }
 
 bool extractDVuint24(map<string,pair<int,DVEntry>> *values,
@@ -419,22 +551,10 @@ bool extractDVuint24(map<string,pair<int,DVEntry>> *values,
                      int *offset,
                      uint32_t *value)
 {
-    if ((*values).count(key) == 0) {
-        verbose("(dvparser) warning: cannot extract uint24 from non-existant key \"%s\"\n", key.c_str());
-        *offset = -1;
-        *value = 0;
-        return false;
-    }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
-
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    vector<uchar> v;
-    hex2bin(p.second.value, &v);
-
-    *value = v[2] << 16 | v[1]<<8 | v[0];
-    return true;
+    uint64_t v;
+    bool ok = extractDVuint(values, key, offset, 3, &v, "uint24");
+    *value = v;
+    return ok;
 }
 
 bool extractDVuint32(map<string,pair<int,DVEntry>> *values,
@@ -442,22 +562,30 @@ bool extractDVuint32(map<string,pair<int,DVEntry>> *values,
                      int *offset,
                      uint32_t *value)
 {
-    if ((*values).count(key) == 0) {
-        verbose("(dvparser) warning: cannot extract uint32 from non-existant key \"%s\"\n", key.c_str());
-        *offset = -1;
-        *value = 0;
-        return false;
-    }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
+    uint64_t v;
+    bool ok = extractDVuint(values, key, offset, 4, &v, "uint32");
+    *value = v;
+    return ok;
+}
 
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    vector<uchar> v;
-    hex2bin(p.second.value, &v);
+// Decode the value of an entry according to its dif. Returns false for unsupported difs.
+bool decodeDVRaw(uchar dif, const DVEntry &e, uint64_t *raw)
+{
+    static const int binary_len[16] = { 0, 1, 2, 3, 4, 0, 6, 8, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const int bcd_len[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 0, 6, 0 };
 
-    *value = (uint32_t(v[3]) << 24) |  (uint32_t(v[2]) << 16) | (uint32_t(v[1])<<8) | uint32_t(v[0]);
-    return true;
+    int t = dif&0xf;
+    if (binary_len[t] > 0) {
+        assert(e.length() == (size_t)binary_len[t]);
+        *raw = decodeBinary(e.bytes(), binary_len[t]);
+        return true;
+    }
+    if (bcd_len[t] > 0) {
+        assert(e.length() == (size_t)bcd_len[t]);
+        *raw = decodeBCD(e.bytes(), bcd_len[t]);
+        return true;
+    }
+    return false;
 }
 
 bool extractDVdouble(map<string,pair<int,DVEntry>> *values,
@@ -466,115 +594,30 @@ bool extractDVdouble(map<string,pair<int,DVEntry>> *values,
                      double *value,
                      bool auto_scale)
 {
-    if ((*values).count(key) == 0) {
+    uchar dif, vif;
+    pair<int,DVEntry> *p = findDV(values, key, &dif, &vif);
+    if (p == NULL) {
         verbose("(dvparser) warning: cannot extract double from non-existant key \"%s\"\n", key.c_str());
         *offset = 0;
         *value = 0;
         return false;
     }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
+    *offset = p->first;
 
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-
-    if (p.second.value.length() == 0) {
+    if (p->second.length() == 0) {
         verbose("(dvparser) warning: key found but no data  \"%s\"\n", key.c_str());
         *offset = 0;
         *value = 0;
         return false;
     }
 
-    int t = dif&0xf;
-    if (t == 0x1 || // 8 Bit Integer/Binary
-        t == 0x2 || // 16 Bit Integer/Binary
-        t == 0x3 || // 24 Bit Integer/Binary
-        t == 0x4 || // 32 Bit Integer/Binary
-        t == 0x6 || // 48 Bit Integer/Binary
-        t == 0x7)   // 64 Bit Integer/Binary
-    {
-        vector<uchar> v;
-        hex2bin(p.second.value, &v);
-        unsigned int raw = 0;
-        if (t == 0x1) {
-            assert(v.size() == 1);
-            raw = v[0];
-        } else if (t == 0x2) {
-            assert(v.size() == 2);
-            raw = v[1]*256 + v[0];
-        } else if (t == 0x3) {
-            assert(v.size() == 3);
-            raw = v[2]*256*256 + v[1]*256 + v[0];
-        } else if (t == 0x4) {
-            assert(v.size() == 4);
-            raw = ((unsigned int)v[3])*256*256*256
-                + ((unsigned int)v[2])*256*256
-                + ((unsigned int)v[1])*256
-                + ((unsigned int)v[0]);
-        } else if (t == 0x6) {
-            assert(v.size() == 6);
-            raw = ((uint64_t)v[5])*256*256*256*256*256
-                + ((uint64_t)v[4])*256*256*256*256
-                + ((uint64_t)v[3])*256*256*256
-                + ((uint64_t)v[2])*256*256
-                + ((uint64_t)v[1])*256
-                + ((uint64_t)v[0]);
-        } else if (t == 0x7) {
-            assert(v.size() == 8);
-            raw = ((uint64_t)v[7])*256*256*256*256*256*256*256
-                + ((uint64_t)v[6])*256*256*256*256*256*256
-                + ((uint64_t)v[5])*256*256*256*256*256
-                + ((uint64_t)v[4])*256*256*256*256
-                + ((uint64_t)v[3])*256*256*256
-                + ((uint64_t)v[2])*256*256
-                + ((uint64_t)v[1])*256
-                + ((uint64_t)v[0]);
-        }
-        double scale = 1.0;
-        if (auto_scale) scale = vifScale(vif);
-        *value = ((double)raw) / scale;
-    }
-    else
-    if (t == 0x9 || // 2 digit BCD
-        t == 0xA || // 4 digit BCD
-        t == 0xB || // 6 digit BCD
-        t == 0xC || // 8 digit BCD
-        t == 0xE)   // 12 digit BCD
+    uint64_t raw;
+    if (decodeDVRaw(dif, p->second, &raw))
     {
-        // 74140000 -> 00001474
-        string& v = p.second.value;
-        unsigned int raw = 0;
-        if (t == 0x9) {
-            assert(v.size() == 2);
-            raw = (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xA) {
-            assert(v.size() == 4);
-            raw = (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xB) {
-            assert(v.size() == 6);
-            raw = (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xC) {
-            assert(v.size() == 8);
-            raw = (v[6]-'0')*10*10*10*10*10*10*10 + (v[7]-'0')*10*10*10*10*10*10
-                + (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xE) {
-            assert(v.size() == 12);
-            raw =(v[10]-'0')*10*10*10*10*10*10*10*10*10*10*10 + (v[11]-'0')*10*10*10*10*10*10*10*10*10*10
-                + (v[8]-'0')*10*10*10*10*10*10*10*10*10 + (v[9]-'0')*10*10*10*10*10*10*10*10
-                + (v[6]-'0')*10*10*10*10*10*10*10 + (v[7]-'0')*10*10*10*10*10*10
-                + (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        }
-
         double scale = 1.0;
         if (auto_scale) scale = vifScale(vif);
-        *value = ((double)raw) / scale;
+        // The raw value is limited to 32 bits before scaling.
+        *value = ((double)(unsigned int)raw) / scale;
     }
     else
     {
@@ -589,110 +632,26 @@ bool extractDVlong(map<string,pair<int,DVEntry>> *values,
                    int *offset,
                    uint64_t *value)
 {
-    if ((*values).count(key) == 0) {
+    uchar dif, vif;
+    pair<int,DVEntry> *p = findDV(values, key, &dif, &vif);
+    if (p == NULL) {
         verbose("(dvparser) warning: cannot extract long from non-existant key \"%s\"\n", key.c_str());
         *offset = 0;
         *value = 0;
         return false;
     }
-    uchar dif, vif;
-    extractDV(key, &dif, &vif);
+    *offset = p->first;
 
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-
-    if (p.second.value.length() == 0) {
+    if (p->second.length() == 0) {
         verbose("(dvparser) warning: key found but no data  \"%s\"\n", key.c_str());
         *offset = 0;
         *value = 0;
         return false;
     }
 
-    int t = dif&0xf;
-    if (t == 0x1 || // 8 Bit Integer/Binary
-        t == 0x2 || // 16 Bit Integer/Binary
-        t == 0x3 || // 24 Bit Integer/Binary
-        t == 0x4 || // 32 Bit Integer/Binary
-        t == 0x6 || // 48 Bit Integer/Binary
-        t == 0x7)   // 64 Bit Integer/Binary
+    uint64_t raw;
+    if (decodeDVRaw(dif, p->second, &raw))
     {
-        vector<uchar> v;
-        hex2bin(p.second.value, &v);
-        uint64_t raw = 0;
-        if (t == 0x1) {
-            assert(v.size() == 1);
-            raw = v[0];
-        } else if (t == 0x2) {
-            assert(v.size() == 2);
-            raw = v[1]*256 + v[0];
-        } else if (t == 0x3) {
-            assert(v.size() == 3);
-            raw = v[2]*256*256 + v[1]*256 + v[0];
-        } else if (t == 0x4) {
-            assert(v.size() == 4);
-            raw = ((unsigned int)v[3])*256*256*256
-                + ((unsigned int)v[2])*256*256
-                + ((unsigned int)v[1])*256
-                + ((unsigned int)v[0]);
-        } else if (t == 0x6) {
-            assert(v.size() == 6);
-            raw = ((uint64_t)v[5])*256*256*256*256*256
-                + ((uint64_t)v[4])*256*256*256*256
-                + ((uint64_t)v[3])*256*256*256
-                + ((uint64_t)v[2])*256*256
-                + ((uint64_t)v[1])*256
-                + ((uint64_t)v[0]);
-        } else if (t == 0x7) {
-            assert(v.size() == 8);
-            raw = ((uint64_t)v[7])*256*256*256*256*256*256*256
-                + ((uint64_t)v[6])*256*256*256*256*256*256
-                + ((uint64_t)v[5])*256*256*256*256*256
-                + ((uint64_t)v[4])*256*256*256*256
-                + ((uint64_t)v[3])*256*256*256
-                + ((uint64_t)v[2])*256*256
-                + ((uint64_t)v[1])*256
-                + ((uint64_t)v[0]);
-        }
-        *value = raw;
-    }
-    else
-    if (t == 0x9 || // 2 digit BCD
-        t == 0xA || // 4 digit BCD
-        t == 0xB || // 6 digit BCD
-        t == 0xC || // 8 digit BCD
-        t == 0xE)   // 12 digit BCD
-    {
-        // 74140000 -> 00001474
-        string& v = p.second.value;
-        uint64_t raw = 0;
-        if (t == 0x9) {
-            assert(v.size() == 2);
-            raw = (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xA) {
-            assert(v.size() == 4);
-            raw = (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xB) {
-            assert(v.size() == 6);
-            raw = (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xC) {
-            assert(v.size() == 8);
-            raw = (v[6]-'0')*10*10*10*10*10*10*10 + (v[7]-'0')*10*10*10*10*10*10
-                + (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        } else if (t ==  0xE) {
-            assert(v.size() == 12);
-            raw =(v[10]-'0')*10*10*10*10*10*10*10*10*10*10*10 + (v[11]-'0')*10*10*10*10*10*10*10*10*10*10
-                + (v[8]-'0')*10*10*10*10*10*10*10*10*10 + (v[9]-'0')*10*10*10*10*10*10*10*10
-                + (v[6]-'0')*10*10*10*10*10*10*10 + (v[7]-'0')*10*10*10*10*10*10
-                + (v[4]-'0')*10*10*10*10*10 + (v[5]-'0')*10*10*10*10
-                + (v[2]-'0')*10*10*10 + (v[3]-'0')*10*10
-                + (v[0]-'0')*10 + (v[1]-'0');
-        }
-
         *value = raw;
     }
     else
@@ -708,15 +667,15 @@ bool extractDVstring(map<string,pair<int,DVEntry>> *values,
                      int *offset,
                      string *value)
 {
-    if ((*values).count(key) == 0) {
+    auto i = values->find(key);
+    if (i == values->end()) {
         verbose("(dvparser) warning: cannot extract string from non-existant key \"%s\"\n", key.c_str());
         *offset = -1;
         *value = "";
         return false;
     }
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    *value = p.second.value;
+    *offset = i->second.first;
+    *value = i->second.second.value();
     return true;
 }
 
@@ -778,22 +737,20 @@ bool extractDVdate(map<string,pair<int,DVEntry>> *values,
     value->tm_year = 0;
 
     uchar dif, vif;
-    extractDV(key, &dif, &vif);
-
-    pair<int,DVEntry>&  p = (*values)[key];
-    *offset = p.first;
-    vector<uchar> v;
-    hex2bin(p.second.value, &v);
+    pair<int,DVEntry> *p = findDV(values, key, &dif, &vif);
+    *offset = p->first;
+    const uchar *v = p->second.bytes();
+    size_t len = p->second.length();
 
     bool ok = true;
-    if (v.size() == 2) {
+    if (len == 2) {
         ok &= extractDate(v[1], v[0], value);
     }
-    else if (v.size() == 4) {
+    else if (len == 4) {
         ok &= extractDate(v[3], v[2], value);
         ok &= extractTime(v[1], v[0], value);
     }
-    else if (v.size() == 6) {
+    else if (len == 6) {
         ok &= extractDate(v[4], v[3], value);
         ok &= extractTime(v[2], v[1], value);
         // ..ss ssss
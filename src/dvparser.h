@@ -71,6 +71,9 @@ bool parseDV(Telegram *t,
 // in combination with the storagenr. (Later I will add tariff/subunit)
 bool findKey(MeasurementType mt, ValueInformation vi, int storagenr, int tariffnr,
              std::string *key, std::map<std::string,std::pair<int,DVEntry>> *values);
+// The same, but a direct lookup in the index built over the values of the telegram.
+bool findKey(MeasurementType mt, ValueInformation vi, int storagenr, int tariffnr,
+             std::string *key, Telegram *t);
 
 #define ANY_STORAGENR -1
 #define ANY_TARIFFNR -1
@@ -122,4 +125,8 @@ bool extractDVdate(std::map<std::string,std::pair<int,DVEntry>> *values,
 
 void extractDV(string &s, uchar *dif, uchar *vif);
 
+// Decode little endian binary and bcd values of len bytes.
+uint64_t decodeBinary(const uchar *v, size_t len);
+uint64_t decodeBCD(const uchar *v, size_t len);
+
 #endif
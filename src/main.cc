@@ -168,9 +168,12 @@ shared_ptr<Printer> create_printer(Configuration *config)
                                            config->separator, config->meterfiles, config->meterfiles_dir,
                                            config->use_logfile, config->logfile,
                                            config->telegram_shells,
+                                           config->pipe_shells,
                                            config->meterfiles_action == MeterFileType::Overwrite,
                                            config->meterfiles_naming,
-                                           config->meterfiles_timestamp));
+                                           config->meterfiles_timestamp,
+                                           config->shell_processes,
+                                           config->shell_queue));
 }
 
 void list_shell_envs(Configuration *config, string meter_driver)
@@ -255,6 +258,14 @@ void log_start_information(Configuration *config)
         verbose("(config) store meter files in: \"%s\"\n", config->meterfiles_dir.c_str());
     }
 
+    if (config->decode_threads != 0) {
+        verbose("(config) decode telegrams in %d threads\n", config->decode_threads);
+    }
+
+    if (config->max_meters != 0) {
+        verbose("(config) keep at most %d meters created from templates\n", config->max_meters);
+    }
+
     for (SpecifiedDevice &specified_device : config->supplied_bus_devices)
     {
         verbose("(config) using device: %s \n", specified_device.str().c_str());
@@ -301,6 +312,9 @@ void regular_checkup(Configuration *config)
     }
 
     bus_manager_->regularCheckup();
+
+    // Write the meterfiles buffered since the last telegram.
+    if (printer_) printer_->flushFiles();
 }
 
 void setup_log_file(Configuration *config)
@@ -374,6 +388,7 @@ bool start(Configuration *config)
     stderrEnabled(config->use_stderr_for_log);
     setAlarmShells(config->alarm_shells);
     setIgnoreDuplicateTelegrams(config->ignore_duplicate_telegrams);
+    setDuplicateTelegramsWindow(config->duplicate_window);
 
     log_start_information(config);
 
@@ -392,6 +407,8 @@ bool start(Configuration *config)
     // and creates meters on demand when the telegram arrives
     // or on startup for 2-way communication meters like mbus or T2.
     meter_manager_ = createMeterManager(config->daemon);
+    meter_manager_->limitMeters(config->max_meters, config->meter_spill_dir);
+    meter_manager_->useDecodeThreads(config->decode_threads);
 
     // The bus manager detects new/lost wmbus devices and
     // configures the devices according to the specification.
@@ -444,10 +461,11 @@ bool start(Configuration *config)
     {
         notice("No meters configured. Printing id:s of all telegrams heard!\n");
 
-        meter_manager_->onTelegram([](AboutTelegram &about, vector<uchar> frame) {
+        meter_manager_->onTelegram([](AboutTelegram &about, const vector<uchar> &frame) {
                 Telegram t;
                 t.about = about;
                 MeterKeys mk;
+                t.enableExplanations(isDebugEnabled());
                 t.parse(frame, &mk, false); // Try a best effort parse, do not print any warnings.
                 t.print();
                 string info = string("(")+toString(about.type)+")";
@@ -473,6 +491,27 @@ bool start(Configuration *config)
         notice("(wmbusmeters) shutting down\n");
     }
 
+    meter_manager_->waitForDecodeThreads();
+    printer_->waitForShells();
+    printer_->closeFiles();
+
+    size_t hits, misses;
+    meter_manager_->negativeIdCacheStats(&hits, &misses);
+    verbose("(main) telegrams dropped early since no meter listens to their ids: %zu checked: %zu\n", hits, misses);
+
+    meter_manager_->forEachMeter([](Meter *meter)
+        {
+            if (meter->numDecryptionFailures() == 0) return;
+            verbose("(main) telegrams that failed decryption for meter %s %s: %d skipped: %d\n",
+                    meter->name().c_str(), meter->idsc().c_str(),
+                    meter->numDecryptionFailures(), meter->numDecryptionSkipped());
+        });
+
+    bus_manager_->forEachBusDevice([](WMBus *bus)
+        {
+            verbose("(main) duplicate telegrams ignored from %s: %zu\n", bus->hr().c_str(), bus->numDuplicatesIgnored());
+        });
+
     bus_manager_->removeAllBusDevices();
     meter_manager_->removeAllMeters();
     printer_.reset();
@@ -162,55 +162,120 @@ void transformDiehlAddress(vector<uchar>& frame, DiehlAddressTransformMethod tra
     }
 }
 
+// Diehl: advance the LFSR one bit, the new bit is the xor of bits 1, 2, 11 and 31.
+// https://en.wikipedia.org/wiki/Linear-feedback_shift_register
+static uint32_t diehlLfsrStep(uint32_t key)
+{
+    uint32_t bit = ((key >> 1) ^ (key >> 2) ^ (key >> 11) ^ (key >> 31)) & 1;
+    return (key << 1) | bit;
+}
+
+// The LFSR is linear, advancing it n bits is the xor of advancing each
+// byte of the key on its own. Table k holds the result for a byte at
+// position k. After 8 steps the low byte is the next byte of key stream,
+// after 32 steps the key holds the next four bytes, the first one on top.
+struct DiehlLfsrTables
+{
+    uint32_t step8[4][256];
+    uint32_t step32[4][256];
+
+    DiehlLfsrTables()
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t key = i << (8*k);
+                for (int j = 0; j < 32; ++j)
+                {
+                    key = diehlLfsrStep(key);
+                    if (j == 7) step8[k][i] = key;
+                }
+                step32[k][i] = key;
+            }
+        }
+    }
+};
+
+static inline uint32_t diehlLfsrAdvance(const uint32_t (&t)[4][256], uint32_t key)
+{
+    return t[0][key & 0xFF] ^ t[1][(key >> 8) & 0xFF] ^ t[2][(key >> 16) & 0xFF] ^ t[3][key >> 24];
+}
+
 // Diehl: decode LFSR encrypted data used in Izar/PRIOS and Sharky meters
 vector<uchar> decodeDiehlLfsr(const vector<uchar> &origin, const vector<uchar> &frame, uint32_t key, DiehlLfsrCheckMethod check_method, uint32_t check_value)
 {
+    static const DiehlLfsrTables tables;
+
     // modify seed key with header values
     key ^= uint32FromBytes(origin, 2); // manufacturer + address[0-1]
     key ^= uint32FromBytes(origin, 6); // address[2-3] + version + type
     key ^= uint32FromBytes(frame, 10); // ci + some more bytes from the telegram...
 
     int size = frame.size() - 15;
+    if (size <= 0) return vector<uchar>();
+
+    const uchar *in = &frame[15];
     vector<uchar> decoded(size);
+    int i = 0;
 
-    for (int i = 0; i < size; ++i) {
-        // calculate new key (LFSR)
-        // https://en.wikipedia.org/wiki/Linear-feedback_shift_register
-        for (int j = 0; j < 8; ++j) {
-            // calculate new bit value (xor of selected bits from previous key)
-            uchar bit = ((key & 0x2) != 0) ^ ((key & 0x4) != 0) ^ ((key & 0x800) != 0) ^ ((key & 0x80000000) != 0);
-            // shift key bits and add new one at the end
-            key = (key << 1) | bit;
+    if (check_method == DiehlLfsrCheckMethod::HEADER_1_BYTE)
+    {
+        // Check the first byte before decoding the rest, a wrong key is rejected early.
+        key = diehlLfsrAdvance(tables.step8, key);
+        decoded[0] = in[0] ^ (key & 0xFF);
+        if (decoded[0] != check_value) {
+            decoded.clear();
+            return decoded;
         }
-        // decode i-th content byte with fresh/last 8-bits of key
-        decoded[i] = frame[i + 15] ^ (key & 0xFF);
+        i = 1;
+    }
 
-        if (check_method == DiehlLfsrCheckMethod::HEADER_1_BYTE)
-        {
-            // check-byte doesn't match?
-            if (decoded[0] != 0x4B) {
-                decoded.clear();
-                return decoded;
-            }
+    // Decode four bytes per step, then the remaining bytes one at a time.
+    for (; i + 4 <= size; i += 4) {
+        key = diehlLfsrAdvance(tables.step32, key);
+        decoded[i]   = in[i]   ^ (key >> 24);
+        decoded[i+1] = in[i+1] ^ ((key >> 16) & 0xFF);
+        decoded[i+2] = in[i+2] ^ ((key >> 8) & 0xFF);
+        decoded[i+3] = in[i+3] ^ (key & 0xFF);
+    }
+    for (; i < size; ++i) {
+        key = diehlLfsrAdvance(tables.step8, key);
+        decoded[i] = in[i] ^ (key & 0xFF);
+    }
+
+    if (check_method == DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF)
+    {
+        uint32_t checksum = 0;
+        for (int index = 0; index < size; index++) {
+            checksum += decoded[index];
         }
-        else if (check_method == DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF)
-        {
-            if (i == size - 1) {
-                uint32_t checksum = 0;
-                for (int index = 0; index < size; index++) {
-                    checksum += (decoded[index] & 0xFF);
-                }
-                if ((checksum & 0xEF) != check_value) {
-                    decoded.clear();
-                    return decoded;
-                }
-            }
+        if ((checksum & 0xEF) != check_value) {
+            decoded.clear();
+            return decoded;
         }
     }
 
     return decoded;
 }
 
+// Diehl: decode with each key until one succeeds, starting with the key that succeeded last time
+vector<uchar> decodeDiehlLfsr(const vector<uchar> &origin, const vector<uchar> &frame, const vector<uint32_t> &keys, size_t *last_good_key, DiehlLfsrCheckMethod check_method, uint32_t check_value)
+{
+    size_t n = keys.size();
+    size_t first = *last_good_key < n ? *last_good_key : 0;
+
+    for (size_t k = 0; k < n; ++k) {
+        size_t index = (first + k) % n;
+        vector<uchar> decoded = decodeDiehlLfsr(origin, frame, keys[index], check_method, check_value);
+        if (!decoded.empty()) {
+            *last_good_key = index;
+            return decoded;
+        }
+    }
+    return vector<uchar>();
+}
+
 uint32_t uint32FromBytes(const vector<uchar> &data, int offset, bool reverse)
 {
     if (reverse)
@@ -274,17 +339,13 @@ bool mustDecryptDiehlRealData(const vector<uchar>& frame)
 }
 
 // Diehl: decrypt real data payload (LFSR)
-bool decryptDielhRealData(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, const vector<uchar> &confidentiality_key)
+bool decryptDielhRealData(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, MeterKeys *meter_keys)
 {
     vector<uint32_t> keys;
-    initializeDiehlDefaultKeySupport(confidentiality_key, keys);
+    initializeDiehlDefaultKeySupport(meter_keys->confidentiality_key, keys);
 
-    vector<uchar> decoded_content;
-    for (auto& key : keys) {
-        decoded_content = decodeDiehlLfsr(t->original.empty() ? frame : t->original, frame, key, DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF, frame[14] & 0xEF);
-        if (!decoded_content.empty())
-            break;
-    }
+    vector<uchar> decoded_content = decodeDiehlLfsr(t->original.empty() ? frame : t->original, frame, keys, &meter_keys->diehl_last_good_key,
+                                                    DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF, frame[14] & 0xEF);
 
     if (decoded_content.empty())
     {
@@ -41,6 +41,10 @@ enum class DiehlLfsrCheckMethod {
 // Diehl: decode LFSR encrypted data used in Izar/PRIOS and Sharky meters
 vector<uchar> decodeDiehlLfsr(const vector<uchar> &origin, const vector<uchar> &frame, uint32_t key, DiehlLfsrCheckMethod check_method, uint32_t check_value);
 
+// Diehl: decode with each key until one succeeds, starting with the key at index *last_good_key.
+// The index of the key that succeeded is stored back into *last_good_key.
+vector<uchar> decodeDiehlLfsr(const vector<uchar> &origin, const vector<uchar> &frame, const vector<uint32_t> &keys, size_t *last_good_key, DiehlLfsrCheckMethod check_method, uint32_t check_value);
+
 // Diehl: frame interpretation
 enum class DiehlFrameInterpretation {
     NA,                // N/A: not a Diehl frame
@@ -74,6 +78,6 @@ void transformDiehlAddress(vector<uchar>& frame, DiehlAddressTransformMethod met
 bool mustDecryptDiehlRealData(const vector<uchar>& frame);
 
 // Diehl: decrypt real data payload (LFSR)
-bool decryptDielhRealData(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, const vector<uchar> &meterkey);
+bool decryptDielhRealData(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, MeterKeys *meter_keys);
 
 #endif
@@ -15,7 +15,7 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-// This file is only included into meters.cc
+// This file is included into meters.cc (and bench.cc to compare against the old lookup).
 //
 // List of numbers that can be used to detect the meter driver from a telegram.
 //
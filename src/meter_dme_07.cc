@@ -67,7 +67,7 @@ void MeterDME_07::processContent(Telegram *t)
     int offset;
     string key;
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_water_consumption_m3_);
         t->addMoreExplanation(offset, " total consumption (%f m3)", total_water_consumption_m3_);
     }
@@ -150,7 +150,7 @@ void MeterEBZWMBE::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::EnergyWh, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Unknown, ValueInformation::EnergyWh, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_energy_kwh_);
         t->addMoreExplanation(offset, " total energy (%f kwh)", total_energy_kwh_);
     }
@@ -120,13 +120,13 @@ void MeterEHZP::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::EnergyWh, 0, 0, &key, &t->values))
+    if (findKey(MeasurementType::Unknown, ValueInformation::EnergyWh, 0, 0, &key, t))
     {
         extractDVdouble(&t->values, key, &offset, &total_energy_kwh_);
         t->addMoreExplanation(offset, " total energy (%f kwh)", total_energy_kwh_);
     }
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::PowerW, 0, 0, &key, &t->values))
+    if (findKey(MeasurementType::Unknown, ValueInformation::PowerW, 0, 0, &key, t))
     {
         extractDVdouble(&t->values, key, &offset, &current_power_kw_);
         t->addMoreExplanation(offset, " current power (%f kw)", current_power_kw_);
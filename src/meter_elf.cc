@@ -191,7 +191,7 @@ void MeterElf::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 0, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         meter_date_ = strdate(&date);
@@ -215,37 +215,37 @@ void MeterElf::processContent(Telegram *t)
         t->addMoreExplanation(offset, " version (%s)", version_.c_str());
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_energy_kwh_);
         t->addMoreExplanation(offset, " total energy consumption (%f kWh)", total_energy_kwh_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_volume_m3_);
         t->addMoreExplanation(offset, " total volume (%f m3)", total_volume_m3_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 1, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 1, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &target_energy_kwh_);
         t->addMoreExplanation(offset, " target energy consumption (%f kWh)", target_energy_kwh_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::PowerW, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::PowerW, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &current_power_kw_);
         t->addMoreExplanation(offset, " current power consumption (%f kW)", current_power_kw_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::FlowTemperature, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::FlowTemperature, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &flow_temperature_c_);
         t->addMoreExplanation(offset, " flow temperature (%f °C)", flow_temperature_c_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::ExternalTemperature, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::ExternalTemperature, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &external_temperature_c_);
         t->addMoreExplanation(offset, " external temperature (%f °C)", external_temperature_c_);
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::ReturnTemperature, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::ReturnTemperature, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &return_temperature_c_);
         t->addMoreExplanation(offset, " return temperature (%f °C)", return_temperature_c_);
     }
@@ -208,13 +208,13 @@ void MeterEurisII::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::HeatCostAllocation, 0, 0, &key, &t->values))
+    if (findKey(MeasurementType::Unknown, ValueInformation::HeatCostAllocation, 0, 0, &key, t))
     {
         extractDVdouble(&t->values, key, &offset, &current_consumption_hca_);
         t->addMoreExplanation(offset, " current consumption (%f hca)", current_consumption_hca_);
     }
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::Date, 1, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Unknown, ValueInformation::Date, 1, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         set_date_ = strdate(&date);
@@ -223,7 +223,7 @@ void MeterEurisII::processContent(Telegram *t)
 
     for (int i=1; i<=17; ++i)
     {
-        if (findKey(MeasurementType::Unknown, ValueInformation::HeatCostAllocation, i, 0, &key, &t->values))
+        if (findKey(MeasurementType::Unknown, ValueInformation::HeatCostAllocation, i, 0, &key, t))
         {
             string info;
             strprintf(info, " consumption at set date %d (%%f hca)", i);
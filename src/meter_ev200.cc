@@ -71,12 +71,12 @@ void MeterEV200::processContent(Telegram *t)
     int offset;
     string key;
 
-    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &actual_total_water_consumption_m3_);
         t->addMoreExplanation(offset, " actual total consumption (%f m3)", actual_total_water_consumption_m3_);
     }
 
-    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 1, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 1, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &last_total_water_consumption_m3h_);
         t->addMoreExplanation(offset, " last total consumption (%f m3)", last_total_water_consumption_m3h_);
     }
@@ -257,12 +257,12 @@ void MeterEvo868::processContent(Telegram *t)
     int offset;
     string key;
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_water_consumption_m3_);
         t->addMoreExplanation(offset, " total consumption (%f m3)", total_water_consumption_m3_);
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, t)) {
         struct tm datetime;
         extractDVdate(&t->values, key, &offset, &datetime);
         device_date_time_ = strdatetime(&datetime);
@@ -276,36 +276,36 @@ void MeterEvo868::processContent(Telegram *t)
     reverse(fabrication_no_.begin(), fabrication_no_.end());
     t->addMoreExplanation(offset, " fabrication no (%s)", fabrication_no_.c_str());
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 1, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 1, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &consumption_at_set_date_m3_);
         t->addMoreExplanation(offset, " consumption at set date (%f m3)", consumption_at_set_date_m3_);
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 1, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 1, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         set_date_ = strdate(&date);
         t->addMoreExplanation(offset, " set date (%s)", set_date_.c_str());
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 2, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 2, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &consumption_at_set_date_2_m3_);
         t->addMoreExplanation(offset, " consumption at set date 2 (%f m3)", consumption_at_set_date_2_m3_);
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 2, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 2, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         set_date_2_ = strdate(&date);
         t->addMoreExplanation(offset, " set date 2 (%s)", set_date_2_.c_str());
     }
 
-    if(findKey(MeasurementType::Maximum, ValueInformation::VolumeFlow, 3, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Maximum, ValueInformation::VolumeFlow, 3, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &max_flow_since_datetime_m3h_);
         t->addMoreExplanation(offset, " max flow (%f m3/h)", max_flow_since_datetime_m3h_);
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 3, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 3, 0, &key, t)) {
         struct tm datetime;
         extractDVdate(&t->values, key, &offset, &datetime);
         max_flow_datetime_ = strdatetime(&datetime);
@@ -317,7 +317,7 @@ void MeterEvo868::processContent(Telegram *t)
     t->addMoreExplanation(offset, " month increment (%d)", month_increment);
 
     struct tm date;
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 8, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 8, 0, &key, t)) {
         extractDVdate(&t->values, key, &offset, &date);
         string start = strdate(&date);
         t->addMoreExplanation(offset, " history starts with date (%s)", start.c_str());
@@ -326,7 +326,7 @@ void MeterEvo868::processContent(Telegram *t)
     // 12 months of historical data, starting in storage 8.
     for (int i=1; i<=12; ++i)
     {
-        if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, i+7, 0, &key, &t->values)) {
+        if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, i+7, 0, &key, t)) {
             extractDVdouble(&t->values, key, &offset, &consumption_at_history_date_m3_[i-1]);
             t->addMoreExplanation(offset, " consumption at history %d (%f m3)", i, consumption_at_history_date_m3_[i-1]);
             struct tm d = date;
@@ -108,26 +108,26 @@ void MeterHydrocalM3::processContent(Telegram *t)
 
     // The meter either sends the total energy consumed as kWh or as MJ.
     // First look for kwh
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_heating_energy_kwh_);
         t->addMoreExplanation(offset, " total heating energy consumption (%f kWh)", total_heating_energy_kwh_);
     }
     // Then look for mj.
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyMJ, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyMJ, 0, 0, &key, t)) {
         double mj;
         extractDVdouble(&t->values, key, &offset, &mj);
         total_heating_energy_kwh_ = convert(mj, Unit::MJ, Unit::KWH);
         t->addMoreExplanation(offset, " total heating_energy consumption (%f MJ = %f kWh)", mj, total_heating_energy_kwh_);
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, t)) {
         struct tm datetime;
         extractDVdate(&t->values, key, &offset, &datetime);
         device_date_time_ = strdatetime(&datetime);
         t->addMoreExplanation(offset, " device date time (%s)", device_date_time_.c_str());
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_heating_volume_m3_);
         t->addMoreExplanation(offset, " total heating_volume (%f m3)", total_heating_volume_m3_);
     }
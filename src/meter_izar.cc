@@ -58,7 +58,6 @@ struct MeterIzar : public virtual WaterMeter, public virtual MeterCommonImplemen
 private:
 
     void processContent(Telegram *t);
-    vector<uchar> decodePrios(const vector<uchar> &origin, const vector<uchar> &payload, uint32_t key);
 
     string prefix;
     uint32_t serial_number {0};
@@ -73,6 +72,8 @@ private:
     izar_alarms alarms;
 
     vector<uint32_t> keys;
+    // The index of the key that decoded the last telegram, it is tried first.
+    size_t last_good_key_ {};
 };
 
 shared_ptr<WaterMeter> createIzar(MeterInfo &mi)
@@ -230,12 +231,7 @@ void MeterIzar::processContent(Telegram *t)
     t->extractFrame(&frame);
     vector<uchar> origin = t->original.empty() ? frame : t->original;
 
-    vector<uchar> decoded_content;
-    for (auto& key : keys) {
-        decoded_content = decodePrios(origin, frame, key);
-        if (!decoded_content.empty())
-            break;
-    }
+    vector<uchar> decoded_content = decodeDiehlLfsr(origin, frame, keys, &last_good_key_, DiehlLfsrCheckMethod::HEADER_1_BYTE, 0x4B);
 
     debug("(izar) Decoded PRIOS data: %s\n", bin2hex(decoded_content).c_str());
 
@@ -292,8 +288,3 @@ void MeterIzar::processContent(Telegram *t)
     alarms.mechanical_fraud_currently = frame[13] >> 1 & 0x1;
     alarms.mechanical_fraud_previously = frame[13] & 0x1;
 }
-
-vector<uchar> MeterIzar::decodePrios(const vector<uchar> &origin, const vector<uchar> &frame, uint32_t key)
-{
-    return decodeDiehlLfsr(origin, frame, key, DiehlLfsrCheckMethod::HEADER_1_BYTE, 0x4B);
-}
@@ -134,15 +134,15 @@ void MeterLSE_07_17::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_water_consumption_m3_);
         t->addMoreExplanation(offset, " total consumption (%f m3)", total_water_consumption_m3_);
     }
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 1, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 1, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &due_date_water_consumption_m3_);
         t->addMoreExplanation(offset, " due date consumption (%f m3)", due_date_water_consumption_m3_);
     }
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 1, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::Date, 1, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         due_date_ = strdate(&date);
@@ -156,14 +156,14 @@ void MeterLSE_07_17::processContent(Telegram *t)
         t->addMoreExplanation(offset, " error code (%s)", errorCode().c_str());
     }
 
-    if (findKey(MeasurementType::AtError, ValueInformation::Date, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::AtError, ValueInformation::Date, 0, 0, &key, t)) {
         struct tm date;
         extractDVdate(&t->values, key, &offset, &date);
         error_date_ = strdate(&date);
         t->addMoreExplanation(offset, " error date (%s)", error_date_.c_str());
     }
 
-    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Instantaneous, ValueInformation::DateTime, 0, 0, &key, t)) {
         struct tm datetime;
         extractDVdate(&t->values, key, &offset, &datetime);
         device_date_time_ = strdatetime(&datetime);
@@ -94,14 +94,14 @@ void MeterSensostar::processContent(Telegram *t)
     int offset;
     string key;
 
-    if (findKey(MeasurementType::Unknown, ValueInformation::DateTime, 0, 0, &key, &t->values)) {
+    if (findKey(MeasurementType::Unknown, ValueInformation::DateTime, 0, 0, &key, t)) {
         struct tm datetime;
         extractDVdate(&t->values, key, &offset, &datetime);
         meter_timestamp_ = strdatetime(&datetime);
         t->addMoreExplanation(offset, " at date (%s)", meter_timestamp_.c_str());
     }
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::EnergyWh, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_energy_consumption_kwh_);
         t->addMoreExplanation(offset, " total energy consumption (%f kWh)", total_energy_consumption_kwh_);
     }
@@ -109,7 +109,7 @@ void MeterSensostar::processContent(Telegram *t)
     extractDVuint8(&t->values, "01FD17", &offset, &info_codes_);
     t->addMoreExplanation(offset, " info codes (%s)", status().c_str());
 
-    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Instantaneous, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_water_m3_);
         t->addMoreExplanation(offset, " total water consumption (%f m3)", total_water_m3_);
     }
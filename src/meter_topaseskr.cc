@@ -125,15 +125,15 @@ void MeterTopasEsKr::processContent(Telegram *t)
     int offset;
     string key;
 
-    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Unknown, ValueInformation::Volume, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &total_water_consumption_m3_);
         t->addMoreExplanation(offset, " total consumption (%f m3)", total_water_consumption_m3_);
     }
-    if(findKey(MeasurementType::Unknown, ValueInformation::FlowTemperature, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Unknown, ValueInformation::FlowTemperature, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &flow_temperature_);
         t->addMoreExplanation(offset, " water temperature (%f °C)", flow_temperature_);
     }
-    if(findKey(MeasurementType::Unknown, ValueInformation::VolumeFlow, 0, 0, &key, &t->values)) {
+    if(findKey(MeasurementType::Unknown, ValueInformation::VolumeFlow, 0, 0, &key, t)) {
         extractDVdouble(&t->values, key, &offset, &current_flow_m3h_);
         t->addMoreExplanation(offset, " current flow (%f m3/h)", current_flow_m3h_);
     }
@@ -28,6 +28,81 @@
 #include<numeric>
 #include<time.h>
 #include<cmath>
+#include<list>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<unordered_map>
+
+// A bounded set of telegram ids (the comma separated dll,tpl ids) that are known
+// to not match any meter or template. When full, the least recently seen ids are evicted.
+struct NegativeIdCache
+{
+    bool contains(const string &ids)
+    {
+        auto i = index_.find(ids);
+        if (i == index_.end())
+        {
+            misses_++;
+            return false;
+        }
+        // Move to the front, this id is still heard.
+        lru_.splice(lru_.begin(), lru_, i->second);
+        hits_++;
+        return true;
+    }
+
+    void add(const string &ids)
+    {
+        if (index_.count(ids) > 0) return;
+        lru_.push_front(ids);
+        index_[ids] = lru_.begin();
+        if (lru_.size() > capacity_)
+        {
+            index_.erase(lru_.back());
+            lru_.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        lru_.clear();
+        index_.clear();
+    }
+
+    // Forget the ids that a new meter or template would accept.
+    void removeMatching(const IdMatcher &matcher)
+    {
+        for (auto i = lru_.begin(); i != lru_.end();)
+        {
+            bool used_wildcard = false;
+            if (matcher.matches(splitString(*i, ','), &used_wildcard))
+            {
+                index_.erase(*i);
+                i = lru_.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    size_t size() { return lru_.size(); }
+    size_t hits() { return hits_; }
+    size_t misses() { return misses_; }
+
+    NegativeIdCache(size_t capacity) : capacity_(capacity) {}
+
+private:
+    size_t capacity_ {};
+    size_t hits_ {};
+    size_t misses_ {};
+    list<string> lru_;
+    unordered_map<string,list<string>::iterator> index_;
+};
+
+// The number of spill files kept for each meter allowed by --maxmeters.
+#define MAX_SPILL_FILES_PER_METER 10
 
 struct MeterManagerImplementation : public virtual MeterManager
 {
@@ -35,34 +110,341 @@ private:
     bool is_daemon_ {};
     vector<MeterInfo> meter_templates_;
     vector<shared_ptr<Meter>> meters_;
-    function<void(AboutTelegram&,vector<uchar>)> on_telegram_;
+    // Meters that only listen to exact ids are indexed on the 32 bit binary id,
+    // so that a telegram is only handed to the meters that can possibly match it.
+    unordered_map<uint32_t,vector<shared_ptr<Meter>>> meters_by_id_;
+    // Meters using wildcards or negations (or non-standard ids) must see every telegram.
+    vector<shared_ptr<Meter>> wildcard_meters_;
+    // Ids of telegrams from meters we do not own (the neighbours) are remembered here
+    // so that their telegrams can be dropped directly after the header is parsed.
+    // The ids accepted by a new meter or template are removed.
+    NegativeIdCache not_our_ids_ { 1024 };
+    // Indexes are never reused, even when meters are evicted.
+    int num_meters_created_ {};
+    // When max_meters_ is set, then meters created from templates are evicted when
+    // there are too many of them, least recently heard first. If spill_dir_ is set,
+    // then the last telegram of an evicted meter is stored there and replayed into
+    // the meter when it is created again.
+    size_t max_meters_ {};
+    string spill_dir_;
+    // The spill files in spill_dir_, most recently written first. At most
+    // MAX_SPILL_FILES_PER_METER*max_meters_ are kept, the oldest are removed.
+    list<string> spill_lru_;
+    unordered_map<string,list<string>::iterator> spill_files_;
+    struct SpawnedMeter
+    {
+        list<Meter*>::iterator lru;
+        FrameType type {};
+        vector<uchar> last_frame;
+    };
+    list<Meter*> spawned_lru_;
+    unordered_map<Meter*,SpawnedMeter> spawned_;
+    function<void(AboutTelegram&,const vector<uchar>&)> on_telegram_;
     function<void(Telegram*t,Meter*)> on_meter_updated_;
+    // When decode threads are used, the telegrams are sharded over the workers on the meter id.
+    vector<unique_ptr<WorkerThread>> decode_workers_;
+    // Protects the meters, templates and caches above when decode threads are used.
+    RecursiveMutex meters_mutex_ { "meters_mutex" };
+#define LOCK_METERS(where) WITH(meters_mutex_, meters_mutex, where)
+    // Meter updates are printed one at a time.
+    RecursiveMutex print_mutex_ { "print_mutex" };
+#define LOCK_PRINT(where) WITH(print_mutex_, print_mutex, where)
+
+    void indexMeter(shared_ptr<Meter> meter)
+    {
+        vector<uint32_t> bids;
+        for (string &id : meter->ids())
+        {
+            uint32_t bid;
+            if (!idToBinary(id, &bid))
+            {
+                wildcard_meters_.push_back(meter);
+                return;
+            }
+            bids.push_back(bid);
+        }
+        for (uint32_t bid : bids)
+        {
+            vector<shared_ptr<Meter>> &ms = meters_by_id_[bid];
+            if (std::find(ms.begin(), ms.end(), meter) == ms.end()) ms.push_back(meter);
+        }
+    }
+
+    // Collect the meters that might accept a telegram with these ids,
+    // in the same order as they were added.
+    void findCandidateMeters(vector<string> &ids, vector<shared_ptr<Meter>> *candidates)
+    {
+        candidates->insert(candidates->end(), wildcard_meters_.begin(), wildcard_meters_.end());
+        for (string &id : ids)
+        {
+            uint32_t bid;
+            if (!idToBinary(id, &bid)) continue;
+            auto i = meters_by_id_.find(bid);
+            if (i == meters_by_id_.end()) continue;
+            candidates->insert(candidates->end(), i->second.begin(), i->second.end());
+        }
+        std::sort(candidates->begin(), candidates->end(),
+                  [](const shared_ptr<Meter> &a, const shared_ptr<Meter> &b) { return a->index() < b->index(); });
+        candidates->erase(std::unique(candidates->begin(), candidates->end()), candidates->end());
+    }
+
+    void unindexMeter(Meter *meter)
+    {
+        auto is_meter = [meter](shared_ptr<Meter> &m) { return m.get() == meter; };
+        wildcard_meters_.erase(std::remove_if(wildcard_meters_.begin(), wildcard_meters_.end(), is_meter), wildcard_meters_.end());
+        for (string &id : meter->ids())
+        {
+            uint32_t bid;
+            if (!idToBinary(id, &bid)) continue;
+            auto i = meters_by_id_.find(bid);
+            if (i == meters_by_id_.end()) continue;
+            vector<shared_ptr<Meter>> &ms = i->second;
+            ms.erase(std::remove_if(ms.begin(), ms.end(), is_meter), ms.end());
+            if (ms.size() == 0) meters_by_id_.erase(i);
+        }
+    }
+
+    string spillFile(Meter *meter)
+    {
+        return spill_dir_+"/"+meter->idsc();
+    }
+
+    // Remember that the spill file with this name has just been written,
+    // then remove the oldest spill files until we are within the limit.
+    void addSpillFile(const string &name)
+    {
+        auto i = spill_files_.find(name);
+        if (i != spill_files_.end())
+        {
+            spill_lru_.splice(spill_lru_.begin(), spill_lru_, i->second);
+        }
+        else
+        {
+            spill_lru_.push_front(name);
+            spill_files_[name] = spill_lru_.begin();
+        }
+        while (spill_lru_.size() > MAX_SPILL_FILES_PER_METER*max_meters_)
+        {
+            string file = spill_dir_+"/"+spill_lru_.back();
+            debug("(meter) removing oldest spill file %s\n", file.c_str());
+            unlink(file.c_str());
+            spill_files_.erase(spill_lru_.back());
+            spill_lru_.pop_back();
+        }
+    }
+
+    void removeSpillFile(const string &name)
+    {
+        auto i = spill_files_.find(name);
+        if (i == spill_files_.end()) return;
+        spill_lru_.erase(i->second);
+        spill_files_.erase(i);
+    }
+
+    // Spill files left by an earlier run count towards the limit, oldest first.
+    void loadSpillFiles()
+    {
+        vector<string> names;
+        listFiles(spill_dir_, &names);
+        vector<pair<time_t,string>> files;
+        for (string &name : names)
+        {
+            struct stat info;
+            if (stat((spill_dir_+"/"+name).c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+            files.push_back({ info.st_mtime, name });
+        }
+        std::sort(files.begin(), files.end());
+        for (auto &f : files) addSpillFile(f.second);
+    }
+
+    // The spill file starts with this line, a spill written for another template or driver is not restored.
+    string spillHeader(Meter *meter)
+    {
+        return meter->name()+"\t"+toString(meter->driver())+"\n";
+    }
+
+    // Remember that this template created meter has just handled a telegram.
+    void touchSpawnedMeter(Meter *meter, AboutTelegram &about, const vector<uchar> &frame)
+    {
+        auto i = spawned_.find(meter);
+        if (i == spawned_.end()) return;
+        spawned_lru_.splice(spawned_lru_.begin(), spawned_lru_, i->second.lru);
+        i->second.type = about.type;
+        i->second.last_frame = frame;
+    }
+
+    // Evict the least recently heard template created meters until we are within the limit.
+    void evictMeters()
+    {
+        while (max_meters_ > 0 && spawned_.size() > max_meters_)
+        {
+            Meter *meter = spawned_lru_.back();
+            SpawnedMeter &sm = spawned_[meter];
+
+            if (spill_dir_ != "" && sm.last_frame.size() > 0)
+            {
+                // The spill is the header line, the frame type and then the raw frame.
+                string file = spillFile(meter);
+                FILE *f = fopen(file.c_str(), "w");
+                if (f)
+                {
+                    string header = spillHeader(meter);
+                    fwrite(header.c_str(), 1, header.length(), f);
+                    fputc((int)sm.type, f);
+                    fwrite(&sm.last_frame[0], 1, sm.last_frame.size(), f);
+                    fclose(f);
+                    addSpillFile(meter->idsc());
+                }
+                else
+                {
+                    warning("(meter) could not write spill file %s\n", file.c_str());
+                }
+            }
+            debug("(meter) evicting meter %d (%s %s)\n", meter->index(), meter->name().c_str(), meter->idsc().c_str());
+
+            spawned_lru_.pop_back();
+            spawned_.erase(meter);
+            unindexMeter(meter);
+            meters_.erase(std::remove_if(meters_.begin(), meters_.end(),
+                                         [meter](shared_ptr<Meter> &m) { return m.get() == meter; }),
+                          meters_.end());
+        }
+    }
+
+    // Restore the state of a recreated meter from the spilled telegram of the evicted meter.
+    // The telegram is not handled again, ie it is not logged, printed or counted as an update.
+    void restoreSpilledMeter(shared_ptr<Meter> meter)
+    {
+        if (spill_dir_ == "") return;
+        string file = spillFile(meter.get());
+        if (!checkFileExists(file.c_str())) return;
+
+        vector<char> buf;
+        loadFile(file, &buf);
+        unlink(file.c_str());
+        removeSpillFile(meter->idsc());
+
+        string header = spillHeader(meter.get());
+        if (buf.size() < header.length()+2 || !std::equal(header.begin(), header.end(), buf.begin()))
+        {
+            debug("(meter) ignoring spill file %s written for another meter\n", file.c_str());
+            return;
+        }
+
+        AboutTelegram about("", 0, (FrameType)buf[header.length()]);
+        vector<uchar> frame(buf.begin()+header.length()+1, buf.end());
+        Telegram t;
+        t.about = about;
+        if (!t.parseHeader(frame)) return;
+
+        if (meter->restoreState(t, frame))
+        {
+            debug("(meter) restored meter %s from spill file\n", meter->idsc().c_str());
+        }
+    }
+
+    // Return true if any meter or template listens to any of the telegram ids.
+    // Unlike isTelegramForMeter this only looks at the ids, not the driver.
+    bool anyIdMatch(const Telegram &t, vector<shared_ptr<Meter>> &candidates)
+    {
+        bool uw = false;
+        for (auto &m : candidates)
+        {
+            if (m->idMatcher().matches(t.ids, &uw)) return true;
+        }
+        for (auto &mi : meter_templates_)
+        {
+            if (mi.id_matcher.matches(t.ids, &uw)) return true;
+        }
+        return false;
+    }
 
 public:
     void addMeterTemplate(MeterInfo &mi)
     {
+        LOCK_METERS(addMeterTemplate);
+
         meter_templates_.push_back(mi);
+        not_our_ids_.removeMatching(mi.id_matcher);
     }
 
     void addMeter(shared_ptr<Meter> meter)
     {
+        LOCK_METERS(addMeter);
+
         meters_.push_back(meter);
-        meter->setIndex(meters_.size());
-        meter->onUpdate(on_meter_updated_);
+        meter->setIndex(++num_meters_created_);
+        function<void(Telegram*,Meter*)> cb = on_meter_updated_;
+        meter->onUpdate([this, cb](Telegram *t, Meter *m)
+                        {
+                            LOCK_PRINT(onUpdate);
+                            if (cb) cb(t, m);
+                        });
+        indexMeter(meter);
+        not_our_ids_.removeMatching(meter->idMatcher());
     }
 
     Meter *lastAddedMeter()
     {
+        LOCK_METERS(lastAddedMeter);
+
         return meters_.back().get();
     }
 
     void removeAllMeters()
     {
+        // Finish the telegrams already posted to the decode threads.
+        decode_workers_.clear();
+
+        LOCK_METERS(removeAllMeters);
+
+        meters_by_id_.clear();
+        wildcard_meters_.clear();
         meters_.clear();
+        not_our_ids_.clear();
+        spawned_lru_.clear();
+        spawned_.clear();
+        num_meters_created_ = 0;
+    }
+
+    void limitMeters(size_t max_meters, string spill_dir)
+    {
+        max_meters_ = max_meters;
+        spill_dir_ = spill_dir;
+        spill_lru_.clear();
+        spill_files_.clear();
+        if (max_meters_ > 0 && spill_dir_ != "") loadSpillFiles();
+    }
+
+    void useDecodeThreads(int n)
+    {
+        decode_workers_.clear();
+        for (int i = 0; i < n; ++i)
+        {
+            decode_workers_.push_back(unique_ptr<WorkerThread>(new WorkerThread("decode_thread", 1000)));
+        }
+    }
+
+    void waitForDecodeThreads()
+    {
+        for (auto &w : decode_workers_)
+        {
+            w->drain();
+        }
+    }
+
+    void negativeIdCacheStats(size_t *hits, size_t *misses)
+    {
+        LOCK_METERS(negativeIdCacheStats);
+
+        *hits = not_our_ids_.hits();
+        *misses = not_our_ids_.misses();
     }
 
     void forEachMeter(std::function<void(Meter*)> cb)
     {
+        LOCK_METERS(forEachMeter);
+
         for (auto &meter : meters_)
         {
             cb(meter.get());
@@ -71,6 +453,8 @@ public:
 
     bool hasAllMetersReceivedATelegram()
     {
+        LOCK_METERS(hasAllMetersReceivedATelegram);
+
         for (auto &meter : meters_)
         {
             if (meter->numUpdates() == 0) return false;
@@ -81,15 +465,17 @@ public:
 
     bool hasMeters()
     {
+        LOCK_METERS(hasMeters);
+
         return meters_.size() != 0 || meter_templates_.size() != 0;
     }
 
-    void warnForUnknownDriver(string name, Telegram *t)
+    void warnForUnknownDriver(string name, const Telegram *t)
     {
         int mfct = t->dll_mfct;
         int media = t->dll_type;
         int version = t->dll_version;
-        uchar *id_b = t->dll_id_b;
+        const uchar *id_b = t->dll_id_b;
 
         if (t->tpl_id_found)
         {
@@ -104,7 +490,7 @@ public:
                 name.c_str(),
                 id_b[3], id_b[2], id_b[1], id_b[0],
                 manufacturerFlag(mfct).c_str(),
-                manufacturer(mfct).c_str(),
+                manufacturer(mfct),
                 mfct,
                 mediaType(media, mfct).c_str(), media,
                 version);
@@ -114,7 +500,7 @@ public:
         warning("(meter) to add support for this unknown mfct,media,version combination\n");
     }
 
-    bool handleTelegram(AboutTelegram &about, vector<uchar> input_frame, bool simulated)
+    bool handleTelegram(AboutTelegram &about, const vector<uchar> &input_frame, bool simulated)
     {
         if (!hasMeters())
         {
@@ -125,33 +511,88 @@ public:
             return true;
         }
 
+        // Parse the header once, it is shared by all meters and templates.
+        if (decode_workers_.size() == 0)
+        {
+            // Without decode threads the header telegram lives on the stack.
+            Telegram t;
+            t.about = about;
+            bool ok = t.parseHeader(input_frame);
+            if (simulated) t.markAsSimulated();
+            return handleParsedTelegram(t, ok, input_frame);
+        }
+
+        // The header telegram is shared with the decode thread, allocated together with its count.
+        shared_ptr<Telegram> t = std::make_shared<Telegram>();
+        t->about = about;
+        bool ok = t->parseHeader(input_frame);
+        if (simulated) t->markAsSimulated();
+
+        // Hand the telegram to the decode thread owning the meter id. A meter created
+        // from a template gets the last id of the telegram, therefore shard on that id.
+        size_t shard = ok ? std::hash<string>()(t->ids.back()) % decode_workers_.size() : 0;
+        // The frame is copied once into the posted work, it is owned by the caller.
+        decode_workers_[shard]->post([this, t, ok, input_frame]()
+                                     {
+                                         handleParsedTelegram(*t, ok, input_frame);
+                                     });
+        // It is not yet known if any meter will handle the telegram.
+        return false;
+    }
+
+    bool handleParsedTelegram(Telegram &t, bool ok, const vector<uchar> &input_frame)
+    {
         bool handled = false;
         bool exact_id_match = false;
 
-        string ids;
-        for (auto &m : meters_)
+        // Only the meters that listen to any of the telegram ids
+        // (or use wildcards) are asked.
+        string ids = t.idsc;
+        vector<shared_ptr<Meter>> candidates;
+        if (ok)
         {
-            bool h = m->handleTelegram(about, input_frame, simulated, &ids, &exact_id_match);
-            if (h) handled = true;
+            {
+                LOCK_METERS(handleTelegram);
+
+                if (not_our_ids_.contains(t.idsc))
+                {
+                    debug("(meter) telegram from %s dropped, it is known to not match any meter.\n", ids.c_str());
+                    return false;
+                }
+                findCandidateMeters(t.ids, &candidates);
+            }
+            for (auto &m : candidates)
+            {
+                bool h = m->handleTelegram(t, input_frame, &ids, &exact_id_match);
+                if (h)
+                {
+                    handled = true;
+                    if (max_meters_ > 0)
+                    {
+                        LOCK_METERS(handleTelegram);
+                        touchSpawnedMeter(m.get(), t.about, input_frame);
+                    }
+                }
+            }
         }
 
         // If not properly handled, and there was no exact id match.
         // then lets check if there is a template that can create a meter for it.
+        vector<shared_ptr<Meter>> created;
         if (!handled && !exact_id_match)
         {
+            LOCK_METERS(handleTelegram);
+
             debug("(meter) no meter handled %s checking %d templates.\n", ids.c_str(), meter_templates_.size());
             // Not handled, maybe we have a template to create a new meter instance for this telegram?
-            Telegram t;
-            t.about = about;
-            bool ok = t.parseHeader(input_frame);
-            if (simulated) t.markAsSimulated();
-
             if (ok)
             {
                 ids = t.idsc;
                 for (auto &mi : meter_templates_)
                 {
-                    if (MeterCommonImplementation::isTelegramForMeter(&t, NULL, &mi))
+                    // The created meter matches the telegram again and tracks its own warnings.
+                    bool triggered_warning = false;
+                    if (MeterCommonImplementation::isTelegramForMeter(&t, NULL, &mi, &triggered_warning))
                     {
                         // We found a match, make a copy of the meter info.
                         MeterInfo tmp = mi;
@@ -177,7 +618,13 @@ public:
                         }
                         // Now build a meter object with for this exact id.
                         auto meter = createMeter(&tmp);
+                        restoreSpilledMeter(meter);
                         addMeter(meter);
+                        if (max_meters_ > 0)
+                        {
+                            spawned_lru_.push_front(meter.get());
+                            spawned_[meter.get()].lru = spawned_lru_.begin();
+                        }
                         string idsc = toIdsCommaSeparated(t.ids);
                         verbose("(meter) used meter template %s %s %s to match %s\n",
                                 mi.name.c_str(),
@@ -201,33 +648,53 @@ public:
                                    tmp.idsc.c_str(),
                                    toString(mi.driver).c_str());
                         }
-
-                        bool match = false;
-                        bool h = meter->handleTelegram(about, input_frame, simulated, &ids, &match);
-                        if (!match)
-                        {
-                            // Oups, we added a new meter object tailored for this telegram
-                            // but it still did not match! This is probably an error in wmbusmeters!
-                            warning("(meter) newly created meter (%s %s %s) did not match telegram! ",
-                                    "Please open an issue at https://github.com/weetmuts/wmbusmeters/\n",
-                                    meter->name().c_str(), meter->idsc().c_str(), toString(meter->driver()).c_str());
-                        }
-                        else if (!h)
-                        {
-                            // Oups, we added a new meter object tailored for this telegram
-                            // but it still did not handle it! This can happen if the wrong
-                            // decryption key was used.
-                            warning("(meter) newly created meter (%s %s %s) did not handle telegram!\n",
-                                    meter->name().c_str(), meter->idsc().c_str(), toString(meter->driver()).c_str());
-                        }
-                        else
-                        {
-                            handled = true;
-                        }
+                        created.push_back(meter);
                     }
                 }
             }
         }
+
+        // Like the candidates above, the new meters handle the telegram without the meters lock.
+        // An update is printed under the print lock and the print callback can take the meters lock.
+        for (auto &meter : created)
+        {
+            bool match = false;
+            bool h = meter->handleTelegram(t, input_frame, &ids, &match);
+            if (!match)
+            {
+                // Oups, we added a new meter object tailored for this telegram
+                // but it still did not match! This is probably an error in wmbusmeters!
+                warning("(meter) newly created meter (%s %s %s) did not match telegram! ",
+                        "Please open an issue at https://github.com/weetmuts/wmbusmeters/\n",
+                        meter->name().c_str(), meter->idsc().c_str(), toString(meter->driver()).c_str());
+            }
+            else if (!h)
+            {
+                // Oups, we added a new meter object tailored for this telegram
+                // but it still did not handle it! This can happen if the wrong
+                // decryption key was used.
+                warning("(meter) newly created meter (%s %s %s) did not handle telegram!\n",
+                        meter->name().c_str(), meter->idsc().c_str(), toString(meter->driver()).c_str());
+            }
+            else
+            {
+                handled = true;
+                if (max_meters_ > 0)
+                {
+                    LOCK_METERS(handleTelegram);
+                    touchSpawnedMeter(meter.get(), t.about, input_frame);
+                }
+            }
+        }
+
+        LOCK_METERS(handleTelegram);
+
+        if (ok && !handled && !anyIdMatch(t, candidates))
+        {
+            not_our_ids_.add(t.idsc);
+        }
+        // Evict after the candidates are no longer used.
+        evictMeters();
         if (isVerboseEnabled() && !handled)
         {
             verbose("(wmbus) telegram from %s ignored by all configured meters!\n", ids.c_str());
@@ -235,7 +702,7 @@ public:
         return handled;
     }
 
-    void onTelegram(function<void(AboutTelegram &about, vector<uchar>)> cb)
+    void onTelegram(function<void(AboutTelegram &about, const vector<uchar>&)> cb)
     {
         on_telegram_ = cb;
     }
@@ -247,14 +714,25 @@ public:
 
     void pollMeters(shared_ptr<BusManager> bus)
     {
-        for (auto &m : meters_)
+        // Poll outside of the lock, a meter can be evicted meanwhile.
+        vector<shared_ptr<Meter>> meters;
+        {
+            LOCK_METERS(pollMeters);
+
+            meters = meters_;
+        }
+        for (auto &m : meters)
         {
             m->poll(bus);
         }
     }
 
     MeterManagerImplementation(bool daemon) : is_daemon_(daemon) {}
-    ~MeterManagerImplementation() {}
+    ~MeterManagerImplementation()
+    {
+        // The decode threads must finish before the meters and locks go away.
+        decode_workers_.clear();
+    }
 };
 
 shared_ptr<MeterManager> createMeterManager(bool daemon)
@@ -268,6 +746,7 @@ MeterCommonImplementation::MeterCommonImplementation(MeterInfo &mi,
 {
     ids_ = mi.ids;
     idsc_ = toIdsCommaSeparated(ids_);
+    id_matcher_ = IdMatcher(ids_);
 
     if (mi.key.length() > 0)
     {
@@ -358,6 +837,11 @@ string MeterCommonImplementation::idsc()
     return idsc_;
 }
 
+const IdMatcher &MeterCommonImplementation::idMatcher()
+{
+    return id_matcher_;
+}
+
 vector<string> MeterCommonImplementation::fields()
 {
     return fields_;
@@ -383,6 +867,16 @@ int MeterCommonImplementation::numUpdates()
     return num_updates_;
 }
 
+int MeterCommonImplementation::numDecryptionFailures()
+{
+    return num_decryption_failures_;
+}
+
+int MeterCommonImplementation::numDecryptionSkipped()
+{
+    return num_decryption_skipped_;
+}
+
 string MeterCommonImplementation::datetimeOfUpdateHumanReadable()
 {
     char datetime[40];
@@ -440,35 +934,23 @@ LIST_OF_METERS
     return LinkModeSet();
 }
 
-bool MeterCommonImplementation::isTelegramForMeter(Telegram *t, Meter *meter, MeterInfo *mi)
+bool MeterCommonImplementation::isTelegramForMeter(const Telegram *t, Meter *meter, MeterInfo *mi, bool *triggered_warning)
 {
-    string name;
-    vector<string> ids;
-    string idsc;
-    MeterDriver driver;
-
     assert((meter && !mi) ||
            (!meter && mi));
 
-    if (meter)
-    {
-        name = meter->name();
-        ids = meter->ids();
-        idsc = meter->idsc();
-        driver = meter->driver();
-    }
-    else
+    string name = meter ? meter->name() : mi->name;
+    MeterDriver driver = meter ? meter->driver() : mi->driver;
+    const IdMatcher &id_matcher = meter ? meter->idMatcher() : mi->id_matcher;
+
+    if (isDebugEnabled())
     {
-        name = mi->name;
-        ids = mi->ids;
-        idsc = mi->idsc;
-        driver = mi->driver;
+        string idsc = meter ? meter->idsc() : mi->idsc;
+        debug("(meter) %s: for me? %s in %s\n", name.c_str(), t->idsc.c_str(), idsc.c_str());
     }
 
-    debug("(meter) %s: for me? %s in %s\n", name.c_str(), t->idsc.c_str(), idsc.c_str());
-
     bool used_wildcard = false;
-    bool id_match = doesIdsMatchExpressions(t->ids, ids, &used_wildcard);
+    bool id_match = id_matcher.matches(t->ids, &used_wildcard);
 
     if (!id_match) {
         // The id must match.
@@ -501,7 +983,7 @@ bool MeterCommonImplementation::isTelegramForMeter(Telegram *t, Meter *meter, Me
         // The match was exact, ie the user has actually specified 12345678 and foo as driver even
         // though they do not match. Lets warn and then proceed. It is common that a user tries a
         // new version of a meter with the old driver, thus it might not be a real error.
-        if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(t, t->dll_a))
+        if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(triggered_warning, t->dll_a))
         {
             string possible_drivers = t->autoDetectPossibleDrivers();
             warning("(meter) %s: meter detection did not match the selected driver %s! correct driver is: %s\n"
@@ -511,7 +993,7 @@ bool MeterCommonImplementation::isTelegramForMeter(Telegram *t, Meter *meter, Me
                     possible_drivers.c_str(),
                     t->dll_id_b[3], t->dll_id_b[2], t->dll_id_b[1], t->dll_id_b[0],
                     manufacturerFlag(t->dll_mfct).c_str(),
-                    manufacturer(t->dll_mfct).c_str(),
+                    manufacturer(t->dll_mfct),
                     t->dll_mfct,
                     mediaType(t->dll_type, t->dll_mfct).c_str(), t->dll_type,
                     t->dll_version);
@@ -698,37 +1180,71 @@ string concatFields(Meter *m, Telegram *t, char c, vector<Print> &prints, vector
     return s;
 }
 
-bool MeterCommonImplementation::handleTelegram(AboutTelegram &about, vector<uchar> input_frame, bool simulated, string *ids, bool *id_match)
+bool MeterCommonImplementation::handleTelegram(const Telegram &header, const vector<uchar> &input_frame, string *ids, bool *id_match)
 {
-    Telegram t;
-    t.about = about;
-    bool ok = t.parseHeader(input_frame);
+    *ids = header.idsc;
 
-    if (simulated) t.markAsSimulated();
-
-    *ids = t.idsc;
-
-    if (!ok || !isTelegramForMeter(&t, this, NULL))
+    // The header is shared by all meters and is not written to, warnings
+    // triggered while matching are tracked per meter, as if each meter had parsed its own header.
+    bool triggered_warning = false;
+    if (!isTelegramForMeter(&header, this, NULL, &triggered_warning))
     {
         // This telegram is not intended for this meter.
         return false;
     }
 
     *id_match = true;
-    verbose("(meter) %s %s handling telegram from %s\n", name().c_str(), meterDriver().c_str(), t.ids.back().c_str());
+    WITH(telegram_mutex_, telegram_mutex, handleTelegram);
+
+    // A wildcard meter also hears neighbours with keys we do not have,
+    // the backoff is therefore kept for each id.
+    const string &id = header.ids.back();
+    auto backoff = decryption_backoff_.find(id);
+    if (backoff != decryption_backoff_.end() && backoff->second.skipped < backoff->second.skip)
+    {
+        // The key has failed too many times, do not waste time parsing and decrypting.
+        DecryptionBackoff &b = backoff->second;
+        b.skipped++;
+        num_decryption_skipped_++;
+        debug("(meter) %s %s dropped telegram, waiting %d more telegrams before trying the key again\n",
+              name().c_str(), id.c_str(), b.skip-b.skipped);
+        return false;
+    }
+
+    verbose("(meter) %s %s handling telegram from %s\n", name().c_str(), meterDriver().c_str(), id.c_str());
 
     if (isDebugEnabled())
     {
         string msg = bin2hex(input_frame);
-        debug("(meter) %s %s \"%s\"\n", name().c_str(), t.ids.back().c_str(), msg.c_str());
+        debug("(meter) %s %s \"%s\"\n", name().c_str(), header.ids.back().c_str(), msg.c_str());
     }
 
-    ok = t.parse(input_frame, &meter_keys_, true);
+    // Only the meter that matched the header parses the full telegram.
+    Telegram t;
+    t.about = header.about;
+    if (header.isSimulated()) t.markAsSimulated();
+    // Remember if the header matching already triggered warnings for this telegram.
+    t.triggered_warning = triggered_warning;
+    // The explanations are only printed when debugging.
+    t.enableExplanations(isDebugEnabled());
+
+    bool ok = t.parse(input_frame, &meter_keys_, true);
     if (!ok)
     {
+        if (t.decryption_failed) decryptionFailed(id);
         // Ignoring telegram since it could not be parsed.
         return false;
     }
+    if (backoff != decryption_backoff_.end())
+    {
+        if (backoff->second.skip > 0)
+        {
+            verbose("(meter) %s %s the key works again after %d failed telegrams\n",
+                    name().c_str(), id.c_str(), backoff->second.consecutive_failures);
+        }
+        decryption_backoff_lru_.erase(backoff->second.lru);
+        decryption_backoff_.erase(backoff);
+    }
 
     char log_prefix[256];
     snprintf(log_prefix, 255, "(%s) log", meterDriver().c_str());
@@ -748,6 +1264,56 @@ bool MeterCommonImplementation::handleTelegram(AboutTelegram &about, vector<ucha
     return true;
 }
 
+bool MeterCommonImplementation::restoreState(const Telegram &header, const vector<uchar> &input_frame)
+{
+    WITH(telegram_mutex_, telegram_mutex, restoreState);
+
+    Telegram t;
+    t.about = header.about;
+    // Do not warn, the telegram was already warned about when it was received.
+    bool ok = t.parse(input_frame, &meter_keys_, false);
+    if (!ok) return false;
+
+    processContent(&t);
+    return true;
+}
+
+#define MAX_CONSECUTIVE_DECRYPTION_FAILURES 3
+#define MAX_SKIPPED_TELEGRAMS 256
+#define MAX_DECRYPTION_BACKOFF_IDS 256
+
+void MeterCommonImplementation::decryptionFailed(const string &id)
+{
+    auto i = decryption_backoff_.find(id);
+    if (i == decryption_backoff_.end())
+    {
+        if (decryption_backoff_.size() >= MAX_DECRYPTION_BACKOFF_IDS)
+        {
+            // Forget the id that failed longest ago.
+            decryption_backoff_.erase(decryption_backoff_lru_.back());
+            decryption_backoff_lru_.pop_back();
+        }
+        decryption_backoff_lru_.push_front(id);
+        i = decryption_backoff_.insert({ id, DecryptionBackoff() }).first;
+        i->second.lru = decryption_backoff_lru_.begin();
+    }
+    else
+    {
+        decryption_backoff_lru_.splice(decryption_backoff_lru_.begin(), decryption_backoff_lru_, i->second.lru);
+    }
+    DecryptionBackoff &b = i->second;
+    num_decryption_failures_++;
+    b.consecutive_failures++;
+    b.skipped = 0;
+    if (b.consecutive_failures < MAX_CONSECUTIVE_DECRYPTION_FAILURES) return;
+
+    // Back off exponentially, the key is tried again after 1, 2, 4... skipped telegrams.
+    b.skip = b.skip == 0 ? 1 : b.skip*2;
+    if (b.skip > MAX_SKIPPED_TELEGRAMS) b.skip = MAX_SKIPPED_TELEGRAMS;
+    verbose("(meter) %s %s decryption failed %d times in a row, skipping %d telegrams before trying again\n",
+            name().c_str(), id.c_str(), b.consecutive_failures, b.skip);
+}
+
 void MeterCommonImplementation::printMeter(Telegram *t,
                                            string *human_readable,
                                            string *fields, char separator,
@@ -773,61 +1339,62 @@ void MeterCommonImplementation::printMeter(Telegram *t,
         media = mediaTypeJSON(t->dll_type, t->dll_mfct);
     }
 
-    string s;
-    s += "{";
-    s += "\"media\":\""+media+"\",";
-    s += "\"meter\":\""+meterDriver()+"\",";
-    s += "\"name\":\""+name()+"\",";
-    if (t->ids.size() > 0)
-    {
-        s += "\"id\":\""+t->ids.back()+"\",";
-    }
-    else
-    {
-        s += "\"id\":\"\",";
-    }
-    for (Print p : prints_)
+    // The json is written straight into the METER_JSON env variable, the json is then a copy of it.
+    envs->push_back("METER_JSON=");
+    string &s = envs->back();
+    s.reserve(json_size_hint_);
+    size_t start = s.length();
+    JsonWriter w(&s);
+    w.beginObject();
+    w.key("media");
+    w.value(media);
+    w.key("meter");
+    w.value(meterDriver());
+    w.key("name");
+    w.value(name());
+    w.key("id");
+    w.value(t->ids.size() > 0 ? t->ids.back() : string());
+    for (Print &p : prints_)
     {
         if (p.json)
         {
-            string default_unit = unitToStringLowerCase(p.default_unit);
-            string var = p.vname;
             if (p.getValueString) {
-                s += "\""+var+"\":\""+p.getValueString()+"\",";
+                w.key(p.vname);
+                w.value(p.getValueString());
             }
             if (p.getValueDouble) {
-                s += "\""+var+"_"+default_unit+"\":"+valueToString(p.getValueDouble(p.default_unit), p.default_unit)+",";
+                w.key(p.vname, unitToStringLowerCase(p.default_unit).c_str());
+                w.value(p.getValueDouble(p.default_unit));
 
                 Unit u = replaceWithConversionUnit(p.default_unit, conversions_);
                 if (u != p.default_unit)
                 {
-                    string unit = unitToStringLowerCase(u);
-                    s += "\""+var+"_"+unit+"\":"+valueToString(p.getValueDouble(u), u)+",";
+                    w.key(p.vname, unitToStringLowerCase(u).c_str());
+                    w.value(p.getValueDouble(u));
                 }
             }
         }
     }
-    s += "\"timestamp\":\""+datetimeOfUpdateRobot()+"\"";
+    w.key("timestamp");
+    w.value(datetimeOfUpdateRobot());
     if (t->about.device != "")
     {
-        s += ",";
-        s += "\"device\":\""+t->about.device+"\",";
-        s += "\"rssi_dbm\":"+to_string(t->about.rssi_dbm);
+        w.key("device");
+        w.value(t->about.device);
+        w.key("rssi_dbm");
+        w.value(t->about.rssi_dbm);
     }
-    for (string add_json : additionalJsons())
+    for (string &add_json : additionalJsons())
     {
-        s += ",";
-        s += makeQuotedJson(add_json);
+        w.keyValue(add_json);
     }
-    for (string add_json : *more_json)
+    for (string &add_json : *more_json)
     {
-        s += ",";
-        s += makeQuotedJson(add_json);
+        w.keyValue(add_json);
     }
-    s += "}";
-    *json = s;
-
-    envs->push_back(string("METER_JSON=")+*json);
+    w.endObject();
+    json_size_hint_ = s.length();
+    json->assign(s, start, string::npos);
     if (t->ids.size() > 0)
     {
         envs->push_back(string("METER_ID=")+t->ids.back());
@@ -846,7 +1413,7 @@ void MeterCommonImplementation::printMeter(Telegram *t,
         envs->push_back(string("METER_RSSI_DBM=")+to_string(t->about.rssi_dbm));
     }
 
-    for (Print p : prints_)
+    for (Print &p : prints_)
     {
         if (p.json)
         {
@@ -874,11 +1441,11 @@ void MeterCommonImplementation::printMeter(Telegram *t,
 
     // If the configuration has supplied json_address=Roodroad 123
     // then the env variable METER_address will available and have the content "Roodroad 123"
-    for (string add_json : additionalJsons())
+    for (string &add_json : additionalJsons())
     {
         envs->push_back(string("METER_")+add_json);
     }
-    for (string add_json : *more_json)
+    for (string &add_json : *more_json)
     {
         envs->push_back(string("METER_")+add_json);
     }
@@ -942,39 +1509,85 @@ ELLSecurityMode MeterCommonImplementation::expectedELLSecurityMode()
     return expected_ell_sec_mode_;
 }
 
-void detectMeterDrivers(int manufacturer, int media, int version, vector<string> *drivers)
+static uint32_t meterDetectionKey(int manufacturer, int media, int version)
+{
+    return ((uint32_t)manufacturer << 16) | ((media & 0xff) << 8) | (version & 0xff);
+}
+
+// The METER_DETECTION list hashed on manufacturer,media,version. Each key maps to its
+// drivers in list order. A media or version of -1 is expanded into all 256 values when
+// the table is built, so that a lookup is always a single probe. Built once on first use.
+static const unordered_map<uint32_t,vector<MeterDriver>> &meterDetectionTable()
 {
-#define X(TY,MA,ME,VE) { if (manufacturer == MA && (media == ME || ME == -1) && (version == VE || VE == -1)) { drivers->push_back(toString(MeterDriver::TY)); }}
+    static const unordered_map<uint32_t,vector<MeterDriver>> table = []()
+    {
+        unordered_map<uint32_t,vector<MeterDriver>> t;
+        auto add = [&t](MeterDriver driver, int manufacturer, int media, int version)
+        {
+            for (int me = 0; me < 256; ++me)
+            {
+                if (media != -1 && media != me) continue;
+                for (int ve = 0; ve < 256; ++ve)
+                {
+                    if (version != -1 && version != ve) continue;
+                    t[meterDetectionKey(manufacturer, me, ve)].push_back(driver);
+                }
+            }
+        };
+#define X(TY,MA,ME,VE) add(MeterDriver::TY, MA, ME, VE);
 METER_DETECTION
 #undef X
+        return t;
+    }();
+    return table;
+}
+
+static const vector<MeterDriver> *findMeterDetections(int manufacturer, int media, int version)
+{
+    if (manufacturer < 0 || manufacturer > 0xffff ||
+        media < 0 || media > 0xff ||
+        version < 0 || version > 0xff) return NULL;
+
+    const unordered_map<uint32_t,vector<MeterDriver>> &table = meterDetectionTable();
+    auto i = table.find(meterDetectionKey(manufacturer, media, version));
+    if (i == table.end()) return NULL;
+    return &i->second;
+}
+
+void detectMeterDrivers(int manufacturer, int media, int version, vector<string> *drivers)
+{
+    const vector<MeterDriver> *found = findMeterDetections(manufacturer, media, version);
+    if (found == NULL) return;
+
+    for (MeterDriver d : *found)
+    {
+        drivers->push_back(toString(d));
+    }
 }
 
 bool isMeterDriverValid(MeterDriver type, int manufacturer, int media, int version)
 {
-#define X(TY,MA,ME,VE) { if (type == MeterDriver::TY && manufacturer == MA && (media == ME || ME == -1) && (version == VE || VE == -1)) { return true; }}
-METER_DETECTION
-#undef X
+    const vector<MeterDriver> *found = findMeterDetections(manufacturer, media, version);
+    if (found == NULL) return false;
 
-    return false;
+    return find(found->begin(), found->end(), type) != found->end();
 }
 
-MeterDriver pickMeterDriver(Telegram *t)
+MeterDriver pickMeterDriver(int manufacturer, int media, int version)
 {
-    int manufacturer = t->dll_mfct;
-    int media = t->dll_type;
-    int version = t->dll_version;
+    const vector<MeterDriver> *found = findMeterDetections(manufacturer, media, version);
+    if (found == NULL) return MeterDriver::UNKNOWN;
+
+    return found->front();
+}
 
+MeterDriver pickMeterDriver(const Telegram *t)
+{
     if (t->tpl_id_found)
     {
-        manufacturer = t->tpl_mfct;
-        media = t->tpl_type;
-        version = t->tpl_version;
+        return pickMeterDriver(t->tpl_mfct, t->tpl_type, t->tpl_version);
     }
-
-#define X(TY,MA,ME,VE) { if (manufacturer == MA && (media == ME || ME == -1) && (version == VE || VE == -1)) { return MeterDriver::TY; }}
-METER_DETECTION
-#undef X
-    return MeterDriver::UNKNOWN;
+    return pickMeterDriver(t->dll_mfct, t->dll_type, t->dll_version);
 }
 
 shared_ptr<Meter> createMeter(MeterInfo *mi)
@@ -1061,6 +1674,7 @@ bool MeterInfo::parse(string n, string d, string i, string k)
 
     name = n;
     ids = splitMatchExpressions(i);
+    id_matcher = IdMatcher(ids);
     key = k;
     bool driverextras_checked = false;
     bool bus_checked = false;
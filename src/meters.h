@@ -114,7 +114,9 @@ void detectMeterDrivers(int manufacturer, int media, int version, std::vector<st
 // compatible with the driver(type), if not then print a warning.
 bool isMeterDriverValid(MeterDriver type, int manufacturer, int media, int version);
 // Return the best driver match for a telegram.
-MeterDriver pickMeterDriver(Telegram *t);
+MeterDriver pickMeterDriver(const Telegram *t);
+// Return the first driver in the METER_DETECTION list that matches.
+MeterDriver pickMeterDriver(int manufacturer, int media, int version);
 
 bool isValidKey(string& key, MeterDriver mt);
 
@@ -132,6 +134,7 @@ struct MeterInfo
     string extras; // Extra driver specific settings.
     vector<string> ids; // Match expressions for ids.
     string idsc; // Comma separated ids.
+    IdMatcher id_matcher; // The ids compiled for fast matching.
     string key;  // Decryption key.
     LinkModeSet link_modes;
     int bps {};     // For mbus communication you need to know the baud rate.
@@ -158,6 +161,7 @@ struct MeterInfo
         extras = e,
         ids = i;
         idsc = toIdsCommaSeparated(ids);
+        id_matcher = IdMatcher(ids);
         key = k;
         shells = s;
         jsons = j;
@@ -172,6 +176,7 @@ struct MeterInfo
         driver = MeterDriver::UNKNOWN;
         ids.clear();
         idsc = "";
+        id_matcher = IdMatcher();
         key = "";
         shells.clear();
         jsons.clear();
@@ -209,6 +214,8 @@ struct Meter
     virtual vector<string> &ids() = 0;
     // Comma separated ids.
     virtual string idsc() = 0;
+    // The ids compiled for fast matching.
+    virtual const IdMatcher &idMatcher() = 0;
     // This meter can report these fields, like total_m3, temp_c.
     virtual vector<string> fields() = 0;
     virtual vector<Print> prints() = 0;
@@ -221,6 +228,10 @@ struct Meter
 
     virtual void onUpdate(std::function<void(Telegram*t,Meter*)> cb) = 0;
     virtual int numUpdates() = 0;
+    // Telegrams that could not be decrypted.
+    virtual int numDecryptionFailures() = 0;
+    // Telegrams dropped unparsed because the key has failed several times in a row.
+    virtual int numDecryptionSkipped() = 0;
 
     virtual void printMeter(Telegram *t,
                             string *human_readable,
@@ -231,9 +242,15 @@ struct Meter
                             vector<string> *selected_fields) = 0;
 
     // The handleTelegram expects an input_frame where the DLL crcs have been removed.
+    // The header has already been parsed from the input_frame, once, by the meter manager
+    // and is shared by all meters. Only the meter that matches the header will parse the
+    // full telegram, ie decrypt it and extract the values.
     // Returns true of this meter handled this telegram!
     // Sets id_match to true, if there was an id match, even though the telegram could not be properly handled.
-    virtual bool handleTelegram(AboutTelegram &about, vector<uchar> input_frame, bool simulated, string *id, bool *id_match) = 0;
+    virtual bool handleTelegram(const Telegram &header, const vector<uchar> &input_frame, string *id, bool *id_match) = 0;
+    // Restore the meter values from a telegram that was handled before, for example by an evicted meter.
+    // Nothing is logged or printed and it does not count as an update. Returns true if the telegram could be parsed.
+    virtual bool restoreState(const Telegram &header, const vector<uchar> &input_frame) = 0;
     virtual MeterKeys *meterKeys() = 0;
 
     // Dynamically access all data received for the meter.
@@ -256,12 +273,27 @@ struct MeterManager
     virtual Meter*lastAddedMeter() = 0;
     virtual void removeAllMeters() = 0;
     virtual void forEachMeter(std::function<void(Meter*)> cb) = 0;
-    virtual bool handleTelegram(AboutTelegram &about, vector<uchar> data, bool simulated) = 0;
+    virtual bool handleTelegram(AboutTelegram &about, const vector<uchar> &input_frame, bool simulated) = 0;
     virtual bool hasAllMetersReceivedATelegram() = 0;
     virtual bool hasMeters() = 0;
-    virtual void onTelegram(function<void(AboutTelegram&,vector<uchar>)> cb) = 0;
+    virtual void onTelegram(function<void(AboutTelegram&,const vector<uchar>&)> cb) = 0;
     virtual void whenMeterUpdated(std::function<void(Telegram*t,Meter*)> cb) = 0;
     virtual void pollMeters(shared_ptr<BusManager> bus) = 0;
+    // Telegrams from ids that do not match any meter are dropped early,
+    // hits are telegrams dropped and misses are telegrams that had to be checked.
+    virtual void negativeIdCacheStats(size_t *hits, size_t *misses) = 0;
+    // Keep at most max_meters meters created from templates (0 means no limit).
+    // The last telegram of an evicted meter is stored in spill_dir (if not empty)
+    // and is used to restore the meter when it is heard again. At most 10*max_meters
+    // spill files are kept, including those left by an earlier run, the oldest are removed.
+    virtual void limitMeters(size_t max_meters, std::string spill_dir) = 0;
+    // Decode, decrypt and print telegrams in n worker threads, sharded on the meter id.
+    // With n=0 (the default) the telegrams are handled directly in handleTelegram.
+    // With decode threads handleTelegram returns false, since it is not yet known
+    // if any meter will handle the telegram.
+    virtual void useDecodeThreads(int n) = 0;
+    // Wait until all telegrams posted to the decode threads have been handled.
+    virtual void waitForDecodeThreads() = 0;
 
     virtual ~MeterManager() = default;
 };
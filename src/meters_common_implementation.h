@@ -19,8 +19,10 @@
 #define METERS_COMMON_IMPLEMENTATION_H_
 
 #include"meters.h"
+#include"threads.h"
 #include"units.h"
 
+#include<list>
 #include<map>
 #include<set>
 
@@ -31,6 +33,7 @@ struct MeterCommonImplementation : public virtual Meter
     string bus();
     vector<string>& ids();
     string idsc();
+    const IdMatcher &idMatcher();
     vector<string>  fields();
     vector<Print>   prints();
     string name();
@@ -44,8 +47,11 @@ struct MeterCommonImplementation : public virtual Meter
 
     void onUpdate(function<void(Telegram*,Meter*)> cb);
     int numUpdates();
+    int numDecryptionFailures();
+    int numDecryptionSkipped();
 
-    static bool isTelegramForMeter(Telegram *t, Meter *meter, MeterInfo *mi);
+    // Sets *triggered_warning if matching printed a warning for this telegram.
+    static bool isTelegramForMeter(const Telegram *t, Meter *meter, MeterInfo *mi, bool *triggered_warning);
     MeterKeys *meterKeys();
 
     std::vector<std::string> getRecords();
@@ -61,6 +67,7 @@ struct MeterCommonImplementation : public virtual Meter
 protected:
 
     void triggerUpdate(Telegram *t);
+    void decryptionFailed(const string &id);
     void setExpectedELLSecurityMode(ELLSecurityMode dsm);
     void setExpectedTPLSecurityMode(TPLSecurityMode tsm);
     void addConversions(std::vector<Unit> cs);
@@ -81,7 +88,8 @@ protected:
     // The default implementation of poll does nothing.
     // Override for mbus meters that need to be queried and likewise for C2/T2 wmbus-meters.
     void poll(shared_ptr<BusManager> bus);
-    bool handleTelegram(AboutTelegram &about, vector<uchar> frame, bool simulated, string *id, bool *id_match);
+    bool handleTelegram(const Telegram &header, const vector<uchar> &input_frame, string *id, bool *id_match);
+    bool restoreState(const Telegram &header, const vector<uchar> &input_frame);
     void printMeter(Telegram *t,
                     string *human_readable,
                     string *fields, char separator,
@@ -103,12 +111,32 @@ private:
     string name_;
     vector<string> ids_;
     string idsc_;
+    IdMatcher id_matcher_;
     vector<function<void(Telegram*,Meter*)>> on_update_;
     int num_updates_ {};
     time_t datetime_of_update_ {};
+    // A meter with a wrong key keeps failing. After a few failures in a row only
+    // every skip+1 telegram from that id is parsed, the skip doubles for each new failure.
+    struct DecryptionBackoff
+    {
+        int consecutive_failures {};
+        int skip {};
+        int skipped {};
+        list<string>::iterator lru;
+    };
+    int num_decryption_failures_ {};
+    int num_decryption_skipped_ {};
+    // A wildcard meter can hear many neighbours with other keys, the backoff
+    // is only kept for the most recently failed ids.
+    map<string,DecryptionBackoff> decryption_backoff_;
+    list<string> decryption_backoff_lru_;
+    // The length of the last json, to allocate the next one once.
+    size_t json_size_hint_ {};
     LinkModeSet link_modes_ {};
     vector<string> shell_cmdlines_;
     vector<string> jsons_;
+    // A meter can receive telegrams from more than one decode thread, if it has several ids.
+    RecursiveMutex telegram_mutex_ { "telegram_mutex" };
 
 protected:
     std::map<std::string,std::pair<int,std::string>> values_;
@@ -20,12 +20,26 @@
 
 using namespace std;
 
+// Buffer at most this many bytes of json for a pipe shell that is restarting or slow.
+#define MAX_SHELL_PIPE_BUFFER (1024*1024)
+// Keep at most this many meterfiles open, buffer at most this many bytes before writing them.
+#define MAX_OPEN_METERFILES 256
+#define MAX_METERFILES_BUFFER (64*1024)
+
 Printer::Printer(bool json, bool fields, char separator,
                  bool use_meterfiles, string &meterfiles_dir,
                  bool use_logfile, string &logfile,
-                 vector<string> shell_cmdlines, bool overwrite,
+                 vector<string> shell_cmdlines,
+                 vector<string> pipe_shell_cmdlines,
+                 bool overwrite,
                  MeterFileNaming naming,
-                 MeterFileTimestamp timestamp)
+                 MeterFileTimestamp timestamp,
+                 int shell_processes,
+                 int shell_queue)
+    : shell_pool_(shell_processes, shell_queue),
+      // The log file is also written by the logging, do not buffer to keep the lines in order.
+      files_(use_logfile && !use_meterfiles ? 1 : MAX_OPEN_METERFILES,
+             use_logfile && !use_meterfiles ? 0 : MAX_METERFILES_BUFFER)
 {
     json_ = json;
     fields_ = fields;
@@ -35,6 +49,9 @@ Printer::Printer(bool json, bool fields, char separator,
     use_logfile_ = use_logfile;
     logfile_ = logfile;
     shell_cmdlines_ = shell_cmdlines;
+    for (auto &s : pipe_shell_cmdlines) {
+        shell_pipes_.push_back(shared_ptr<ShellPipe>(new ShellPipe(s, MAX_SHELL_PIPE_BUFFER)));
+    }
     overwrite_ = overwrite;
     naming_ = naming;
     timestamp_ = timestamp;
@@ -54,6 +71,12 @@ void Printer::print(Telegram *t, Meter *meter,
         printShells(meter, envs);
         printed = true;
     }
+    if (shell_pipes_.size() > 0) {
+        for (auto &p : shell_pipes_) {
+            p->write(json);
+        }
+        printed = true;
+    }
     if (use_meterfiles_) {
         printFiles(meter, t, human_readable, fields, json);
         printed = true;
@@ -71,17 +94,42 @@ void Printer::printShells(Meter *meter, vector<string> &envs)
     if (meter->shellCmdlines().size() > 0) {
         shells = &meter->shellCmdlines();
     }
+    // The shells for a meter run one at a time in order, shells for different meters run in parallel.
+    string key = meter->name()+" "+meter->idsc();
     for (auto &s : *shells) {
         vector<string> args;
         args.push_back("-c");
         args.push_back(s);
-        invokeShell("/bin/sh", args, envs);
+        shell_pool_.invoke(key, "/bin/sh", args, envs);
     }
 }
 
+void Printer::waitForShells()
+{
+    shell_pool_.drain();
+    shell_pool_.logStats();
+    for (auto &p : shell_pipes_) {
+        p->stop();
+        p->logStats();
+    }
+}
+
+void Printer::flushFiles()
+{
+    files_.flush();
+}
+
+void Printer::closeFiles()
+{
+    files_.closeAll();
+    files_.logStats("printer");
+}
+
 void Printer::printFiles(Meter *meter, Telegram *t, string &human_readable, string &fields, string &json)
 {
-    FILE *output = stdout;
+    string *line = &human_readable;
+    if (json_) line = &json;
+    else if (fields_) line = &fields;
 
     if (use_meterfiles_) {
         char filename[256];
@@ -97,6 +145,9 @@ void Printer::printFiles(Meter *meter, Telegram *t, string &human_readable, stri
             snprintf(filename, 127, "%s/%s-%s", meterfiles_dir_.c_str(), meter->name().c_str(), t->ids.back().c_str());
             break;
         }
+        // The file is cached using the name without timestamp, when the timestamp
+        // changes the file with the old timestamp is closed.
+        string key = filename;
         string stamp;
 
         switch (timestamp_) {
@@ -124,42 +175,10 @@ void Printer::printFiles(Meter *meter, Telegram *t, string &human_readable, stri
             strcat(filename, stamp.c_str());
         }
 
-        const char *mode = overwrite_ ? "w" : "a";
-        output = fopen(filename, mode);
-        if (!output) {
-            warning("Could not open file \"%s\" for writing!\n", filename);
-            return;
-        }
+        files_.write(key, filename, *line+"\n", overwrite_);
     } else if (use_logfile_) {
-        output = fopen(logfile_.c_str(), "a");
-        if (!output) {
-            warning("Could not open file \"%s\" for writing!\n", logfile_.c_str());
-            return;
-        }
-    }
-    if (json_) {
-        if (output) {
-            fprintf(output, "%s\n", json.c_str());
-        } else {
-            notice("%s\n", json.c_str());
-        }
-    }
-    else if (fields_) {
-        if (output) {
-            fprintf(output, "%s\n", fields.c_str());
-        } else {
-            notice("%s\n", fields.c_str());
-        }
-    }
-    else {
-        if (output) {
-            fprintf(output, "%s\n", human_readable.c_str());
-        } else {
-            notice("%s\n", human_readable.c_str());
-        }
-    }
-
-    if (output != stdout && output) {
-        fclose(output);
+        files_.write(logfile_, logfile_, *line+"\n", false);
+    } else {
+        printf("%s\n", line->c_str());
     }
 }
@@ -17,6 +17,7 @@
 
 #include"cmdline.h"
 #include"meters.h"
+#include"shell.h"
 #include"wmbus.h"
 
 using namespace std;
@@ -28,11 +29,20 @@ struct Printer {
             bool meterfiles, string &meterfiles_dir,
             bool use_logfile, string &logfile,
             vector<string> shell_cmdlines,
+            vector<string> pipe_shell_cmdlines,
             bool overwrite,
             MeterFileNaming naming,
-            MeterFileTimestamp timestamp);
+            MeterFileTimestamp timestamp,
+            int shell_processes,
+            int shell_queue);
 
     void print(Telegram *t, Meter *meter, vector<string> *more_json, vector<string> *selected_fields);
+    // Wait for the shells invoked so far to finish and print their latencies in verbose mode.
+    void waitForShells();
+    // Write the buffered lines of the meterfiles or the log file.
+    void flushFiles();
+    // Write the buffered lines, close the files and print the number of opens in verbose mode.
+    void closeFiles();
 
     private:
 
@@ -46,6 +56,12 @@ struct Printer {
     bool overwrite_;
     MeterFileNaming naming_;
     MeterFileTimestamp timestamp_;
+    // The shells are run in the background, the telegram reception never waits for them.
+    ShellPool shell_pool_;
+    // Long running commands that receive the json of every telegram on stdin.
+    vector<shared_ptr<ShellPipe>> shell_pipes_;
+    // The meterfiles, or the log file, are kept open between telegrams.
+    FileCache files_;
 
     void printShells(Meter *meter, vector<string> &envs);
     void printFiles(Meter *meter, Telegram *t, string &human_readable, string &fields, string &json);
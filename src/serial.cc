@@ -465,8 +465,12 @@ AccessCheck SerialDeviceCommand::open(bool fail_if_not_ok)
 {
     expectAscii();
     bool ok = invokeBackgroundShell("/bin/sh", args_, envs_, &fd_, &pid_);
+    if (!ok)
+    {
+        warning("(serialcmd) could not start %s: %s\n", command_.c_str(), strerror(errno));
+        return AccessCheck::NotThere;
+    }
     assert(fd_ >= 0);
-    if (!ok) return AccessCheck::NotThere;
     setIsStdin();
     verbose("(serialcmd) opened %s pid %d fd %d (%s)\n", command_.c_str(), pid_, fd_, purpose_.c_str());
     return AccessCheck::AccessOK;
@@ -19,137 +19,174 @@
 #include "util.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <memory.h>
 #include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
-void invokeShell(string program, vector<string> args, vector<string> envs)
+// Several threads start children at the same time, a pipe must not leak into another
+// child than its own, or the reader would not see eof until that child exits too.
+// The dup2 in the spawn file actions clears the flag for the intended child.
+static int pipeCloseOnExec(int fds[2])
 {
-    vector<const char*> argv(args.size()+2);
-    char *p = new char[program.length()+1];
-    strcpy(p, program.c_str());
-    argv[0] = p;
-    int i = 1;
-    debug("(shell) exec \"%s\"\n", program.c_str());
-    for (auto &a : args) {
-        argv[i] = a.c_str();
-        i++;
-        debug("(shell) arg \"%s\"\n", a.c_str());
-    }
-    argv[i] = NULL;
-
-    vector<const char*> env(envs.size()+1);
-    env[0] = p;
-    i = 0;
-    for (auto &e : envs) {
-        env[i] = e.c_str();
-        i++;
-        debug("(shell) env \"%s\"\n", e.c_str());
-    }
-    env[i] = NULL;
-
-    pid_t pid = fork();
-    int status;
-    if (pid == 0) {
-        // I am the child!
-        close(0); // Close stdin
-#if (defined(__APPLE__) && defined(__MACH__)) || defined(__FreeBSD__)
-        execve(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
+#if defined(__APPLE__) && defined(__MACH__)
+    if (pipe(fds) == -1) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
 #else
-        execvpe(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
+    return pipe2(fds, O_CLOEXEC);
 #endif
+}
+
+// Start the program with posix_spawn. Unlike fork, it does not copy the page tables
+// of wmbusmeters, which makes no difference for the child but is much faster for a large daemon.
+// The child reads stdin from in_fd, or has no stdin if in_fd is -1. If out_fd is not -1,
+// stdout and stderr are redirected to it.
+static bool spawnProcess(const char *tag,
+                         const string &program, const vector<string> &args, const vector<string> &envs,
+                         int in_fd, int out_fd, bool new_process_group,
+                         pid_t *pid)
+{
+    // The argv and envp arrays point into the strings, nothing is copied.
+    vector<char*> ptrs(args.size()+envs.size()+3);
+    char **argv = &ptrs[0];
+    char **envp = &ptrs[args.size()+2];
+    argv[0] = (char*)program.c_str();
+    debug("(%s) exec \"%s\"\n", tag, program.c_str());
+    for (size_t i = 0; i < args.size(); ++i) {
+        argv[i+1] = (char*)args[i].c_str();
+        debug("(%s) arg \"%s\"\n", tag, args[i].c_str());
+    }
+    argv[args.size()+1] = NULL;
+    for (size_t i = 0; i < envs.size(); ++i) {
+        envp[i] = (char*)envs[i].c_str();
+        debug("(%s) env \"%s\"\n", tag, envs[i].c_str());
+    }
+    envp[envs.size()] = NULL;
 
-        perror("Execvp failed:");
-        error("(shell) invoking %s failed!\n", program.c_str());
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd != -1) {
+        posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
     } else {
-        if (pid == -1) {
-            error("(shell) could not fork!\n");
-        }
-        debug("(shell) waiting for child %d to complete.\n", pid);
-        // Wait for the child to finish!
-        waitpid(pid, &status, 0);
-        if (WIFEXITED(status)) {
-            // Child exited properly.
-            int rc = WEXITSTATUS(status);
-            debug("(shell) %s: return code %d\n", program.c_str(), rc);
-            if (rc != 0) {
-                warning("(shell) %s exited with non-zero return code: %d\n", program.c_str(), rc);
-            }
-        }
+        posix_spawn_file_actions_addclose(&actions, STDIN_FILENO);
+    }
+    if (out_fd != -1) {
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDERR_FILENO);
     }
-    delete[] p;
-}
 
-bool invokeBackgroundShell(string program, vector<string> args, vector<string> envs, int *fd_out, int *pid)
-{
-    int link[2];
-    vector<const char*> argv(args.size()+2);
-    char *p = new char[program.length()+1];
-    strcpy(p, program.c_str());
-    argv[0] = p;
-    int i = 1;
-    debug("(bgshell) exec background \"%s\"\n", program.c_str());
-    for (auto &a : args) {
-        argv[i] = a.c_str();
-        i++;
-        debug("(bgshell) arg \"%s\"\n", a.c_str());
-    }
-    argv[i] = NULL;
-
-    vector<const char*> env(envs.size()+1);
-    env[0] = p;
-    i = 0;
-    for (auto &e : envs) {
-        env[i] = e.c_str();
-        i++;
-        debug("(bgshell) env \"%s\"\n", e.c_str());
-    }
-    env[i] = NULL;
-
-    if (pipe(link) == -1) {
-        error("(bgshell) could not create pipe!\n");
-    }
-
-    *pid = fork();
-    if (*pid == 0) {
-        // I am the child!
-        // Restore the handlers in the child.
-        restoreSignalHandlers();
-
-        // Make this child a process group leader,
-        // so that we can easily terminate it and all its
-        // subprocesses later one!
-        setpgid(0, 0);
-        // Redirect stdout and stderr to pipe
-        dup2 (link[1], STDOUT_FILENO);
-        dup2 (link[1], STDERR_FILENO);
-        // Close return pipe, not duped.
-        close(link[0]);
-        // Close old forward fd pipe.
-        close(link[1]);
-        close(0); // Close stdin
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    // The child should not inherit the signals blocked by the thread spawning it.
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    if (new_process_group) {
+        // Make the child a process group leader, so that we can easily
+        // terminate it and all its subprocesses later on!
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
 
 #if (defined(__APPLE__) && defined(__MACH__)) || defined(__FreeBSD__)
-        execve(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
+    int rc = posix_spawn(pid, program.c_str(), &actions, &attr, argv, envp);
 #else
-        execvpe(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
+    int rc = posix_spawnp(pid, program.c_str(), &actions, &attr, argv, envp);
 #endif
 
-        perror("Execvp failed:");
-        error("(bgshell) invoking %s failed!\n", program.c_str());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (rc != 0) {
+        // The caller decides how to report the failure.
+        debug("(%s) invoking %s failed: %s\n", tag, program.c_str(), strerror(rc));
+        errno = rc;
         return false;
     }
+    return true;
+}
 
-    // Make reads from the pipe non-blocking.
-    int flags = fcntl(link[0], F_GETFL);
-    flags |= O_NONBLOCK;
-    fcntl(link[0], F_SETFL, flags);
+void invokeShell(const string &program, const vector<string> &args, const vector<string> &envs)
+{
+    pid_t pid;
+    if (!spawnProcess("shell", program, args, envs, -1, -1, false, &pid)) {
+        warning("(shell) invoking %s failed: %s\n", program.c_str(), strerror(errno));
+        return;
+    }
 
-    *fd_out = link[0];
-    delete[] p;
+    debug("(shell) waiting for child %d to complete.\n", pid);
+    // Wait for the child to finish!
+    int status;
+    if (waitpid(pid, &status, 0) < 0) return;
+    if (WIFEXITED(status)) {
+        // Child exited properly.
+        int rc = WEXITSTATUS(status);
+        debug("(shell) %s: return code %d\n", program.c_str(), rc);
+        if (rc != 0) {
+            warning("(shell) %s exited with non-zero return code: %d\n", program.c_str(), rc);
+        }
+    }
+}
+
+bool invokeBackgroundShell(const string &program, const vector<string> &args, const vector<string> &envs, int *fd_out, int *pid, int *fd_in)
+{
+    int link[2];
+    int input[2];
+
+    if (fd_out) {
+        if (pipeCloseOnExec(link) == -1) {
+            error("(bgshell) could not create pipe!\n");
+        }
+    }
+    if (fd_in) {
+        if (pipeCloseOnExec(input) == -1) {
+            error("(bgshell) could not create input pipe!\n");
+        }
+    }
+
+    pid_t p;
+    bool ok = spawnProcess("bgshell", program, args, envs,
+                           fd_in ? input[0] : -1, fd_out ? link[1] : -1,
+                           true, &p);
+    int spawn_errno = errno;
+    if (fd_out) {
+        close(link[1]);
+    }
+    if (fd_in) {
+        close(input[0]);
+    }
+    if (!ok) {
+        errno = spawn_errno;
+        if (fd_out) close(link[0]);
+        if (fd_in) close(input[1]);
+        return false;
+    }
+    *pid = p;
+
+    if (fd_out) {
+        // Make reads from the pipe non-blocking.
+        int flags = fcntl(link[0], F_GETFL);
+        flags |= O_NONBLOCK;
+        fcntl(link[0], F_SETFL, flags);
+        *fd_out = link[0];
+    }
+    if (fd_in) {
+        *fd_in = input[1];
+    }
     return true;
 }
 
@@ -222,66 +259,28 @@ void stopBackgroundShell(int pid)
     }
 }
 
-int invokeShellCaptureOutput(string program, vector<string> args, vector<string> envs, string *out, bool do_not_warn_if_fail)
+int invokeShellCaptureOutput(const string &program, const vector<string> &args, const vector<string> &envs, string *out, bool do_not_warn_if_fail)
 {
     int rc = 0;
-    int pid;
+    pid_t pid;
     int link[2];
-    vector<const char*> argv(args.size()+2);
-    char *p = new char[program.length()+1];
-    strcpy(p, program.c_str());
-    argv[0] = p;
-    int i = 1;
-
-    debug("(shell) exec (capture output) \"%s\"\n", program.c_str());
-    for (auto &a : args) {
-        argv[i] = a.c_str();
-        i++;
-        debug("(shell) arg \"%s\"\n", a.c_str());
-    }
-    argv[i] = NULL;
-
-    vector<const char*> env(envs.size()+1);
-    env[0] = p;
-    i = 0;
-    for (auto &e : envs) {
-        env[i] = e.c_str();
-        i++;
-        debug("(shell) env \"%s\"\n", e.c_str());
-    }
-    env[i] = NULL;
-
-    if (pipe(link) == -1) {
+
+    if (pipeCloseOnExec(link) == -1) {
         error("(shell) could not create pipe!\n");
     }
 
-    pid = fork();
-    if (pid == 0) {
-        // I am the child!
-        // Redirect stdout and stderr to pipe
-        dup2 (link[1], STDOUT_FILENO);
-        dup2 (link[1], STDERR_FILENO);
-        // Close return pipe, not duped.
+    bool ok = spawnProcess("shell", program, args, envs, -1, link[1], false, &pid);
+    int spawn_errno = errno;
+    close(link[1]);
+    if (!ok) {
+        if (!do_not_warn_if_fail) {
+            warning("(shell) invoking %s failed: %s\n", program.c_str(), strerror(spawn_errno));
+        }
         close(link[0]);
-        // Close old forward fd pipe.
-        close(link[1]);
-        close(0); // Close stdin
-
-#if (defined(__APPLE__) && defined(__MACH__)) || defined(__FreeBSD__)
-        execve(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
-#else
-        execvpe(program.c_str(), (char*const*)&argv[0], (char*const*)&env[0]);
-#endif
-
-        perror("Execvp failed:");
-        error("(shell) invoking %s failed!\n", program.c_str());
         return 127;
     }
 
-    close(link[1]);
-
     int fd_out = link[0];
-    delete[] p;
 
     string data;
     uchar buf[32768];
@@ -345,3 +344,348 @@ void detectProcesses(string cmd, vector<int> *pids)
         pch = strtok (NULL, " \n");
     }
 }
+
+ShellPool::ShellPool(int max_running, size_t max_queued)
+    : max_running_(max_running > 0 ? max_running : 1), max_queued_(max_queued)
+{
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&work_posted_, NULL);
+    pthread_cond_init(&work_done_, NULL);
+}
+
+ShellPool::~ShellPool()
+{
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_broadcast(&work_posted_);
+    pthread_mutex_unlock(&mutex_);
+
+    for (pthread_t t : threads_)
+    {
+        pthread_join(t, NULL);
+    }
+
+    pthread_cond_destroy(&work_done_);
+    pthread_cond_destroy(&work_posted_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+void ShellPool::invoke(string key, string program, vector<string> args, vector<string> envs)
+{
+    Command c;
+    c.key = key;
+    c.cmdline = args.size() > 0 ? args.back() : program;
+    c.program = program;
+    c.args = args;
+    c.envs = envs;
+    c.queued = chrono::steady_clock::now();
+
+    pthread_mutex_lock(&mutex_);
+    if (queue_.size() >= max_queued_)
+    {
+        if (!warned_full_)
+        {
+            warning("(shell) more than %zu shell commands are waiting, coalescing or dropping new ones.\n", max_queued_);
+            warned_full_ = true;
+        }
+        // Replace the latest value waiting for the same meter and command line.
+        for (auto i = queue_.rbegin(); i != queue_.rend(); ++i)
+        {
+            if (i->key == c.key && i->cmdline == c.cmdline)
+            {
+                i->envs = std::move(c.envs);
+                stats_[c.cmdline].coalesced++;
+                pthread_mutex_unlock(&mutex_);
+                return;
+            }
+        }
+        stats_[c.cmdline].dropped++;
+        debug("(shell) dropped \"%s\" for %s, too many waiting\n", c.cmdline.c_str(), c.key.c_str());
+        pthread_mutex_unlock(&mutex_);
+        return;
+    }
+    queue_.push_back(std::move(c));
+    if (queue_.size() > peak_queued_) peak_queued_ = queue_.size();
+
+    // Start another thread when all threads are busy, up to max_running.
+    if (idle_ == 0 && threads_.size() < max_running_)
+    {
+        pthread_t t;
+        if (pthread_create(&t, NULL, dispatch, this) == 0)
+        {
+            threads_.push_back(t);
+        }
+    }
+    pthread_cond_broadcast(&work_posted_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+void ShellPool::drain()
+{
+    pthread_mutex_lock(&mutex_);
+    while (queue_.size() > 0 || running_keys_.size() > 0)
+    {
+        pthread_cond_wait(&work_done_, &mutex_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+void ShellPool::logStats()
+{
+    pthread_mutex_lock(&mutex_);
+    for (auto &p : stats_)
+    {
+        Stats &st = p.second;
+        verbose("(shell) \"%s\" ran %zu times, latency avg %.1f ms max %.1f ms, coalesced %zu dropped %zu\n",
+                p.first.c_str(), st.runs, st.runs ? st.total_ms/st.runs : 0.0, st.max_ms, st.coalesced, st.dropped);
+    }
+    if (stats_.size() > 0)
+    {
+        verbose("(shell) at most %zu shell commands were waiting\n", peak_queued_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+void *ShellPool::dispatch(void *ptr)
+{
+    static_cast<ShellPool*>(ptr)->loop();
+    return NULL;
+}
+
+// Take the first queued command whose key is not running, called with the mutex held.
+bool ShellPool::takeRunnable(Command *c)
+{
+    for (auto i = queue_.begin(); i != queue_.end(); ++i)
+    {
+        if (running_keys_.count(i->key) == 0)
+        {
+            *c = std::move(*i);
+            queue_.erase(i);
+            running_keys_.insert(c->key);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShellPool::loop()
+{
+    pthread_mutex_lock(&mutex_);
+    for (;;)
+    {
+        Command c;
+        idle_++;
+        while (!takeRunnable(&c))
+        {
+            // Stop only when all queued commands are done.
+            if (stop_ && queue_.size() == 0)
+            {
+                idle_--;
+                pthread_mutex_unlock(&mutex_);
+                return;
+            }
+            pthread_cond_wait(&work_posted_, &mutex_);
+        }
+        idle_--;
+        pthread_mutex_unlock(&mutex_);
+
+        // Only this thread waits for the child.
+        invokeShell(c.program, c.args, c.envs);
+        double ms = chrono::duration<double,milli>(chrono::steady_clock::now()-c.queued).count();
+
+        pthread_mutex_lock(&mutex_);
+        running_keys_.erase(c.key);
+        Stats &st = stats_[c.cmdline];
+        st.runs++;
+        st.total_ms += ms;
+        if (ms > st.max_ms) st.max_ms = ms;
+        // Commands waiting for this key can now run.
+        pthread_cond_broadcast(&work_posted_);
+        pthread_cond_broadcast(&work_done_);
+    }
+}
+
+ShellPipe::ShellPipe(string cmdline, size_t max_buffered)
+    : cmdline_(cmdline), max_buffered_(max_buffered)
+{
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&line_queued_, NULL);
+    pthread_create(&thread_, NULL, dispatch, this);
+}
+
+ShellPipe::~ShellPipe()
+{
+    stop();
+    pthread_cond_destroy(&line_queued_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+void ShellPipe::write(const string &line)
+{
+    pthread_mutex_lock(&mutex_);
+    lines_.push_back(line+"\n");
+    buffered_ += lines_.back().length();
+    while (buffered_ > max_buffered_ && lines_.size() > 1)
+    {
+        if (dropped_ == 0)
+        {
+            warning("(shell) \"%s\" is not reading its input, dropping the oldest lines.\n", cmdline_.c_str());
+        }
+        buffered_ -= lines_.front().length();
+        lines_.pop_front();
+        dropped_++;
+    }
+    pthread_cond_signal(&line_queued_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+void ShellPipe::stop()
+{
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&line_queued_);
+    pthread_mutex_unlock(&mutex_);
+
+    if (!joined_)
+    {
+        pthread_join(thread_, NULL);
+        joined_ = true;
+    }
+    closeCommand();
+}
+
+void ShellPipe::logStats()
+{
+    pthread_mutex_lock(&mutex_);
+    verbose("(shell) \"%s\" was sent %zu lines, dropped %zu lines, started %zu times\n",
+            cmdline_.c_str(), written_, dropped_, starts_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+void *ShellPipe::dispatch(void *ptr)
+{
+    // A write to a command that has exited fails with EPIPE, do not let the signal kill wmbusmeters.
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, NULL);
+
+    static_cast<ShellPipe*>(ptr)->loop();
+    return NULL;
+}
+
+// Close stdin of the command, it should exit by itself, give it a few seconds before terminating it.
+void ShellPipe::closeCommand()
+{
+    if (fd_ != -1)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+    if (pid_ == 0) return;
+    for (int i = 0; i < 500 && stillRunning(pid_); ++i)
+    {
+        usleep(10*1000);
+    }
+    if (stillRunning(pid_))
+    {
+        stopBackgroundShell(pid_);
+    }
+    pid_ = 0;
+}
+
+// Called from the writer thread without the mutex held.
+bool ShellPipe::writeLine(const string &line)
+{
+    if (fd_ == -1)
+    {
+        // Do not try to start a command that exits immediately, or cannot be started,
+        // more than once a second.
+        if (attempts_ > 0 && time(NULL)-attempted_ < 1) sleep(1);
+        closeCommand();
+
+        vector<string> args;
+        args.push_back("-c");
+        args.push_back(cmdline_);
+        vector<string> envs;
+        attempted_ = time(NULL);
+        attempts_++;
+        if (!invokeBackgroundShell("/bin/sh", args, envs, NULL, &pid_, &fd_))
+        {
+            if (!warned_start_failed_) warning("(shell) could not start \"%s\": %s\n", cmdline_.c_str(), strerror(errno));
+            warned_start_failed_ = true;
+            return false;
+        }
+        warned_start_failed_ = false;
+        starts_++;
+        if (starts_ == 2) warning("(shell) \"%s\" exited, restarting it\n", cmdline_.c_str());
+        if (starts_ > 2) verbose("(shell) \"%s\" exited, restarting it\n", cmdline_.c_str());
+    }
+
+    size_t done = 0;
+    while (done < line.length())
+    {
+        ssize_t n = ::write(fd_, line.data()+done, line.length()-done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+        {
+            debug("(shell) \"%s\" write failed: %s\n", cmdline_.c_str(), strerror(errno));
+#if defined(__linux__) || defined(__FreeBSD__)
+            // Consume the SIGPIPE that is now pending for this thread.
+            if (errno == EPIPE)
+            {
+                sigset_t pipe_set;
+                sigemptyset(&pipe_set);
+                sigaddset(&pipe_set, SIGPIPE);
+                struct timespec no_wait = {0, 0};
+                sigtimedwait(&pipe_set, NULL, &no_wait);
+            }
+#endif
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+void ShellPipe::loop()
+{
+    pthread_mutex_lock(&mutex_);
+    for (;;)
+    {
+        while (lines_.size() == 0 && !stop_)
+        {
+            pthread_cond_wait(&line_queued_, &mutex_);
+        }
+        // Stop only when all lines are written.
+        if (lines_.size() == 0) break;
+
+        string line = lines_.front();
+        size_t dropped_before = dropped_;
+        pthread_mutex_unlock(&mutex_);
+
+        bool ok = writeLine(line);
+
+        pthread_mutex_lock(&mutex_);
+        if (!ok && stop_)
+        {
+            // The command is gone and is not restarted when stopping.
+            dropped_ += lines_.size();
+            lines_.clear();
+            buffered_ = 0;
+            break;
+        }
+        if (!ok) continue; // Restart the command and try the line again.
+
+        // The line is dropped first if the buffer was full while writing.
+        if (dropped_ == dropped_before)
+        {
+            buffered_ -= line.length();
+            lines_.pop_front();
+        }
+        written_++;
+    }
+    pthread_mutex_unlock(&mutex_);
+}
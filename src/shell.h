@@ -15,14 +15,125 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef SHELL_H
+#define SHELL_H
+
+#include<chrono>
+#include<deque>
+#include<map>
+#include<pthread.h>
+#include<set>
 #include<string>
 #include<vector>
 
 using namespace std;
 
-void invokeShell(string program, vector<string> args, vector<string> envs);
-int  invokeShellCaptureOutput(string program, vector<string> args, vector<string> envs, string *out, bool do_not_warn_if_fail);
-bool invokeBackgroundShell(string program, vector<string> args, vector<string> envs, int *out, int *pid);
+void invokeShell(const string &program, const vector<string> &args, const vector<string> &envs);
+int  invokeShellCaptureOutput(const string &program, const vector<string> &args, const vector<string> &envs, string *out, bool do_not_warn_if_fail);
+// The output of the child is read from out. If in is given, the child reads its stdin from in.
+// If out is NULL the child writes to the stdout and stderr of wmbusmeters.
+// Nothing is logged if the child cannot be started, errno tells why.
+bool invokeBackgroundShell(const string &program, const vector<string> &args, const vector<string> &envs, int *out, int *pid, int *in = NULL);
 bool stillRunning(int pid);
 void stopBackgroundShell(int pid);
 void detectProcesses(string cmd, vector<int> *pids);
+
+// Runs shell commands in background threads, the caller never waits for a child process.
+// At most max_running children run at the same time. Commands with the same key (eg the meter)
+// run one at a time in the order they were invoked. When max_queued commands are waiting,
+// a new command replaces a queued command with the same key and command line (coalesce),
+// if there is none the new command is dropped.
+struct ShellPool
+{
+    ShellPool(int max_running, size_t max_queued);
+    // Waits for all queued commands to finish.
+    ~ShellPool();
+    void invoke(string key, string program, vector<string> args, vector<string> envs);
+    // Wait until all queued commands have finished.
+    void drain();
+    // Print the latency and backlog of each command line in verbose mode.
+    void logStats();
+
+private:
+
+    struct Command
+    {
+        string key;
+        string cmdline; // The last argument, ie the command line for sh -c.
+        string program;
+        vector<string> args;
+        vector<string> envs;
+        chrono::steady_clock::time_point queued;
+    };
+
+    struct Stats
+    {
+        size_t runs {};
+        size_t dropped {};
+        size_t coalesced {};
+        double total_ms {};
+        double max_ms {};
+    };
+
+    static void *dispatch(void *ptr);
+    void loop();
+    bool takeRunnable(Command *c);
+
+    size_t max_running_;
+    size_t max_queued_;
+    vector<pthread_t> threads_;
+    size_t idle_ {};
+    pthread_mutex_t mutex_;
+    pthread_cond_t work_posted_;
+    pthread_cond_t work_done_;
+    deque<Command> queue_;
+    set<string> running_keys_;
+    size_t peak_queued_ {};
+    bool warned_full_ {};
+    map<string,Stats> stats_;
+    bool stop_ {};
+};
+
+// Starts a shell command once and writes lines to its stdin, eg mosquitto_pub -l.
+// The command is restarted when it exits. Lines written while it restarts are buffered,
+// when more than max_buffered bytes are waiting the oldest lines are dropped.
+struct ShellPipe
+{
+    ShellPipe(string cmdline, size_t max_buffered);
+    // Stops the command.
+    ~ShellPipe();
+    // Queue a line to be written, a newline is appended. Never waits for the command.
+    void write(const string &line);
+    // Write the buffered lines, close stdin of the command and wait for it to exit.
+    void stop();
+    // Print the number of lines written, dropped and restarts in verbose mode.
+    void logStats();
+
+private:
+
+    static void *dispatch(void *ptr);
+    void loop();
+    bool writeLine(const string &line);
+    void closeCommand();
+
+    string cmdline_;
+    size_t max_buffered_;
+    pthread_t thread_ {};
+    bool joined_ {};
+    pthread_mutex_t mutex_;
+    pthread_cond_t line_queued_;
+    deque<string> lines_;
+    size_t buffered_ {};
+    bool stop_ {};
+    int pid_ {};
+    int fd_ {-1};
+    // The time of the last try to start the command, also if it failed.
+    time_t attempted_ {};
+    size_t attempts_ {};
+    bool warned_start_failed_ {};
+    size_t written_ {};
+    size_t dropped_ {};
+    size_t starts_ {};
+};
+
+#endif
@@ -15,21 +15,47 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include"aes.h"
 #include"aescmac.h"
 #include"cmdline.h"
 #include"config.h"
+#include"manufacturer_specificities.h"
 #include"meters.h"
 #include"printer.h"
 #include"serial.h"
+#include"shell.h"
+#include"threads.h"
 #include"util.h"
 #include"wmbus.h"
+#include"wmbus_utils.h"
 #include"dvparser.h"
 
+#include<math.h>
+#include<new>
+#include<stdlib.h>
 #include<string.h>
+#include<unistd.h>
 
 using namespace std;
 
+// Count the heap allocations, to verify that frames are not copied.
+size_t num_allocations_ {};
+
+void *operator new(size_t size)
+{
+    num_allocations_++;
+    void *p = malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
 int test_crc();
+int test_trim_crcs(char format, size_t len);
 int test_dvparser();
 int test_test();
 int test_linkmodes();
@@ -39,6 +65,23 @@ void test_periods();
 void test_devices();
 void test_meters();
 void test_months();
+void test_meter_detection();
+void test_negative_id_cache();
+void test_meter_eviction();
+void test_worker_thread();
+void test_frame_allocations();
+void test_explanations();
+void test_find_key();
+void test_manufacturers();
+void test_duplicate_telegrams();
+void test_aes();
+void test_aes_modes();
+void test_meter_keys();
+void test_diehl_lfsr();
+void test_decryption_backoff();
+void test_shell_pool();
+void test_file_cache();
+void test_json();
 
 int main(int argc, char **argv)
 {
@@ -66,6 +109,23 @@ int main(int argc, char **argv)
     test_kdf();
     test_periods();
     test_months();
+    test_meter_detection();
+    test_negative_id_cache();
+    test_meter_eviction();
+    test_worker_thread();
+    test_frame_allocations();
+    test_explanations();
+    test_find_key();
+    test_manufacturers();
+    test_duplicate_telegrams();
+    test_aes();
+    test_aes_modes();
+    test_meter_keys();
+    test_diehl_lfsr();
+    test_decryption_backoff();
+    test_shell_pool();
+    test_file_cache();
+    test_json();
     return 0;
 }
 
@@ -127,15 +187,83 @@ int test_crc()
         printf("ERROR! %4x should be c2b7\n", crc);
         rc = -1;
     }
+
+    // The table driven crc must match the crc calculated one bit at a time.
+    uchar bytes[300];
+    for (size_t i = 0; i < sizeof(bytes); ++i) bytes[i] = (i*37+11) & 0xff;
+    for (size_t len = 0; len <= sizeof(bytes); ++len)
+    {
+        uint16_t expected = 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            expected ^= bytes[i] << 8;
+            for (int j = 0; j < 8; ++j)
+            {
+                expected = (expected & 0x8000) ? (expected << 1) ^ 0x3D65 : (expected << 1);
+            }
+        }
+        expected = ~expected;
+        crc = crc16_EN13757(bytes, len);
+        if (crc != expected) {
+            printf("ERROR! %4x should be %4x for len %zu\n", crc, expected, len);
+            rc = -1;
+        }
+    }
+
+    if (test_trim_crcs('A', 12) || test_trim_crcs('A', 10+16*3) || test_trim_crcs('A', 10+16*3+5) ||
+        test_trim_crcs('B', 12) || test_trim_crcs('B', 126) || test_trim_crcs('B', 150))
+    {
+        rc = -1;
+    }
     return rc;
 }
 
-int test_parse(const char *data, std::map<std::string,std::pair<int,DVEntry>> *values, int testnr)
+// Add the crcs of frame format a or b to len data bytes and check that trimming removes them again.
+int test_trim_crcs(char format, size_t len)
+{
+    vector<uchar> data;
+    for (size_t i = 0; i < len; ++i) data.push_back((i*13+5) & 0xff);
+    data[0] = len-1;
+
+    vector<size_t> blocks;
+    if (format == 'A')
+    {
+        blocks.push_back(10);
+        for (size_t pos = 10; pos < len; pos += 16) blocks.push_back(min((size_t)16, len-pos));
+    }
+    else
+    {
+        blocks.push_back(min((size_t)126, len));
+        if (len > 126) blocks.push_back(len-126);
+    }
+
+    vector<uchar> frame;
+    size_t pos = 0;
+    for (size_t b : blocks)
+    {
+        uint16_t crc = crc16_EN13757(&data[pos], b);
+        frame.insert(frame.end(), data.begin()+pos, data.begin()+pos+b);
+        frame.push_back(crc >> 8);
+        frame.push_back(crc & 0xff);
+        pos += b;
+    }
+
+    bool ok = format == 'A' ? trimCRCsFrameFormatA(frame) : trimCRCsFrameFormatB(frame);
+    if (!ok || frame != data)
+    {
+        printf("ERROR! trimming crcs from frame format %c with %zu bytes failed\n", format, len);
+        return -1;
+    }
+    return 0;
+}
+
+// The parsed values refer to the databytes, which must therefore outlive the values.
+int test_parse(const char *data, vector<uchar> &databytes, std::map<std::string,std::pair<int,DVEntry>> *values, int testnr)
 {
     debug("\n\nTest nr %d......\n\n", testnr);
     bool b;
     Telegram t;
-    vector<uchar> databytes;
+    databytes.clear();
     hex2bin(data, &databytes);
     vector<uchar>::iterator i = databytes.begin();
 
@@ -191,29 +319,44 @@ void test_date(map<string,pair<int,DVEntry>> &values, const char *key, string da
 int test_dvparser()
 {
     map<string,pair<int,DVEntry>> values;
+    vector<uchar> databytes;
 
     int testnr = 1;
-    test_parse("2F 2F 0B 13 56 34 12 8B 82 00 93 3E 67 45 23 0D FD 10 0A 30 31 32 33 34 35 36 37 38 39 0F 88 2F", &values, testnr);
+    test_parse("2F 2F 0B 13 56 34 12 8B 82 00 93 3E 67 45 23 0D FD 10 0A 30 31 32 33 34 35 36 37 38 39 0F 88 2F", databytes, &values, testnr);
     test_double(values, "0B13", 123.456, testnr);
     test_double(values, "8B8200933E", 234.567, testnr);
     test_string(values, "0DFD10", "30313233343536373839", testnr);
 
     testnr++;
     values.clear();
-    test_parse("82046C 5f1C", &values, testnr);
+    test_parse("82046C 5f1C", databytes, &values, testnr);
     test_date(values, "82046C", "2010-12-31 00:00:00", testnr); // 2010-dec-31
 
     testnr++;
     values.clear();
-    test_parse("0C1348550000426CE1F14C130000000082046C21298C0413330000008D04931E3A3CFE3300000033000000330000003300000033000000330000003300000033000000330000003300000033000000330000004300000034180000046D0D0B5C2B03FD6C5E150082206C5C290BFD0F0200018C4079678885238310FD3100000082106C01018110FD610002FD66020002FD170000", &values, testnr);
+    test_parse("0C1348550000426CE1F14C130000000082046C21298C0413330000008D04931E3A3CFE3300000033000000330000003300000033000000330000003300000033000000330000003300000033000000330000004300000034180000046D0D0B5C2B03FD6C5E150082206C5C290BFD0F0200018C4079678885238310FD3100000082106C01018110FD610002FD66020002FD170000", databytes, &values, testnr);
     test_double(values, "0C13", 5.548, testnr);
     test_date(values, "426C", "2127-01-01 00:00:00", testnr); // 2127-jan-1
     test_date(values, "82106C", "2000-01-01 00:00:00", testnr); // 2000-jan-1
 
     testnr++;
     values.clear();
-    test_parse("426C FE04", &values, testnr);
+    test_parse("426C FE04", databytes, &values, testnr);
     test_date(values, "426C", "2007-04-30 00:00:00", testnr); // 2010-dec-31
+
+    // Drivers add vendor specific values as hex strings.
+    testnr++;
+    values.clear();
+    string vendor = "56341200";
+    values["0C13"] = { 0, DVEntry(MeasurementType::Instantaneous, 0x13, 0, 0, 0, vendor) };
+    test_double(values, "0C13", 123.456, testnr);
+    test_string(values, "0C13", "56341200", testnr);
+    uint16_t u16 = 0;
+    int offset = 0;
+    if (!extractDVuint16(&values, "0C13", &offset, &u16) || u16 != 0x3456)
+    {
+        fprintf(stderr, "Error in dvparser testnr %d: got %04x but expected 3456\n", testnr, u16);
+    }
     return 0;
 }
 
@@ -400,6 +543,17 @@ void test_does_id_match_expression(string id, string mes, bool expected, bool ex
         printf("ERROR! Matching \"%s\" \"%s\" and expecte used_wildcard %d but got %d!\n",
                id.c_str(), mes.c_str(), expected_uw, uw);
     }
+
+    // The compiled matcher must give the same answer.
+    IdMatcher matcher(expressions);
+    vector<string> ids = { id };
+    bool cuw = false;
+    bool cb = matcher.matches(ids, &cuw);
+    if (cb != expected || cuw != expected_uw)
+    {
+        printf("ERROR! Compiled matching \"%s\" \"%s\" expected %d (used_wildcard %d) but got %d (%d)!\n",
+               id.c_str(), mes.c_str(), expected, expected_uw, cb, cuw);
+    }
 }
 
 void test_ids()
@@ -437,6 +591,13 @@ void test_ids()
 
     test_does_id_match_expression("78563413", "78563412,78563413", true, false);
     test_does_id_match_expression("78563413", "*,!00156327,!00048713", true, true);
+
+    // Ids that are not 8 digits, like mbus primary addresses, fall back to string matching.
+    test_does_id_match_expression("5", "5", true, false);
+    test_does_id_match_expression("5", "*", true, true);
+    test_does_id_match_expression("1234abcd", "1234*", true, true);
+    test_does_id_match_expression("1234abcd", "1234abcd", true, false);
+    test_does_id_match_expression("1234abcd", "!1234a*,*", false, false);
 }
 
 void eq(string a, string b, const char *tn)
@@ -803,3 +964,975 @@ void test_meters()
           "c1"); // linkmodes
 
 }
+
+void test_pick(int mfct, int media, int version, MeterDriver expected)
+{
+    MeterDriver d = pickMeterDriver(mfct, media, version);
+    if (d != expected)
+    {
+        printf("ERROR in meter detection %04x %02x %02x expected %s but got %s\n",
+               mfct, media, version, toString(expected).c_str(), toString(d).c_str());
+    }
+    if (expected != MeterDriver::UNKNOWN && !isMeterDriverValid(expected, mfct, media, version))
+    {
+        printf("ERROR in meter detection %04x %02x %02x expected %s to be valid\n",
+               mfct, media, version, toString(expected).c_str());
+    }
+}
+
+void test_meter_detection()
+{
+    test_pick(MANUFACTURER_KAM, 0x06, 0x1b, MeterDriver::MULTICAL21);
+    test_pick(MANUFACTURER_DEV, 0x02, 0x00, MeterDriver::AMIPLUS);
+    test_pick(MANUFACTURER_KAM, 0x06, 0x1c, MeterDriver::UNKNOWN);
+    test_pick(0x1234, 0x06, 0x1b, MeterDriver::UNKNOWN);
+
+    // Izar accepts any version for these media.
+    test_pick(MANUFACTURER_SAP, 0x15, 0x00, MeterDriver::IZAR);
+    test_pick(MANUFACTURER_SAP, 0x04, 0xff, MeterDriver::IZAR);
+    test_pick(MANUFACTURER_SAP, 0x07, 0x00, MeterDriver::IZAR);
+    test_pick(MANUFACTURER_SAP, 0x07, 0x01, MeterDriver::UNKNOWN);
+
+    if (isMeterDriverValid(MeterDriver::MULTICAL21, MANUFACTURER_SAP, 0x15, 0x00))
+    {
+        printf("ERROR in meter detection, multical21 should not be valid for izar\n");
+    }
+
+    vector<string> drivers;
+    detectMeterDrivers(MANUFACTURER_SAP, 0x15, 0x42, &drivers);
+    if (drivers.size() != 1 || drivers[0] != "izar")
+    {
+        printf("ERROR in meter detection, expected only izar to be detected\n");
+    }
+}
+
+void test_negative_id_cache()
+{
+    shared_ptr<MeterManager> manager = createMeterManager(false);
+    vector<string> shells, jsons;
+    vector<string> ids = { "33225544" };
+    MeterInfo mi("", "m", MeterDriver::SUPERCOM587, "", ids, "", LinkModeSet(), 0, shells, jsons);
+    manager->addMeter(createMeter(&mi));
+
+    vector<uchar> unknown_frame;
+    hex2bin("1844AE4C9999999968077A55000000041389E20100023B0000", &unknown_frame);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+
+    size_t hits, misses;
+    manager->handleTelegram(about, unknown_frame, false);
+    manager->handleTelegram(about, unknown_frame, false);
+    manager->negativeIdCacheStats(&hits, &misses);
+    if (hits != 1 || misses != 1)
+    {
+        printf("ERROR in negative id cache expected 1 hit 1 miss but got %zu %zu\n", hits, misses);
+    }
+
+    // A new meter listening to other ids keeps the cached ids.
+    vector<string> other_ids = { "11223344" };
+    MeterInfo omi("", "o", MeterDriver::SUPERCOM587, "", other_ids, "", LinkModeSet(), 0, shells, jsons);
+    manager->addMeter(createMeter(&omi));
+    manager->handleTelegram(about, unknown_frame, false);
+    manager->negativeIdCacheStats(&hits, &misses);
+    if (hits != 2 || misses != 1)
+    {
+        printf("ERROR in negative id cache expected 2 hits 1 miss after adding another meter but got %zu %zu\n", hits, misses);
+    }
+
+    // A new template listening to the id must invalidate the cache.
+    // The handled result is only known without decode threads.
+    vector<string> wids = { "9999*" };
+    MeterInfo tmi("", "t", MeterDriver::AUTO, "", wids, "", LinkModeSet(), 0, shells, jsons);
+    manager->addMeterTemplate(tmi);
+    bool handled = manager->handleTelegram(about, unknown_frame, false);
+    manager->negativeIdCacheStats(&hits, &misses);
+    if (!handled || hits != 2 || misses != 2)
+    {
+        printf("ERROR in negative id cache expected template to handle telegram, got %d %zu %zu\n", handled, hits, misses);
+    }
+}
+
+void test_meter_eviction()
+{
+    char spill_dir[] = "/tmp/wmbusmeters_spill_XXXXXX";
+    if (!mkdtemp(spill_dir))
+    {
+        printf("ERROR could not create spill dir for meter eviction test\n");
+        return;
+    }
+
+    shared_ptr<MeterManager> manager = createMeterManager(false);
+    manager->limitMeters(2, spill_dir);
+    vector<string> shells, jsons;
+    vector<string> ids = { "*" };
+    MeterInfo mi("", "all", MeterDriver::AUTO, "", ids, "", LinkModeSet(), 0, shells, jsons);
+    manager->addMeterTemplate(mi);
+
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    for (const char *id : { "11111111", "22222222", "33333333" })
+    {
+        vector<uchar> frame;
+        string hex = string("1844AE4C")+id+"68077A55000000041389E20100023B0000";
+        hex2bin(hex, &frame);
+        manager->handleTelegram(about, frame, false);
+    }
+
+    int num_meters = 0;
+    manager->forEachMeter([&](Meter *m) { num_meters++; });
+    if (num_meters != 2)
+    {
+        printf("ERROR in meter eviction expected 2 meters but got %d\n", num_meters);
+    }
+
+    // The first meter was evicted and is now recreated from its spill file.
+    // The new telegram only has the flow, the total 123.529 m3 comes from the spilled
+    // telegram. Restoring the spilled telegram does not count as an update.
+    vector<uchar> flow_frame;
+    hex2bin("1244AE4C1111111168077A55000000023B0000", &flow_frame);
+    manager->handleTelegram(about, flow_frame, false);
+
+    Meter *m = manager->lastAddedMeter();
+    WaterMeter *wm = dynamic_cast<WaterMeter*>(m);
+    vector<string> files;
+    listFiles(spill_dir, &files);
+    if (m->idsc() != "11111111" || m->numUpdates() != 1 || files.size() != 1)
+    {
+        printf("ERROR in meter eviction expected 11111111 restored with 1 update and 1 spill file but got %s %d %zu\n",
+               m->idsc().c_str(), m->numUpdates(), files.size());
+    }
+    if (wm == NULL || fabs(wm->totalWaterConsumption(Unit::M3)-123.529) > 0.0005)
+    {
+        printf("ERROR in meter eviction expected the restored meter to have the spilled total 123.529 m3 but got %f\n",
+               wm ? wm->totalWaterConsumption(Unit::M3) : 0.0);
+    }
+
+    vector<uchar> frame;
+    hex2bin("1844AE4C1111111168077A55000000041389E20100023B0000", &frame);
+
+    // A spill file written for another template is removed when the id is heard again.
+    string spill = string(spill_dir)+"/44444444";
+    FILE *f = fopen(spill.c_str(), "w");
+    fprintf(f, "other\tiperl\n");
+    fputc((int)FrameType::WMBUS, f);
+    fwrite(&frame[0], 1, frame.size(), f);
+    fclose(f);
+    vector<uchar> other_frame;
+    hex2bin("1844AE4C4444444468077A55000000041389E20100023B0000", &other_frame);
+    manager->handleTelegram(about, other_frame, false);
+    if (checkFileExists(spill.c_str()))
+    {
+        printf("ERROR in meter eviction expected the spill file of another template to be removed\n");
+    }
+
+    // Restoring a meter parses the telegram without handling it.
+    vector<string> restore_ids = { "11111111" };
+    MeterInfo rmi("", "r", MeterDriver::IPERL, "", restore_ids, "", LinkModeSet(), 0, shells, jsons);
+    shared_ptr<Meter> restored = createMeter(&rmi);
+    Telegram header;
+    header.about = about;
+    header.parseHeader(frame);
+    WaterMeter *rwm = dynamic_cast<WaterMeter*>(restored.get());
+    if (!restored->restoreState(header, frame) || restored->numUpdates() != 0 ||
+        fabs(rwm->totalWaterConsumption(Unit::M3)-123.529) > 0.0005)
+    {
+        printf("ERROR in meter eviction expected the total 123.529 m3 restored without an update but got %f %d\n",
+               rwm->totalWaterConsumption(Unit::M3), restored->numUpdates());
+    }
+
+    manager->removeAllMeters();
+    files.clear();
+    listFiles(spill_dir, &files);
+    for (string &f : files)
+    {
+        unlink((string(spill_dir)+"/"+f).c_str());
+    }
+
+    // At most 10 spill files per allowed meter are kept, the oldest are removed.
+    shared_ptr<MeterManager> small_manager = createMeterManager(false);
+    small_manager->limitMeters(1, spill_dir);
+    small_manager->addMeterTemplate(mi);
+    for (int i = 0; i < 13; ++i)
+    {
+        char id[9];
+        snprintf(id, sizeof(id), "%08d", 10000000+i);
+        string hex = string("1844AE4C")+id+"68077A55000000041389E20100023B0000";
+        vector<uchar> id_frame;
+        hex2bin(hex, &id_frame);
+        small_manager->handleTelegram(about, id_frame, false);
+    }
+    files.clear();
+    listFiles(spill_dir, &files);
+    if (files.size() != 10 || checkFileExists((string(spill_dir)+"/10000000").c_str()))
+    {
+        printf("ERROR in meter eviction expected the 10 newest spill files to be kept but got %zu\n", files.size());
+    }
+
+    // The spill files of an earlier run count towards the limit.
+    shared_ptr<MeterManager> restarted_manager = createMeterManager(false);
+    restarted_manager->limitMeters(1, spill_dir);
+    restarted_manager->addMeterTemplate(mi);
+    for (const char *id : { "20000000", "20000001" })
+    {
+        string hex = string("1844AE4C")+id+"68077A55000000041389E20100023B0000";
+        vector<uchar> id_frame;
+        hex2bin(hex, &id_frame);
+        restarted_manager->handleTelegram(about, id_frame, false);
+    }
+    files.clear();
+    listFiles(spill_dir, &files);
+    if (files.size() != 10)
+    {
+        printf("ERROR in meter eviction expected 10 spill files after a restart but got %zu\n", files.size());
+    }
+
+    restarted_manager->removeAllMeters();
+    small_manager->removeAllMeters();
+    files.clear();
+    listFiles(spill_dir, &files);
+    for (string &f : files)
+    {
+        unlink((string(spill_dir)+"/"+f).c_str());
+    }
+    rmdir(spill_dir);
+}
+
+void test_worker_thread()
+{
+    vector<int> done;
+    {
+        WorkerThread worker("test_worker", 10);
+        for (int i = 0; i < 100; ++i)
+        {
+            worker.post([&done, i]() { done.push_back(i); });
+        }
+        worker.drain();
+        if (done.size() != 100)
+        {
+            printf("ERROR in worker thread expected 100 work items done but got %zu\n", done.size());
+        }
+        worker.post([&done]() { done.push_back(100); });
+        // The destructor finishes the posted work.
+    }
+    for (int i = 0; i < (int)done.size(); ++i)
+    {
+        if (done[i] != i)
+        {
+            printf("ERROR in worker thread expected work item %d but got %d\n", i, done[i]);
+            break;
+        }
+    }
+    if (done.size() != 101)
+    {
+        printf("ERROR in worker thread expected 101 work items done but got %zu\n", done.size());
+    }
+}
+
+void test_frame_allocations()
+{
+    // Handing a telegram to the listener must not copy the frame.
+    shared_ptr<MeterManager> manager = createMeterManager(false);
+    size_t frame_size = 0;
+    manager->onTelegram([&](AboutTelegram &about, const vector<uchar> &frame) { frame_size = frame.size(); });
+
+    vector<uchar> frame;
+    hex2bin("1844AE4C4455223368077A55000000041389E20100023B0000", &frame);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+
+    size_t before = num_allocations_;
+    manager->handleTelegram(about, frame, false);
+    size_t allocs = num_allocations_ - before;
+    if (allocs != 0 || frame_size != frame.size())
+    {
+        printf("ERROR in frame allocations expected 0 allocations when passing a telegram but got %zu\n", allocs);
+    }
+
+    // A telegram dispatched to a configured meter still allocates. The header telegram
+    // copies the frame and builds the id strings, and the meter parses the full telegram
+    // into its own telegram, values and explanations. Check the count stays bounded.
+    shared_ptr<MeterManager> meter_manager = createMeterManager(false);
+    vector<string> shells, jsons;
+    vector<string> ids = { "33225544" };
+    MeterInfo mi("", "m", MeterDriver::IPERL, "", ids, "", LinkModeSet(), 0, shells, jsons);
+    meter_manager->addMeter(createMeter(&mi));
+    meter_manager->handleTelegram(about, frame, false);
+
+    before = num_allocations_;
+    meter_manager->handleTelegram(about, frame, false);
+    size_t meter_allocs = num_allocations_ - before;
+    if (meter_allocs > 100)
+    {
+        printf("ERROR in frame allocations expected at most 100 allocations when decoding a telegram but got %zu\n", meter_allocs);
+    }
+
+    // The telegrams from the neighbours are dropped after the header is parsed.
+    vector<uchar> neighbour_frame;
+    hex2bin("1844AE4C9999999968077A55000000041389E20100023B0000", &neighbour_frame);
+    meter_manager->handleTelegram(about, neighbour_frame, false);
+
+    before = num_allocations_;
+    meter_manager->handleTelegram(about, neighbour_frame, false);
+    allocs = num_allocations_ - before;
+    if (allocs >= meter_allocs)
+    {
+        printf("ERROR in frame allocations expected fewer allocations for a dropped telegram (%zu) than for a decoded telegram (%zu)\n",
+               allocs, meter_allocs);
+    }
+
+    // Decryption is done in place.
+    Telegram t;
+    t.dll_a.resize(6);
+    vector<uchar> key;
+    hex2bin("000102030405060708090A0B0C0D0E0F", &key);
+    vector<uchar> payload(64, 0x2f);
+    AESRoundKeys rk;
+    aesBackend()->expandKey(&key[0], &rk);
+
+    before = num_allocations_;
+    vector<uchar>::iterator pos = payload.begin()+16;
+    decrypt_ELL_AES_CTR(&t, payload, pos, &rk);
+    pos = payload.begin()+16;
+    decrypt_TPL_AES_CBC_IV(&t, payload, pos, &rk);
+    allocs = num_allocations_ - before;
+    if (allocs != 0 || payload.size() != 64)
+    {
+        printf("ERROR in frame allocations expected 0 allocations when decrypting but got %zu\n", allocs);
+    }
+}
+
+void test_explanations()
+{
+    vector<uchar> frame;
+    hex2bin("1844AE4C4455223368077A55000000041389E20100023B0000", &frame);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    MeterKeys mk;
+
+    Telegram quiet;
+    quiet.about = about;
+    quiet.parse(frame, &mk, false);
+
+    Telegram explained;
+    explained.about = about;
+    explained.enableExplanations(true);
+    explained.parse(frame, &mk, false);
+
+    if (quiet.explanations.size() != 0)
+    {
+        printf("ERROR in explanations expected none when not enabled but got %zu\n", quiet.explanations.size());
+    }
+    if (explained.explanations.size() == 0)
+    {
+        printf("ERROR in explanations expected explanations when enabled\n");
+    }
+    // The offsets of the values must not depend on the explanations.
+    bool same = quiet.parsed.size() == explained.parsed.size() &&
+        quiet.values.size() == explained.values.size();
+    for (auto &p : quiet.values)
+    {
+        auto i = explained.values.find(p.first);
+        if (i == explained.values.end() || i->second.first != p.second.first) same = false;
+    }
+    if (!same)
+    {
+        printf("ERROR in explanations parse differs when explanations are enabled\n");
+    }
+}
+
+static void checkFindKey(Telegram *t)
+{
+    MeasurementType mts[] = { MeasurementType::Unknown, MeasurementType::Instantaneous, MeasurementType::Maximum };
+    ValueInformation vis[] = {
+        ValueInformation::None,
+#define X(name,from,to) ValueInformation::name,
+LIST_OF_VALUETYPES
+#undef X
+    };
+    int storagenrs[] = { ANY_STORAGENR, 0, 1, 8, 16 };
+    int tariffnrs[] = { ANY_TARIFFNR, 0, 1 };
+
+    for (MeasurementType mt : mts)
+    {
+        for (ValueInformation vi : vis)
+        {
+            for (int sn : storagenrs)
+            {
+                for (int tn : tariffnrs)
+                {
+                    string scanned, indexed;
+                    bool a = findKey(mt, vi, sn, tn, &scanned, &t->values);
+                    bool b = findKey(mt, vi, sn, tn, &indexed, t);
+                    if (a != b || scanned != indexed)
+                    {
+                        printf("ERROR in find key %s storagenr=%d tariff=%d: scanned \"%s\" but indexed \"%s\"\n",
+                               toString(vi), sn, tn, scanned.c_str(), indexed.c_str());
+                    }
+                }
+            }
+        }
+    }
+}
+
+void test_find_key()
+{
+    // The indexed findKey must find the same keys as scanning all values.
+    Telegram t;
+    vector<uchar> databytes;
+    hex2bin("0C1348550000426CE1F14C130000000082046C21298C0413330000008D04931E3A3CFE3300000033000000330000003300000033000000330000003300000033000000330000003300000033000000330000004300000034180000046D0D0B5C2B03FD6C5E150082206C5C290BFD0F0200018C4079678885238310FD3100000082106C01018110FD610002FD66020002FD170000", &databytes);
+    parseDV(&t, databytes, databytes.begin(), databytes.size(), &t.values);
+    checkFindKey(&t);
+
+    // The index must follow the values when they are parsed again.
+    t.values.clear();
+    vector<uchar> more;
+    hex2bin("0C1399990000046D0D0B5C2B", &more);
+    parseDV(&t, more, more.begin(), more.size(), &t.values);
+    checkFindKey(&t);
+}
+
+void test_manufacturers()
+{
+    // A few codes are listed twice, the first name wins.
+    map<int,string> names;
+#define X(key,code,name) names.insert({code, name});
+LIST_OF_MANUFACTURERS
+#undef X
+
+#define X(key,code,name) \
+    if (names[code] != manufacturer(code)) \
+        printf("ERROR in manufacturer %s expected \"%s\" but got \"%s\"\n", #key, names[code].c_str(), manufacturer(code)); \
+    if (strcmp(manufacturerFlag(code).c_str(), #key)) \
+        printf("ERROR in manufacturerFlag expected %s but got %s\n", #key, manufacturerFlag(code).c_str());
+LIST_OF_MANUFACTURERS
+#undef X
+
+    // Codes before the first, after the last and between known manufacturers.
+    int unknown[] = { 0, MANFCODE('A','A','A')-1, MANFCODE('K','A','B'), MANFCODE('Z','Z','Z')+1, 0x7fff };
+    for (int m : unknown)
+    {
+        if (strcmp(manufacturer(m), "Unknown"))
+        {
+            printf("ERROR in manufacturer expected Unknown for 0x%04x but got \"%s\"\n", m, manufacturer(m));
+        }
+    }
+    string flag = manufacturerFlag(MANFCODE('K','A','M'));
+    if (flag != "KAM")
+    {
+        printf("ERROR in manufacturerFlag expected KAM but got %s\n", flag.c_str());
+    }
+}
+
+void test_duplicate_telegrams()
+{
+    setDuplicateTelegramsWindow(10);
+    time_t now = 1000000;
+
+    vector<uchar> frame;
+    hex2bin("1844AE4C4455223368077A55000000041389E20100023B0000", &frame);
+    vector<uchar> other = frame;
+    other.back() = 0x01;
+
+    if (seen_this_telegram_before(frame, now)) printf("ERROR in duplicates first telegram is not a duplicate\n");
+    if (!seen_this_telegram_before(frame, now)) printf("ERROR in duplicates expected duplicate\n");
+    if (seen_this_telegram_before(other, now+1)) printf("ERROR in duplicates other telegram is not a duplicate\n");
+    if (!seen_this_telegram_before(frame, now+10)) printf("ERROR in duplicates expected duplicate within window\n");
+    if (seen_this_telegram_before(frame, now+11)) printf("ERROR in duplicates expected telegram to be forgotten after window\n");
+    if (!seen_this_telegram_before(frame, now+12)) printf("ERROR in duplicates expected duplicate of remembered telegram\n");
+
+    // Many meters heard by several dongles, the duplicates arrive long after
+    // more than 10 other telegrams.
+    vector<vector<uchar>> frames;
+    for (int i = 0; i < 5000; ++i)
+    {
+        vector<uchar> f = frame;
+        f[4] = i & 0xff;
+        f[5] = i >> 8;
+        frames.push_back(f);
+    }
+    int unique = 0, duplicates = 0;
+    for (auto &f : frames) if (!seen_this_telegram_before(f, now+100)) unique++;
+    for (auto &f : frames) if (seen_this_telegram_before(f, now+105)) duplicates++;
+    if (unique != 5000 || duplicates != 5000)
+    {
+        printf("ERROR in duplicates expected 5000 unique and 5000 duplicates but got %d and %d\n", unique, duplicates);
+    }
+}
+
+void test_aes_backend(const AESBackend *aes)
+{
+    // Known answers from FIPS-197 appendix C.1 and SP 800-38A F.1.1.
+    struct { const char *key, *plain, *cipher; } kats[] = {
+        { "000102030405060708090a0b0c0d0e0f", "00112233445566778899aabbccddeeff", "69c4e0d86a7b0430d8cdb78070b4c55a" },
+        { "2b7e151628aed2a6abf7158809cf4f3c", "6bc1bee22e409f96e93d7e117393172a", "3ad77bb40d7a3660a89ecaf32466ef97" },
+        { "2b7e151628aed2a6abf7158809cf4f3c", "ae2d8a571e03ac9c9eb76fac45af8e51", "f5d3d58503b9699de785895a96fdbaaf" },
+        { "2b7e151628aed2a6abf7158809cf4f3c", "30c81c46a35ce411e5fbc1191a0a52ef", "43b1cd7f598ece23881b00e3ed030688" },
+        { "2b7e151628aed2a6abf7158809cf4f3c", "f69f2445df4f9b17ad2b417be66c3710", "7b0c785e27e8ad3f8223207104725dd4" },
+    };
+
+    for (auto &k : kats)
+    {
+        vector<uchar> key, plain, cipher;
+        hex2bin(k.key, &key);
+        hex2bin(k.plain, &plain);
+        hex2bin(k.cipher, &cipher);
+
+        AESRoundKeys rk;
+        aes->expandKey(&key[0], &rk);
+        uchar out[16];
+        aes->encryptBlock(&rk, &plain[0], out);
+        if (memcmp(out, &cipher[0], 16))
+        {
+            printf("ERROR in aes %s encrypt with key %s expected %s\n", aes->name, k.key, k.cipher);
+        }
+        aes->decryptBlock(&rk, &cipher[0], out);
+        if (memcmp(out, &plain[0], 16))
+        {
+            printf("ERROR in aes %s decrypt with key %s expected %s\n", aes->name, k.key, k.plain);
+        }
+        // In place.
+        memcpy(out, &plain[0], 16);
+        aes->encryptBlock(&rk, out, out);
+        if (memcmp(out, &cipher[0], 16))
+        {
+            printf("ERROR in aes %s in place encrypt with key %s expected %s\n", aes->name, k.key, k.cipher);
+        }
+    }
+
+    // Batches must give the same result as one block at a time, for every remainder.
+    AESRoundKeys rk;
+    uchar key[16], in[16*11], a[16*11], b[16*11];
+    for (int i = 0; i < 16; ++i) key[i] = i*7;
+    for (size_t i = 0; i < sizeof(in); ++i) in[i] = i*13+5;
+    aes->expandKey(key, &rk);
+    for (size_t n = 0; n <= 11; ++n)
+    {
+        aes->encryptBlocks(&rk, in, a, n);
+        for (size_t i = 0; i < n; ++i) aes->encryptBlock(&rk, in+16*i, b+16*i);
+        if (memcmp(a, b, 16*n)) printf("ERROR in aes %s encrypt of %zu blocks\n", aes->name, n);
+        aes->decryptBlocks(&rk, in, a, n);
+        for (size_t i = 0; i < n; ++i) aes->decryptBlock(&rk, in+16*i, b+16*i);
+        if (memcmp(a, b, 16*n)) printf("ERROR in aes %s decrypt of %zu blocks\n", aes->name, n);
+    }
+}
+
+void test_aes_modes()
+{
+    const AESBackend *aes = aesBackend();
+    AESRoundKeys rk;
+    uchar key[16], iv[16];
+    for (int i = 0; i < 16; ++i) { key[i] = 0x40+i; iv[i] = 0xf0+i; }
+    aes->expandKey(key, &rk);
+
+    for (size_t len = 0; len <= 200; ++len)
+    {
+        vector<uchar> data(len);
+        for (size_t i = 0; i < len; ++i) data[i] = i*31+7;
+
+        // CTR compared with generating the keystream one block at a time.
+        vector<uchar> ctr = data;
+        uchar counter[16];
+        memcpy(counter, iv, 16);
+        AES_CTR_xcrypt(&rk, counter, ctr.data(), len);
+        uchar ref_counter[16], stream[16];
+        memcpy(ref_counter, iv, 16);
+        for (size_t i = 0; i < len; i += 16)
+        {
+            aes->encryptBlock(&rk, ref_counter, stream);
+            for (size_t j = i; j < len && j < i+16; ++j)
+            {
+                if ((data[j] ^ stream[j-i]) != ctr[j]) { printf("ERROR in aes ctr len %zu at %zu\n", len, j); break; }
+            }
+            incrementIV(ref_counter, 16);
+        }
+        if (memcmp(counter, ref_counter, 16)) printf("ERROR in aes ctr len %zu counter not updated\n", len);
+
+        // CBC in place compared with decrypting from a separate buffer.
+        if (len % 16 == 0)
+        {
+            vector<uchar> cbc = data;
+            vector<uchar> out(len+16);
+            AES_CBC_decrypt_in_place(&rk, cbc.data(), len, iv);
+            AES_CBC_decrypt(&rk, out.data(), data.data(), len, iv);
+            if (memcmp(cbc.data(), out.data(), len)) printf("ERROR in aes cbc in place len %zu\n", len);
+        }
+    }
+}
+
+void test_aes()
+{
+    test_aes_backend(aesPortableBackend());
+
+    const AESBackend *hw = aesHardwareBackend();
+    if (hw == NULL) return;
+
+    test_aes_backend(hw);
+
+    // The hardware must give the same output as the portable implementation for any key.
+    const AESBackend *sw = aesPortableBackend();
+    uchar key[16], block[16], a[16], b[16];
+    uint32_t x = 4711;
+    for (int i = 0; i < 1000; ++i)
+    {
+        for (int j = 0; j < 16; ++j) { x = x*1103515245+12345; key[j] = x >> 24; }
+        for (int j = 0; j < 16; ++j) { x = x*1103515245+12345; block[j] = x >> 24; }
+        AESRoundKeys hwk, swk;
+        hw->expandKey(key, &hwk);
+        sw->expandKey(key, &swk);
+        hw->encryptBlock(&hwk, block, a);
+        sw->encryptBlock(&swk, block, b);
+        if (memcmp(a, b, 16)) printf("ERROR in aes %s encrypt differs from portable\n", hw->name);
+        hw->decryptBlock(&hwk, block, a);
+        sw->decryptBlock(&swk, block, b);
+        if (memcmp(a, b, 16)) printf("ERROR in aes %s decrypt differs from portable\n", hw->name);
+    }
+}
+
+void test_meter_keys()
+{
+    MeterKeys mk;
+    if (mk.confidentialityKey() != NULL) printf("ERROR in meter keys expected no expanded key without a key\n");
+
+    vector<uchar> input;
+    hex2bin("00010000007856341207070707070707", &input);
+    if (mk.deriveKeys(&input[0]) != NULL) printf("ERROR in meter keys expected no derived keys without a key\n");
+
+    const char *keys[] = { "2b7e151628aed2a6abf7158809cf4f3c", "000102030405060708090a0b0c0d0e0f" };
+    for (const char *k : keys)
+    {
+        vector<uchar> key;
+        hex2bin(k, &key);
+        // The key is overwritten, the expansion must notice that the bytes changed.
+        mk.confidentiality_key = key;
+
+        AESCMACKey expected;
+        expandCMACKey(&mk.confidentiality_key[0], &expected);
+        const AESCMACKey *ck = mk.confidentialityKey();
+        if (ck == NULL || memcmp(ck->rk.enc, expected.rk.enc, sizeof(expected.rk.enc)) ||
+            memcmp(ck->K1, expected.K1, 16) || memcmp(ck->K2, expected.K2, 16))
+        {
+            printf("ERROR in meter keys expanded key for %s does not match\n", k);
+        }
+
+        uchar kenc[16], kmac[16];
+        AES_CMAC(&mk.confidentiality_key[0], &input[0], 16, kenc);
+        input[0] = 0x01;
+        AES_CMAC(&mk.confidentiality_key[0], &input[0], 16, kmac);
+        input[0] = 0x00;
+        for (int i = 0; i < 2; ++i)
+        {
+            const DerivedKeys *dk = mk.deriveKeys(&input[0]);
+            if (dk == NULL || memcmp(dk->kenc, kenc, 16) || memcmp(dk->kmac, kmac, 16))
+            {
+                printf("ERROR in meter keys derived keys for %s does not match\n", k);
+            }
+        }
+    }
+}
+
+// The key stream one bit at a time, as the LFSR is usually described.
+vector<uchar> diehl_lfsr_reference(const vector<uchar> &frame, uint32_t key)
+{
+    key ^= uint32FromBytes(frame, 2);
+    key ^= uint32FromBytes(frame, 6);
+    key ^= uint32FromBytes(frame, 10);
+    vector<uchar> decoded;
+    for (size_t i = 15; i < frame.size(); ++i)
+    {
+        for (int j = 0; j < 8; ++j)
+        {
+            uchar bit = ((key & 0x2) != 0) ^ ((key & 0x4) != 0) ^ ((key & 0x800) != 0) ^ ((key & 0x80000000) != 0);
+            key = (key << 1) | bit;
+        }
+        decoded.push_back(frame[i] ^ (key & 0xFF));
+    }
+    return decoded;
+}
+
+void test_diehl_lfsr()
+{
+    uint32_t x = 4711;
+    for (size_t len = 16; len < 64; ++len)
+    {
+        vector<uchar> frame(len);
+        for (auto &b : frame) { x = x*1103515245+12345; b = x >> 24; }
+        x = x*1103515245+12345;
+        uint32_t key = x;
+
+        vector<uchar> expected = diehl_lfsr_reference(frame, key);
+        uint32_t checksum = 0;
+        for (uchar b : expected) checksum += b;
+
+        vector<uchar> decoded = decodeDiehlLfsr(frame, frame, key, DiehlLfsrCheckMethod::CHECKSUM_AND_0XEF, checksum & 0xEF);
+        if (decoded != expected) printf("ERROR in diehl lfsr len %zu\n", len);
+
+        decoded = decodeDiehlLfsr(frame, frame, key, DiehlLfsrCheckMethod::HEADER_1_BYTE, expected[0]);
+        if (decoded != expected) printf("ERROR in diehl lfsr header check len %zu\n", len);
+
+        decoded = decodeDiehlLfsr(frame, frame, key, DiehlLfsrCheckMethod::HEADER_1_BYTE, expected[0]^1);
+        if (!decoded.empty()) printf("ERROR in diehl lfsr expected header check to fail len %zu\n", len);
+
+        // The key that succeeds is remembered and tried first next time.
+        vector<uint32_t> keys = { key^1, key^2, key };
+        size_t last_good = 0;
+        decoded = decodeDiehlLfsr(frame, frame, keys, &last_good, DiehlLfsrCheckMethod::HEADER_1_BYTE, expected[0]);
+        if (decoded != expected || last_good != 2) printf("ERROR in diehl lfsr keys len %zu\n", len);
+        decoded = decodeDiehlLfsr(frame, frame, keys, &last_good, DiehlLfsrCheckMethod::HEADER_1_BYTE, expected[0]);
+        if (decoded != expected || last_good != 2) printf("ERROR in diehl lfsr keys again len %zu\n", len);
+    }
+}
+
+void test_decryption_backoff()
+{
+    // A multical21 telegram encrypted with 28F64A24988064A079AA2C807D6102AE.
+    vector<uchar> frame;
+    hex2bin("2A442D2C998734761B168D2091D37CAC21E1D68CDAFFCD3DC452BD802913FF7B1706CA9E355D6C2701CC24", &frame);
+
+    shared_ptr<MeterManager> manager = createMeterManager(false);
+    vector<string> shells, jsons;
+    vector<string> ids = { "76348799" };
+    MeterInfo mi("", "m", MeterDriver::MULTICAL21, "", ids, "00112233445566778899AABBCCDDEEFF", LinkModeSet(), 0, shells, jsons);
+    manager->addMeter(createMeter(&mi));
+    Meter *m = manager->lastAddedMeter();
+
+    // Do not print the wrong key warning.
+    silentLogging(true);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    for (int i = 0; i < 10; ++i)
+    {
+        manager->handleTelegram(about, frame, false);
+    }
+    silentLogging(false);
+    // Three failures, then a try after skipping 1 and 2 telegrams, then 2 telegrams skipped.
+    if (m->numDecryptionFailures() != 5 || m->numDecryptionSkipped() != 5 || m->numUpdates() != 0)
+    {
+        printf("ERROR in decryption backoff expected 5 failures 5 skipped and no updates but got %d %d %d\n",
+               m->numDecryptionFailures(), m->numDecryptionSkipped(), m->numUpdates());
+    }
+
+    // Three failures, then a try after skipping 1, 2 and 4 telegrams. The 8th telegram
+    // was the last try, the right key is tried again with the 13th telegram.
+    vector<uchar> key;
+    hex2bin("28F64A24988064A079AA2C807D6102AE", &key);
+    m->meterKeys()->confidentiality_key = key;
+    int n = 0;
+    while (m->numUpdates() == 0 && n < 100)
+    {
+        manager->handleTelegram(about, frame, false);
+        n++;
+    }
+    if (n != 3 || m->numDecryptionFailures() != 5 || m->numDecryptionSkipped() != 7)
+    {
+        printf("ERROR in decryption backoff expected success after 3 telegrams, 5 failures and 7 skipped but got %d %d %d\n",
+               n, m->numDecryptionFailures(), m->numDecryptionSkipped());
+    }
+
+    // Working again, no telegrams are skipped.
+    manager->handleTelegram(about, frame, false);
+    if (m->numUpdates() != 2)
+    {
+        printf("ERROR in decryption backoff expected 2 updates but got %d\n", m->numUpdates());
+    }
+
+    // A wildcard meter does not stop decrypting its own telegrams because of
+    // a neighbour encrypted with another key, here the same telegram with another id.
+    vector<uchar> neighbour = frame;
+    neighbour[4] = neighbour[5] = neighbour[6] = neighbour[7] = 0x11;
+    shared_ptr<MeterManager> wildcard_manager = createMeterManager(false);
+    vector<string> wildcard = { "*" };
+    MeterInfo wmi("", "w", MeterDriver::MULTICAL21, "", wildcard, "28F64A24988064A079AA2C807D6102AE", LinkModeSet(), 0, shells, jsons);
+    wildcard_manager->addMeter(createMeter(&wmi));
+    Meter *w = wildcard_manager->lastAddedMeter();
+    silentLogging(true);
+    for (int i = 0; i < 10; ++i)
+    {
+        wildcard_manager->handleTelegram(about, neighbour, false);
+    }
+    silentLogging(false);
+    wildcard_manager->handleTelegram(about, frame, false);
+    if (w->numDecryptionFailures() != 5 || w->numDecryptionSkipped() != 5 || w->numUpdates() != 1)
+    {
+        printf("ERROR in decryption backoff expected 5 failures 5 skipped and 1 update for wildcard meter but got %d %d %d\n",
+               w->numDecryptionFailures(), w->numDecryptionSkipped(), w->numUpdates());
+    }
+
+    // The backoff is only kept for the most recently failed ids. After failing for
+    // 256 other neighbours, the first neighbour is tried again instead of skipped.
+    silentLogging(true);
+    for (int i = 0; i < 256; ++i)
+    {
+        vector<uchar> other = neighbour;
+        other[4] = i;
+        other[5] = 0x22;
+        wildcard_manager->handleTelegram(about, other, false);
+    }
+    int skipped = w->numDecryptionSkipped();
+    wildcard_manager->handleTelegram(about, neighbour, false);
+    silentLogging(false);
+    if (w->numDecryptionSkipped() != skipped || w->numDecryptionFailures() != 5+256+1)
+    {
+        printf("ERROR in decryption backoff expected the first neighbour to be forgotten but got %d %d\n",
+               w->numDecryptionSkipped()-skipped, w->numDecryptionFailures());
+    }
+}
+
+void test_shell_pool()
+{
+    char dir[] = "/tmp/wmbusmeters_shell_XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        printf("ERROR could not create dir for shell pool test\n");
+        return;
+    }
+    string file = string(dir)+"/out";
+    vector<string> args = { "-c", "printf $V >> "+file };
+
+    {
+        // Commands for the same key run in order, even with several processes.
+        ShellPool pool(4, 100);
+        for (const char *v : { "1", "2", "3", "4", "5" })
+        {
+            pool.invoke("meter", "/bin/sh", args, { string("V=")+v });
+        }
+        pool.drain();
+        vector<char> content;
+        loadFile(file, &content);
+        string got(content.begin(), content.end());
+        if (got != "12345") printf("ERROR in shell pool expected 12345 but got \"%s\"\n", got.c_str());
+        unlink(file.c_str());
+    }
+    {
+        // A full queue keeps only the latest value for the same key and command line.
+        silentLogging(true);
+        ShellPool pool(1, 1);
+        pool.invoke("meter", "/bin/sh", { "-c", "sleep 0.2" }, {});
+        usleep(50*1000);
+        pool.invoke("meter", "/bin/sh", args, { "V=a" });
+        pool.invoke("meter", "/bin/sh", args, { "V=b" });
+        pool.invoke("other", "/bin/sh", args, { "V=c" });
+        pool.drain();
+        silentLogging(false);
+        vector<char> content;
+        loadFile(file, &content);
+        string got(content.begin(), content.end());
+        if (got != "b") printf("ERROR in shell pool expected b but got \"%s\"\n", got.c_str());
+        unlink(file.c_str());
+    }
+    {
+        // A pipe shell that exits after each line is restarted for the next line.
+        ShellPipe pipe("read l; echo $l >> "+file, 1024);
+        silentLogging(true);
+        pipe.write("a");
+        usleep(200*1000);
+        pipe.write("b");
+        usleep(200*1000);
+        pipe.stop();
+        silentLogging(false);
+        vector<char> content;
+        loadFile(file, &content);
+        string got(content.begin(), content.end());
+        if (got != "a\nb\n") printf("ERROR in shell pipe expected a b but got \"%s\"\n", got.c_str());
+        unlink(file.c_str());
+    }
+    rmdir(dir);
+}
+
+static string fileContent(const string &file)
+{
+    vector<char> content;
+    loadFile(file, &content);
+    return string(content.begin(), content.end());
+}
+
+void test_file_cache()
+{
+    char dir[] = "/tmp/wmbusmeters_files_XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        printf("ERROR could not create dir for file cache test\n");
+        return;
+    }
+    string a = string(dir)+"/a";
+    string b = string(dir)+"/b";
+    string rotated = string(dir)+"/a.1";
+    {
+        // Lines are appended, the file is kept open.
+        FileCache files(1, 1024);
+        files.write("a", a, "1\n", false);
+        files.flush();
+        files.write("a", a, "2\n", false);
+        files.flush();
+        if (fileContent(a) != "1\n2\n") printf("ERROR in file cache, expected 1 2 but got \"%s\"\n", fileContent(a).c_str());
+
+        // A rotated file is created again.
+        rename(a.c_str(), rotated.c_str());
+        files.write("a", a, "3\n", false);
+        files.flush();
+        if (fileContent(a) != "3\n") printf("ERROR in file cache, expected 3 after rotate but got \"%s\"\n", fileContent(a).c_str());
+        if (fileContent(rotated) != "1\n2\n") printf("ERROR in file cache, rotated file was written\n");
+
+        // A new path for the same key, eg a new timestamp, closes the old file.
+        // Opening a second key closes the least recently used file.
+        files.write("a", b, "4\n", false);
+        if (fileContent(a) != "3\n") printf("ERROR in file cache, expected 3 after new path\n");
+        files.write("b", a, "5\n", true);
+        files.write("b", a, "6\n", true);
+        files.closeAll();
+        if (fileContent(b) != "4\n") printf("ERROR in file cache, expected 4 but got \"%s\"\n", fileContent(b).c_str());
+        if (fileContent(a) != "6\n") printf("ERROR in file cache, expected overwritten 6 but got \"%s\"\n", fileContent(a).c_str());
+    }
+    unlink(a.c_str());
+    unlink(b.c_str());
+    unlink(rotated.c_str());
+    rmdir(dir);
+}
+
+// The numbers in the json have always been formatted like this.
+static string toStringWithoutZeroes(double v)
+{
+    string s = to_string(v);
+    if (s.find('.') == string::npos) return s;
+    while (s.back() == '0') s.pop_back();
+    if (s.back() == '.') s.pop_back();
+    return s;
+}
+
+void test_json()
+{
+    vector<double> values = { 0, -0.0, 1, -1, 6.408, 0.1+0.2, 17.5, 0.0000005, 0.0000015, 0.0078125, -0.0000001,
+                              999999.9999999, 1000000, 123456789.123456789, 1e300, -1e-300, NAN, INFINITY, -INFINITY };
+    uint64_t x = 88172645463325252ull;
+    for (int i = 0; i < 100000; ++i)
+    {
+        // Random bits, scaled into the range of meter values.
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        values.push_back((double)(int64_t)x / (double)(1ull << (x%60)));
+        values.push_back((x%2000000)/1000000.0 - 1.0);
+        values.push_back((x%100000000)/1000.0 + 0.0000005);
+    }
+    for (double v : values)
+    {
+        string got;
+        appendNumber(&got, v);
+        string expected = toStringWithoutZeroes(v);
+        if (got != expected)
+        {
+            printf("ERROR in json number %.17g expected \"%s\" but got \"%s\"\n", v, expected.c_str(), got.c_str());
+            break;
+        }
+    }
+
+    string s;
+    JsonWriter w(&s);
+    w.beginObject();
+    w.key("total", "m3");
+    w.value(6.408);
+    w.key("name");
+    w.value("say \"hi\"\\\n\x01");
+    w.key("rssi_dbm");
+    w.value(-77);
+    w.keyValue("floor=5");
+    w.keyValue("empty");
+    w.endObject();
+    string expected = "{\"total_m3\":6.408,\"name\":\"say \\\"hi\\\"\\\\\\n\\u0001\",\"rssi_dbm\":-77,\"floor\":\"5\",\"empty\":\"\"}";
+    if (s != expected)
+    {
+        printf("ERROR in json writer expected %s but got %s\n", expected.c_str(), s.c_str());
+    }
+}
@@ -188,6 +188,84 @@ void Semaphore::notify()
     }
 }
 
+WorkerThread::WorkerThread(const char *name, size_t max_queued)
+    : name_(name), max_queued_(max_queued)
+{
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&work_posted_, NULL);
+    pthread_cond_init(&work_done_, NULL);
+    pthread_create(&thread_, NULL, dispatch, this);
+}
+
+WorkerThread::~WorkerThread()
+{
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&work_posted_);
+    pthread_mutex_unlock(&mutex_);
+
+    pthread_join(thread_, NULL);
+
+    pthread_cond_destroy(&work_done_);
+    pthread_cond_destroy(&work_posted_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+void WorkerThread::post(function<void()> work)
+{
+    pthread_mutex_lock(&mutex_);
+    while (queue_.size() >= max_queued_)
+    {
+        trace("[WAITING] %s is full\n", name_);
+        pthread_cond_wait(&work_done_, &mutex_);
+    }
+    queue_.push_back(std::move(work));
+    pthread_cond_signal(&work_posted_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+void WorkerThread::drain()
+{
+    pthread_mutex_lock(&mutex_);
+    while (queue_.size() > 0 || busy_)
+    {
+        pthread_cond_wait(&work_done_, &mutex_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+void *WorkerThread::dispatch(void *ptr)
+{
+    static_cast<WorkerThread*>(ptr)->loop();
+    return NULL;
+}
+
+void WorkerThread::loop()
+{
+    pthread_mutex_lock(&mutex_);
+    for (;;)
+    {
+        while (queue_.size() == 0 && !stop_)
+        {
+            pthread_cond_wait(&work_posted_, &mutex_);
+        }
+        // Stop only when all posted work is done.
+        if (queue_.size() == 0) break;
+
+        function<void()> work = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        pthread_mutex_unlock(&mutex_);
+
+        work();
+
+        pthread_mutex_lock(&mutex_);
+        busy_ = false;
+        pthread_cond_broadcast(&work_done_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
 size_t getPeakRSS()
 {
     struct rusage rusage;
@@ -21,6 +21,7 @@
 #include "util.h"
 
 #include <assert.h>
+#include <deque>
 #include <errno.h>
 #include <functional>
 #include <pthread.h>
@@ -52,6 +53,36 @@ void startEventLoopThread(std::function<void()> cb);
 pthread_t getTimerLoopThread();
 void startTimerLoopThread(std::function<void()> cb);
 
+// Decode worker threads are optional (--decodethreads=<n>). When used, the event loop
+// thread only performs the wmbus-dongle protocol decoding and the telegram header parsing.
+// The telegram is then posted to the worker that owns the meter id, which parses, decrypts
+// and prints it. Telegrams for the same meter are therefore handled in order.
+struct WorkerThread
+{
+    WorkerThread(const char *name, size_t max_queued);
+    // Finishes all posted work before the thread is joined.
+    ~WorkerThread();
+    // Post work to the thread. Blocks if max_queued work items are already waiting.
+    void post(std::function<void()> work);
+    // Wait until all posted work has been done.
+    void drain();
+
+private:
+
+    static void *dispatch(void *ptr);
+    void loop();
+
+    const char *name_;
+    size_t max_queued_;
+    pthread_t thread_ {};
+    pthread_mutex_t mutex_;
+    pthread_cond_t work_posted_;
+    pthread_cond_t work_done_;
+    std::deque<std::function<void()>> queue_;
+    bool busy_ {};
+    bool stop_ {};
+};
+
 
 size_t getPeakRSS();
 size_t getCurrentRSS();
@@ -24,6 +24,7 @@
 #include<dirent.h>
 #include<functional>
 #include<grp.h>
+#include<math.h>
 #include<pwd.h>
 #include<signal.h>
 #include<stdarg.h>
@@ -255,7 +256,7 @@ void strprintf(std::string &s, const char* fmt, ...)
     s = buf;
 }
 
-void xorit(uchar *srca, uchar *srcb, uchar *dest, int len)
+void xorit(const uchar *srca, const uchar *srcb, uchar *dest, int len)
 {
     for (int i=0; i<len; ++i) { dest[i] = srca[i]^srcb[i]; }
 }
@@ -292,6 +293,43 @@ bool log_telegrams_enabled_ = false;
 bool internal_testing_enabled_ = false;
 
 string log_file_;
+// The log file is kept open, it is reopened when it has been moved or removed, eg by logrotate.
+int log_fd_ = -1;
+time_t log_file_checked_ {};
+pthread_mutex_t log_file_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+static void closeLogFile()
+{
+    pthread_mutex_lock(&log_file_mutex_);
+    if (log_fd_ != -1) close(log_fd_);
+    log_fd_ = -1;
+    pthread_mutex_unlock(&log_file_mutex_);
+}
+
+static bool writeLogFile(const string &line)
+{
+    pthread_mutex_lock(&log_file_mutex_);
+    time_t now = time(NULL);
+    if (log_fd_ != -1 && now != log_file_checked_)
+    {
+        // Check at most once a second if the log file has been rotated.
+        log_file_checked_ = now;
+        if (!FileCache::sameFile(log_fd_, log_file_))
+        {
+            close(log_fd_);
+            log_fd_ = -1;
+        }
+    }
+    if (log_fd_ == -1)
+    {
+        log_fd_ = open(log_file_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        log_file_checked_ = now;
+    }
+    // A single write, lines from different threads are not mixed.
+    bool ok = log_fd_ != -1 && write(log_fd_, line.data(), line.size()) == (ssize_t)line.size();
+    pthread_mutex_unlock(&log_file_mutex_);
+    return ok;
+}
 
 void silentLogging(bool b) {
     logging_silenced_ = b;
@@ -303,6 +341,8 @@ void enableSyslog() {
 
 bool enableLogfile(string logfile, bool daemon)
 {
+    // Also after a SIGHUP, a new log file is opened at the next log line.
+    closeLogFile();
     log_file_ = logfile;
     logfile_enabled_ = true;
     FILE *output = fopen(log_file_.c_str(), "a");
@@ -328,6 +368,7 @@ bool enableLogfile(string logfile, bool daemon)
 void disableLogfile()
 {
     logfile_enabled_ = false;
+    closeLogFile();
 }
 
 void verboseEnabled(bool b) {
@@ -401,17 +442,26 @@ void output_stuff(int syslog_level, bool use_timestamp, const char *fmt, va_list
     }
     if (logfile_enabled_)
     {
-        // Open close at every log occasion, should not be too big of
-        // a performance issue, since normal reception speed of
-        // wmbusmessages are quite low.
-        FILE *output = fopen(log_file_.c_str(), "a");
-        if (output)
+        string line;
+        if (add_timestamp) line = "["+timestamp+"] ";
+        va_list copy;
+        va_copy(copy, args);
+        char buf[1024];
+        int n = vsnprintf(buf, sizeof(buf), fmt, copy);
+        va_end(copy);
+        if (n >= (int)sizeof(buf))
         {
-            if (add_timestamp) fprintf(output, "[%s] ", timestamp.c_str());
-            vfprintf(output, fmt, args);
-            fclose(output);
+            vector<char> big(n+1);
+            va_copy(copy, args);
+            vsnprintf(&big[0], big.size(), fmt, copy);
+            va_end(copy);
+            line += &big[0];
         }
-        else
+        else if (n > 0)
+        {
+            line += buf;
+        }
+        if (!writeLogFile(line))
         {
             // Ouch, disable the log file.
             // Reverting to syslog or stdout depending on settings.
@@ -687,10 +737,10 @@ bool hasWildCard(string &mes)
     return mes.find('*') != string::npos;
 }
 
-bool doesIdsMatchExpressions(vector<string> &ids, vector<string>& mes, bool *used_wildcard)
+bool doesIdsMatchExpressions(const vector<string> &ids, const vector<string>& mes, bool *used_wildcard)
 {
     bool match = false;
-    for (string &id : ids)
+    for (const string &id : ids)
     {
         if (doesIdMatchExpressions(id, mes, used_wildcard))
         {
@@ -702,7 +752,7 @@ bool doesIdsMatchExpressions(vector<string> &ids, vector<string>& mes, bool *use
     return match;
 }
 
-bool doesIdMatchExpressions(string id, vector<string>& mes, bool *used_wildcard)
+bool doesIdMatchExpressions(string id, const vector<string>& mes, bool *used_wildcard)
 {
     bool found_match = false;
     bool found_negative_match = false;
@@ -781,6 +831,115 @@ string toIdsCommaSeparated(std::vector<std::string> &ids)
     return cs;
 }
 
+bool idToBinary(const string &id, uint32_t *out)
+{
+    if (id.length() != 8) return false;
+
+    uint32_t v = 0;
+    for (char c : id)
+    {
+        int n = char2int(c);
+        if (n < 0) return false;
+        v = (v << 4) | n;
+    }
+    *out = v;
+    return true;
+}
+
+IdMatcher::IdMatcher(const vector<string> &mes) : mes_(mes), compiled_(true)
+{
+    for (const string &me : mes)
+    {
+        IdMatchRule r;
+        size_t i = 0;
+        if (i < me.length() && me[i] == '!')
+        {
+            r.negated = true;
+            i++;
+        }
+        int digits = 0;
+        for (; i < me.length() && me[i] != '*'; ++i)
+        {
+            // Only lower case hex, just like the telegram ids, otherwise leave it to the string matching.
+            int n = (me[i] >= 'A' && me[i] <= 'F') ? -1 : char2int(me[i]);
+            if (n < 0 || digits >= 8)
+            {
+                compiled_ = false;
+                return;
+            }
+            r.value |= ((uint32_t)n) << (28-4*digits);
+            r.mask |= 0xfu << (28-4*digits);
+            digits++;
+        }
+        if (i < me.length())
+        {
+            // The * must be last.
+            r.wildcard = true;
+            if (i != me.length()-1)
+            {
+                compiled_ = false;
+                return;
+            }
+        }
+        else if (digits != 8)
+        {
+            compiled_ = false;
+            return;
+        }
+        rules_.push_back(r);
+    }
+}
+
+bool IdMatcher::matches(uint32_t id, bool *used_wildcard) const
+{
+    bool found_match = false;
+    bool found_negative_match = false;
+    bool exact_match = false;
+    *used_wildcard = false;
+
+    for (const IdMatchRule &r : rules_)
+    {
+        if ((id & r.mask) != r.value) continue;
+
+        if (r.negated)
+        {
+            found_negative_match = true;
+        }
+        else
+        {
+            found_match = true;
+            if (!r.wildcard) exact_match = true;
+        }
+    }
+
+    if (found_negative_match) return false;
+    if (!found_match) return false;
+    *used_wildcard = !exact_match;
+    return true;
+}
+
+bool IdMatcher::matches(const vector<string> &ids, bool *used_wildcard) const
+{
+    bool match = false;
+    for (const string &id : ids)
+    {
+        uint32_t bid;
+        bool m;
+        if (compiled_ && idToBinary(id, &bid))
+        {
+            m = matches(bid, used_wildcard);
+        }
+        else
+        {
+            m = doesIdMatchExpressions(id, mes_, used_wildcard);
+        }
+        if (m) match = true;
+        // Go through all ids even though there is an early match.
+        // This way we can see if theres an exact match later.
+    }
+    return match;
+}
+
 bool isFrequency(std::string& fq)
 {
     int len = fq.length();
@@ -909,21 +1068,21 @@ bool checkIfDirExists(const char *dir)
     return false;
 }
 
-void debugPayload(string intro, vector<uchar> &payload)
+void debugPayload(const char *intro, vector<uchar> &payload)
 {
     if (isDebugEnabled())
     {
         string msg = bin2hex(payload);
-        debug("%s \"%s\"\n", intro.c_str(), msg.c_str());
+        debug("%s \"%s\"\n", intro, msg.c_str());
     }
 }
 
-void debugPayload(string intro, vector<uchar> &payload, vector<uchar>::iterator &pos)
+void debugPayload(const char *intro, vector<uchar> &payload, vector<uchar>::iterator &pos)
 {
     if (isDebugEnabled())
     {
         string msg = bin2hex(pos, payload.end(), 1024);
-        debug("%s \"%s\"\n", intro.c_str(), msg.c_str());
+        debug("%s \"%s\"\n", intro, msg.c_str());
     }
 }
 
@@ -1046,19 +1205,84 @@ uint16_t crc16_EN13757_per_byte(uint16_t crc, uchar b)
     return crc;
 }
 
-uint16_t crc16_EN13757(uchar *data, size_t len)
+// The tables are built from crc16_EN13757_per_byte. Table k holds the crc
+// of a byte followed by k zero bytes, which lets the crc consume eight bytes
+// per step (slicing-by-8). Most blocks in a frame are 16 bytes long.
+struct Crc16EN13757Tables
 {
+    uint16_t t[8][256];
+
+    Crc16EN13757Tables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            t[0][i] = crc16_EN13757_per_byte(0, i);
+        }
+        for (int k = 1; k < 8; ++k)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                t[k][i] = (t[k-1][i] << 8) ^ t[0][t[k-1][i] >> 8];
+            }
+        }
+    }
+};
+
+uint16_t crc16_EN13757(const uchar *data, size_t len)
+{
+    static const Crc16EN13757Tables tables;
+    const uint16_t (&t)[8][256] = tables.t;
     uint16_t crc = 0x0000;
 
     assert(len == 0 || data != NULL);
     assert(len < 1024);
-    for (size_t i=0; i<len; ++i) {
-        crc = crc16_EN13757_per_byte(crc, data[i]);
+    while (len >= 8)
+    {
+        crc = t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xff)] ^
+            t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+    while (len > 0)
+    {
+        crc = (crc << 8) ^ t[0][(crc >> 8) ^ *data];
+        data++;
+        len--;
     }
 
     return (~crc);
 }
 
+uint64_t hash64(const uchar *data, size_t len)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+
+    // Mix in eight bytes at a time, then the remaining bytes.
+    while (len >= 8)
+    {
+        uint64_t w;
+        memcpy(&w, data, 8);
+        h = (h ^ w) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 31;
+        data += 8;
+        len -= 8;
+    }
+    uint64_t w = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        w |= (uint64_t)data[i] << (i*8);
+    }
+    h = (h ^ w) * 0xbf58476d1ce4e5b9ULL;
+
+    // The final mix of splitmix64.
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
 #define CRC16_INIT_VALUE 0xFFFF
 #define CRC16_GOOD_VALUE 0x0F47
 #define CRC16_POLYNOM    0x8408
@@ -1188,6 +1412,187 @@ bool loadFile(string file, vector<char> *buf)
     return true;
 }
 
+FileCache::FileCache(size_t max_open, size_t max_buffered)
+    : max_open_(max_open), max_buffered_(max_buffered)
+{
+    pthread_mutex_init(&mutex_, NULL);
+}
+
+FileCache::~FileCache()
+{
+    closeAll();
+    pthread_mutex_destroy(&mutex_);
+}
+
+bool FileCache::write(const string &key, const string &path, const string &data, bool overwrite)
+{
+    pthread_mutex_lock(&mutex_);
+
+    auto i = files_.find(key);
+    if (i != files_.end() && (i->second.path != path || i->second.overwrite != overwrite))
+    {
+        // A new timestamp in the file name, the old file will not be written again.
+        close(key);
+        i = files_.end();
+    }
+    if (i == files_.end())
+    {
+        if (files_.size() >= max_open_ && !lru_.empty())
+        {
+            close(lru_.back());
+        }
+        File f;
+        f.path = path;
+        f.overwrite = overwrite;
+        if (!open(f))
+        {
+            pthread_mutex_unlock(&mutex_);
+            return false;
+        }
+        lru_.push_front(key);
+        f.lru = lru_.begin();
+        i = files_.insert({ key, f }).first;
+    }
+    else
+    {
+        lru_.splice(lru_.begin(), lru_, i->second.lru);
+    }
+
+    File &f = i->second;
+    if (overwrite)
+    {
+        buffered_ -= f.buffer.size();
+        f.buffer = data;
+    }
+    else
+    {
+        f.buffer += data;
+    }
+    buffered_ += data.size();
+    lines_++;
+
+    time_t now = time(NULL);
+    if (buffered_ > max_buffered_ || now - last_flush_ >= 1)
+    {
+        flushLocked();
+    }
+
+    pthread_mutex_unlock(&mutex_);
+    return true;
+}
+
+void FileCache::flush()
+{
+    pthread_mutex_lock(&mutex_);
+    flushLocked();
+    pthread_mutex_unlock(&mutex_);
+}
+
+void FileCache::flushLocked()
+{
+    for (auto &p : files_)
+    {
+        flush(p.second);
+    }
+    last_flush_ = time(NULL);
+}
+
+void FileCache::closeAll()
+{
+    pthread_mutex_lock(&mutex_);
+    while (!files_.empty())
+    {
+        close(files_.begin()->first);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+void FileCache::logStats(const char *what)
+{
+    pthread_mutex_lock(&mutex_);
+    if (lines_ > 0)
+    {
+        verbose("(%s) %zu lines written to files using %zu writes and %zu opens\n", what, lines_, writes_, opens_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+bool FileCache::sameFile(int fd, const string &path)
+{
+    struct stat opened, current;
+    if (fstat(fd, &opened) != 0) return false;
+    if (stat(path.c_str(), &current) != 0) return false;
+    return opened.st_dev == current.st_dev && opened.st_ino == current.st_ino;
+}
+
+bool FileCache::open(File &f)
+{
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+    if (!f.overwrite) flags |= O_APPEND;
+    f.fd = ::open(f.path.c_str(), flags, 0666);
+    if (f.fd == -1)
+    {
+        warning("Could not open file \"%s\" for writing!\n", f.path.c_str());
+        return false;
+    }
+    opens_++;
+    return true;
+}
+
+bool FileCache::flush(File &f)
+{
+    if (f.buffer.empty()) return true;
+
+    if (f.fd != -1 && !FileCache::sameFile(f.fd, f.path))
+    {
+        // The file has been moved or removed, eg by logrotate, create it again.
+        debug("(files) reopening %s\n", f.path.c_str());
+        ::close(f.fd);
+        f.fd = -1;
+    }
+
+    bool ok = f.fd != -1 || open(f);
+    if (ok)
+    {
+        const char *data = f.buffer.data();
+        size_t left = f.buffer.size();
+        off_t offset = 0;
+        while (left > 0)
+        {
+            ssize_t n = f.overwrite ? pwrite(f.fd, data, left, offset) : ::write(f.fd, data, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            data += n;
+            offset += n;
+            left -= n;
+        }
+        if (f.overwrite && left == 0 && ftruncate(f.fd, offset) != 0) left = 1;
+        ok = left == 0;
+        writes_++;
+        if (!ok)
+        {
+            warning("Could not write file \"%s\"!\n", f.path.c_str());
+            ::close(f.fd);
+            f.fd = -1;
+        }
+    }
+
+    buffered_ -= f.buffer.size();
+    f.buffer.clear();
+    return ok;
+}
+
+void FileCache::close(const string &key)
+{
+    auto i = files_.find(key);
+    if (i == files_.end()) return;
+    File &f = i->second;
+    flush(f);
+    if (f.fd != -1) ::close(f.fd);
+    lru_.erase(f.lru);
+    files_.erase(i);
+}
+
 string eatToSkipWhitespace(vector<char> &v, vector<char>::iterator &i, int c, size_t max, bool *eof, bool *err)
 {
     eatWhitespace(v, i, eof);
@@ -1382,22 +1787,137 @@ bool startsWith(string &s, const char *prefix)
     return !strncmp(&s[0], prefix, len);
 }
 
-string makeQuotedJson(string &s)
+void appendNumber(string *out, double v)
 {
-    size_t p = s.find('=');
-    string key, value;
-    if (p != string::npos)
+    // Values below a million have at least 13 bits of fraction left after scaling to micros,
+    // the rounding to micros is then exact, unless we are close to a tie where printf decides.
+    double a = fabs(v);
+    if (a < 1000000.0)
     {
-        key = s.substr(0,p);
-        value = s.substr(p+1);
+        double x = a*1000000.0;
+        double r = floor(x);
+        double f = x-r;
+        if (fabs(f-0.5) > 0.001)
+        {
+            uint64_t micros = (uint64_t)r + (f > 0.5 ? 1 : 0);
+            uint64_t integer = micros/1000000;
+            uint32_t decimals = micros%1000000;
+            char buf[32];
+            char *p = buf+sizeof(buf);
+            int digits = 6;
+            // Drop the trailing zeros of the decimals.
+            while (digits > 0 && decimals%10 == 0)
+            {
+                decimals /= 10;
+                digits--;
+            }
+            for (int i = 0; i < digits; ++i)
+            {
+                *--p = '0'+decimals%10;
+                decimals /= 10;
+            }
+            if (digits > 0) *--p = '.';
+            do
+            {
+                *--p = '0'+integer%10;
+                integer /= 10;
+            } while (integer > 0);
+            if (signbit(v)) *--p = '-';
+            out->append(p, buf+sizeof(buf)-p);
+            return;
+        }
     }
-    else
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "%f", v);
+    if (n >= (int)sizeof(buf)) n = sizeof(buf)-1;
+    if (strchr(buf, '.'))
     {
-        key = s;
-        value = "";
+        while (n > 0 && buf[n-1] == '0') n--;
+        if (n > 0 && buf[n-1] == '.') n--;
     }
+    if (n == 0) out->push_back('0');
+    else out->append(buf, n);
+}
 
-    return string("\"")+key+"\":\""+value+"\"";
+void JsonWriter::key(const string &name, const char *suffix)
+{
+    if (!first_) out_->push_back(',');
+    first_ = false;
+    out_->push_back('"');
+    appendEscaped(name.data(), name.length());
+    if (suffix)
+    {
+        out_->push_back('_');
+        appendEscaped(suffix, strlen(suffix));
+    }
+    out_->append("\":", 2);
+}
+
+void JsonWriter::value(const string &s)
+{
+    out_->push_back('"');
+    appendEscaped(s.data(), s.length());
+    out_->push_back('"');
+}
+
+void JsonWriter::value(const char *s)
+{
+    out_->push_back('"');
+    appendEscaped(s, strlen(s));
+    out_->push_back('"');
+}
+
+void JsonWriter::value(int v)
+{
+    char buf[16];
+    int n = snprintf(buf, sizeof(buf), "%d", v);
+    out_->append(buf, n);
+}
+
+void JsonWriter::keyValue(const string &alfa_is_beta)
+{
+    size_t p = alfa_is_beta.find('=');
+    if (!first_) out_->push_back(',');
+    first_ = false;
+    out_->push_back('"');
+    if (p == string::npos)
+    {
+        appendEscaped(alfa_is_beta.data(), alfa_is_beta.length());
+        out_->append("\":\"\"", 4);
+        return;
+    }
+    appendEscaped(alfa_is_beta.data(), p);
+    out_->append("\":\"", 3);
+    appendEscaped(alfa_is_beta.data()+p+1, alfa_is_beta.length()-p-1);
+    out_->push_back('"');
+}
+
+void JsonWriter::appendEscaped(const char *s, size_t len)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out_->append(s+start, i-start);
+        start = i+1;
+        switch (c)
+        {
+        case '"': out_->append("\\\"", 2); break;
+        case '\\': out_->append("\\\\", 2); break;
+        case '\n': out_->append("\\n", 2); break;
+        case '\r': out_->append("\\r", 2); break;
+        case '\t': out_->append("\\t", 2); break;
+        default:
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out_->append(buf, 6);
+        }
+        }
+    }
+    out_->append(s+start, len-start);
 }
 
 string currentYear()
@@ -22,7 +22,9 @@
 #include<stdint.h>
 #include<string>
 #include<functional>
+#include<list>
 #include<map>
+#include<pthread.h>
 #include<vector>
 
 void onExit(std::function<void()> cb);
@@ -58,7 +60,7 @@ void addMonths(struct tm* date, int m);
 
 bool stringFoundCaseIgnored(std::string haystack, std::string needle);
 
-void xorit(uchar *srca, uchar *srcb, uchar *dest, int len);
+void xorit(const uchar *srca, const uchar *srcb, uchar *dest, int len);
 void shiftLeft(uchar *srca, uchar *srcb, int len);
 std::string format3fdot3f(double v);
 bool enableLogfile(std::string logfile, bool daemon);
@@ -93,8 +95,8 @@ bool isVerboseEnabled();
 bool isDebugEnabled();
 bool isLogTelegramsEnabled();
 
-void debugPayload(std::string intro, std::vector<uchar> &payload);
-void debugPayload(std::string intro, std::vector<uchar> &payload, std::vector<uchar>::iterator &pos);
+void debugPayload(const char *intro, std::vector<uchar> &payload);
+void debugPayload(const char *intro, std::vector<uchar> &payload, std::vector<uchar>::iterator &pos);
 void logTelegram(std::vector<uchar> &original, std::vector<uchar> &parsed, int header_size, int suffix_size);
 
 enum class Alarm
@@ -114,9 +116,42 @@ bool isValidBps(std::string b);
 bool isValidMatchExpression(std::string id, bool non_compliant);
 bool isValidMatchExpressions(std::string ids, bool non_compliant);
 bool doesIdMatchExpression(std::string id, std::string match_rule);
-bool doesIdMatchExpressions(std::string id, std::vector<std::string>& match_rules, bool *used_wildcard);
-bool doesIdsMatchExpressions(std::vector<std::string> &ids, std::vector<std::string>& match_rules, bool *used_wildcard);
+bool doesIdMatchExpressions(std::string id, const std::vector<std::string>& match_rules, bool *used_wildcard);
+bool doesIdsMatchExpressions(const std::vector<std::string> &ids, const std::vector<std::string>& match_rules, bool *used_wildcard);
 std::string toIdsCommaSeparated(std::vector<std::string> &ids);
+// Convert an exact 8 digit bcd/hex id, like 12345678, into its 32 bit value.
+// Returns false if the id is not exactly 8 bcd/hex digits, eg a match expression with * or !.
+bool idToBinary(const std::string &id, uint32_t *out);
+
+// A single match expression compiled into a mask/value pair over the 32 bit id.
+// 123* becomes mask 0xfff00000 value 0x12300000.
+struct IdMatchRule
+{
+    uint32_t mask {};
+    uint32_t value {};
+    bool negated {};
+    bool wildcard {};
+};
+
+// Match expressions compiled once, when the configuration is loaded, so that
+// matching a telegram id is a few integer operations instead of string work.
+// Gives the same results as doesIdsMatchExpressions.
+struct IdMatcher
+{
+    bool matches(const std::vector<std::string> &ids, bool *used_wildcard) const;
+    bool matches(uint32_t id, bool *used_wildcard) const;
+
+    IdMatcher() {}
+    IdMatcher(const std::vector<std::string> &mes);
+
+private:
+
+    std::vector<IdMatchRule> rules_;
+    // The original expressions are used for ids that are not 8 digits (like mbus primary addresses)
+    // and if an expression could not be compiled.
+    std::vector<std::string> mes_;
+    bool compiled_ {};
+};
 
 bool isValidId(std::string id, bool accept_non_compliant);
 
@@ -136,6 +171,58 @@ bool listFiles(std::string dir, std::vector<std::string> *files);
 int loadFile(std::string file, std::vector<std::string> *lines);
 bool loadFile(std::string file, std::vector<char> *buf);
 
+// Keeps the most recently written files open and buffers the writes, instead of opening
+// and closing a file for every line. The buffers are written when more than max_buffered
+// bytes are waiting, or when a second has passed since the last flush. A file that has been
+// moved or removed, eg by logrotate, is reopened when it is written. At most max_open files
+// are kept open, the least recently used file is closed first.
+struct FileCache
+{
+    FileCache(size_t max_open, size_t max_buffered);
+    // Writes the buffers and closes the files.
+    ~FileCache();
+    // Append data to the file at path. The key names the file independently of the path,
+    // eg the meterfile without its timestamp. When the path for a key changes, the file for
+    // the old path is closed. If overwrite is true, the data replaces the content of the file.
+    bool write(const std::string &key, const std::string &path, const std::string &data, bool overwrite);
+    // Write all buffers now.
+    void flush();
+    // Write all buffers and close the files.
+    void closeAll();
+    // Print the number of opens and writes in verbose mode.
+    void logStats(const char *what);
+    // True if fd is still the file found at path.
+    static bool sameFile(int fd, const std::string &path);
+
+private:
+
+    struct File
+    {
+        std::string path;
+        int fd {-1};
+        bool overwrite {};
+        std::string buffer;
+        std::list<std::string>::iterator lru;
+    };
+
+    bool open(File &f);
+    bool flush(File &f);
+    void flushLocked();
+    void close(const std::string &key);
+
+    size_t max_open_;
+    size_t max_buffered_;
+    size_t buffered_ {};
+    time_t last_flush_ {};
+    pthread_mutex_t mutex_;
+    std::map<std::string,File> files_;
+    // The keys of the open files, most recently written first.
+    std::list<std::string> lru_;
+    size_t opens_ {};
+    size_t lines_ {};
+    size_t writes_ {};
+};
+
 std::string eatTo(std::vector<uchar> &v, std::vector<uchar>::iterator &i, int c, size_t max, bool *eof, bool *err);
 
 void padWithZeroesTo(std::vector<uchar> *content, size_t len, std::vector<uchar> *full_content);
@@ -151,7 +238,10 @@ int parseTime(std::string time);
 bool isInsideTimePeriod(time_t now, std::string periods);
 bool isValidTimePeriod(std::string periods);
 
-uint16_t crc16_EN13757(uchar *data, size_t len);
+uint16_t crc16_EN13757(const uchar *data, size_t len);
+
+// A fast 64 bit hash, not cryptographic, used to recognize identical telegrams.
+uint64_t hash64(const uchar *data, size_t len);
 
 // This crc is used by im871a for its serial communication.
 uint16_t crc16_CCITT(uchar *data, uint16_t length);
@@ -177,8 +267,33 @@ int countSetBits(int v);
 
 bool startsWith(std::string &s, const char *prefix);
 
-// Given alfa=beta it returns "alfa":"beta"
-std::string makeQuotedJson(std::string &s);
+// Append the number formatted as std::to_string does, with the trailing zeros
+// of the decimals removed, eg 6.408 and 17 and 0.000123.
+void appendNumber(std::string *out, double v);
+
+// Appends the members of a json object to a string, without temporary strings.
+// Strings are escaped only if they contain a quote, a backslash or a control character.
+struct JsonWriter
+{
+    JsonWriter(std::string *out) : out_(out) {}
+    void beginObject() { out_->push_back('{'); first_ = true; }
+    void endObject() { out_->push_back('}'); }
+    // The key is name, or name_suffix if a suffix is given.
+    void key(const std::string &name, const char *suffix = NULL);
+    void value(const std::string &s);
+    void value(const char *s);
+    void value(double v) { appendNumber(out_, v); }
+    void value(int v);
+    // Given alfa=beta adds "alfa":"beta"
+    void keyValue(const std::string &alfa_is_beta);
+
+private:
+
+    void appendEscaped(const char *s, size_t len);
+
+    std::string *out_;
+    bool first_ {true};
+};
 
 std::string currentYear();
 std::string currentDay();
@@ -16,7 +16,6 @@
 */
 
 #include"aescmac.h"
-#include"sha256.h"
 #include"timings.h"
 #include"wmbus.h"
 #include"wmbus_common_implementation.h"
@@ -32,6 +31,7 @@
 #include<unistd.h>
 
 #include<deque>
+#include<unordered_map>
 #include<algorithm>
 
 struct LinkModeInfo
@@ -197,26 +197,63 @@ struct Manufacturer {
     const char *code;
     int m_field;
     const char *name;
+};
 
-    Manufacturer(const char *c, int m, const char *n) {
-        code = c;
-        m_field = m;
-        name = n;
-    }
+// The list of manufacturers is sorted on the code, and since MANFCODE packs
+// the letters from most to least significant, it is also sorted on the m_field.
+// A few codes appear twice, the lookup returns the first of them.
+constexpr Manufacturer manufacturers_[] = {
+#define X(key,code,name) { #key, code, name },
+LIST_OF_MANUFACTURERS
+#undef X
 };
 
-vector<Manufacturer> manufacturers_;
+constexpr size_t num_manufacturers_ = sizeof(manufacturers_)/sizeof(manufacturers_[0]);
 
-struct Initializer { Initializer(); };
+// Check the halves recursively to keep the constexpr recursion depth logarithmic.
+constexpr bool areManufacturersSorted(size_t from, size_t to)
+{
+    return to-from <= 1 ||
+        (areManufacturersSorted(from, (from+to)/2) &&
+         areManufacturersSorted((from+to)/2, to) &&
+         manufacturers_[(from+to)/2-1].m_field <= manufacturers_[(from+to)/2].m_field);
+}
 
-static Initializer initializser_;
+static_assert(areManufacturersSorted(0, num_manufacturers_), "manufacturers must be sorted on m_field");
 
-Initializer::Initializer() {
+const AESCMACKey *MeterKeys::confidentialityKey()
+{
+    if (confidentiality_key.size() != 16) return NULL;
 
-#define X(key,code,name) manufacturers_.push_back(Manufacturer(#key,code,name));
-LIST_OF_MANUFACTURERS
-#undef X
+    if (!expanded_ || memcmp(expanded_from_, &confidentiality_key[0], 16))
+    {
+        memcpy(expanded_from_, &confidentiality_key[0], 16);
+        expandCMACKey(expanded_from_, &expanded_key_);
+        expanded_ = true;
+        // The derived keys belong to the old key.
+        derived_ = false;
+    }
+    return &expanded_key_;
+}
 
+const DerivedKeys *MeterKeys::deriveKeys(const uchar *input)
+{
+    const AESCMACKey *key = confidentialityKey();
+    if (key == NULL) return NULL;
+
+    if (derived_ && !memcmp(derived_keys_.input, input, 16)) return &derived_keys_;
+
+    uchar mac_input[16];
+    memcpy(derived_keys_.input, input, 16);
+    AES_CMAC(key, input, 16, derived_keys_.kenc);
+    memcpy(mac_input, input, 16);
+    mac_input[0] = 0x01; // DC 01 = generate ephemereal mac key from meter.
+    AES_CMAC(key, mac_input, 16, derived_keys_.kmac);
+
+    aesBackend()->expandKey(derived_keys_.kenc, &derived_keys_.kenc_rk);
+    expandCMACKey(derived_keys_.kmac, &derived_keys_.kmac_ck);
+    derived_ = true;
+    return &derived_keys_;
 }
 
 void Telegram::print()
@@ -232,7 +269,7 @@ void Telegram::print()
     notice("Received telegram from: %02x%02x%02x%02x\n", a,b,c,d);
     notice("          manufacturer: (%s) %s (0x%02x)\n",
            manufacturerFlag(dll_mfct).c_str(),
-           manufacturer(dll_mfct).c_str(),
+           manufacturer(dll_mfct),
            dll_mfct);
     notice("                  type: %s (0x%02x)\n", mediaType(dll_type, dll_mfct).c_str(), dll_type);
 
@@ -243,7 +280,7 @@ void Telegram::print()
         notice("      Concerning meter: %02x%02x%02x%02x\n", tpl_id_b[3],tpl_id_b[2],tpl_id_b[1],tpl_id_b[0]);
         notice("          manufacturer: (%s) %s (0x%02x)\n",
            manufacturerFlag(tpl_mfct).c_str(),
-           manufacturer(tpl_mfct).c_str(),
+           manufacturer(tpl_mfct),
            tpl_mfct);
         notice("                  type: %s (0x%02x)\n", mediaType(tpl_type, dll_mfct).c_str(), tpl_type);
 
@@ -346,43 +383,80 @@ void Telegram::printTPL()
     verbose("\n");
 }
 
-// Store the hashes of the last 10 telegrams here.
-deque<SHA256_HASH> seen_telegrams;
-
-bool seen_this_telegram_before(vector<uchar> &frame)
+// Several dongles, or a dongle and a repeater, often hear the same telegram.
+// The hashes of the telegrams received by any bus device within the last
+// window seconds are remembered here, oldest first in order_ for expiry.
+struct DuplicateTelegrams
 {
-    SHA256_HASH hash;
-    Sha256Calculate(&frame[0], frame.size(), &hash);
+    bool seenBefore(const vector<uchar> &frame, time_t now)
+    {
+        WITH(mutex_, duplicate_telegrams_mutex, seenBefore);
 
-    auto i = std::find(seen_telegrams.begin(), seen_telegrams.end(), hash);
+        expire(now);
+        uint64_t hash = hash64(frame.size() > 0 ? &frame[0] : NULL, frame.size());
+        if (seen_.count(hash) > 0) return true;
 
-    if (i != seen_telegrams.end())
+        seen_[hash] = now;
+        order_.push_back({ now, hash });
+        return false;
+    }
+
+    void setWindow(int seconds)
     {
-        // Found it!
-        return true;
+        WITH(mutex_, duplicate_telegrams_mutex, setWindow);
+
+        window_ = seconds;
     }
 
-    if (seen_telegrams.size() >= 10)
+    DuplicateTelegrams() { seen_.reserve(4096); }
+
+private:
+
+    void expire(time_t now)
     {
-        seen_telegrams.pop_front();
+        while (order_.size() > 0 && order_.front().first + window_ < now)
+        {
+            // Only forget the hash if it has not been remembered again since.
+            auto i = seen_.find(order_.front().second);
+            if (i != seen_.end() && i->second == order_.front().first) seen_.erase(i);
+            order_.pop_front();
+        }
     }
-    seen_telegrams.push_back(hash);
 
-    return false;
+    int window_ { 10 };
+    unordered_map<uint64_t,time_t> seen_;
+    deque<pair<time_t,uint64_t>> order_;
+    RecursiveMutex mutex_ { "duplicate_telegrams_mutex" };
+};
+
+static DuplicateTelegrams duplicate_telegrams_;
+
+bool seen_this_telegram_before(const vector<uchar> &frame, time_t now)
+{
+    return duplicate_telegrams_.seenBefore(frame, now);
+}
+
+void setDuplicateTelegramsWindow(int seconds)
+{
+    duplicate_telegrams_.setWindow(seconds);
 }
 
 // Store the dll_a (6 bytes composed of 4 id + 1 ver + 1 media )
 // for telegrams that has been warned about!
 deque<vector<uchar>> warning_printed_for_telegrams;
+RecursiveMutex warning_printed_mutex_("warning_printed_mutex");
 
-bool warned_for_telegram_before(Telegram *t, vector<uchar> &dll_a)
+bool warned_for_telegram_before(bool *triggered_warning, const vector<uchar> &dll_a)
 {
+    // Telegrams can be parsed in several decode threads.
+    WITH(warning_printed_mutex_, warning_printed_mutex, warned_for_telegram_before);
+
     auto i = std::find(warning_printed_for_telegrams.begin(), warning_printed_for_telegrams.end(), dll_a);
 
     if (i != warning_printed_for_telegrams.end())
     {
         // Found it!
-        if (t->triggered_warning)
+        if (*triggered_warning)
         {
             // This is another warning for the same telegram, that triggered the first warning.
             // We want to print all warnings for the first telegram, return false to print it.
@@ -400,27 +474,33 @@ bool warned_for_telegram_before(Telegram *t, vector<uchar> &dll_a)
     }
     warning_printed_for_telegrams.push_back(dll_a);
     // Print all warnings for this telegram.
-    t->triggered_warning = true;
+    *triggered_warning = true;
     return false;
 }
 
-string manufacturer(int m_field) {
-    for (auto &m : manufacturers_) {
-	if (m.m_field == m_field) return m.name;
+const char *manufacturer(int m_field) {
+    size_t from = 0;
+    size_t to = num_manufacturers_;
+    while (from < to)
+    {
+        size_t mid = (from+to)/2;
+        if (manufacturers_[mid].m_field < m_field) from = mid+1;
+        else to = mid;
+    }
+    if (from < num_manufacturers_ && manufacturers_[from].m_field == m_field)
+    {
+        return manufacturers_[from].name;
     }
     return "Unknown";
 }
 
-string manufacturerFlag(int m_field) {
-    char a = (m_field/1024)%32+64;
-    char b = (m_field/32)%32+64;
-    char c = (m_field)%32+64;
-
-    string flag;
-    flag += a;
-    flag += b;
-    flag += c;
-    return flag;
+ManufacturerFlag manufacturerFlag(int m_field) {
+    ManufacturerFlag mf;
+    mf.flag[0] = (m_field/1024)%32+64;
+    mf.flag[1] = (m_field/32)%32+64;
+    mf.flag[2] = (m_field)%32+64;
+    mf.flag[3] = 0;
+    return mf;
 }
 
 string mediaType(int a_field_device_type, int m_field) {
@@ -740,6 +820,13 @@ string ciType(int ci_field)
 
 void Telegram::addExplanationAndIncrementPos(vector<uchar>::iterator &pos, int len, const char* fmt, ...)
 {
+    if (!explain_)
+    {
+        parsed.insert(parsed.end(), pos, pos+len);
+        pos += len;
+        return;
+    }
+
     char buf[1024];
     buf[1023] = 0;
 
@@ -755,6 +842,8 @@ void Telegram::addExplanationAndIncrementPos(vector<uchar>::iterator &pos, int l
 
 void Telegram::addMoreExplanation(int pos, const char* fmt, ...)
 {
+    if (!explain_) return;
+
     char buf[1024];
 
     buf[1023] = 0;
@@ -797,7 +886,7 @@ bool Telegram::parseMBusDLL(vector<uchar>::iterator &pos)
     addExplanationAndIncrementPos(pos, 1, "%02x length (%d bytes)", dll_len, dll_len);
 
     dll_c = *pos;
-    addExplanationAndIncrementPos(pos, 1, "%02x dll-c (%s)", dll_c, mbusCField(dll_c).c_str());
+    addExplanationAndIncrementPos(pos, 1, "%02x dll-c (%s)", dll_c, explain_ ? mbusCField(dll_c).c_str() : "");
 
     mbus_primary_address = *pos;
     addExplanationAndIncrementPos(pos, 1, "%02x dll-a primary (%d)", mbus_primary_address, mbus_primary_address);
@@ -821,12 +910,12 @@ bool Telegram::parseDLL(vector<uchar>::iterator &pos)
     addExplanationAndIncrementPos(pos, 1, "%02x length (%d bytes)", dll_len, dll_len);
 
     dll_c = *pos;
-    addExplanationAndIncrementPos(pos, 1, "%02x dll-c (%s)", dll_c, cType(dll_c).c_str());
+    addExplanationAndIncrementPos(pos, 1, "%02x dll-c (%s)", dll_c, explain_ ? cType(dll_c).c_str() : "");
 
     dll_mfct_b[0] = *(pos+0);
     dll_mfct_b[1] = *(pos+1);
     dll_mfct = dll_mfct_b[1] <<8 | dll_mfct_b[0];
-    string man = manufacturerFlag(dll_mfct);
+    string man = explain_ ? manufacturerFlag(dll_mfct).c_str() : "";
     addExplanationAndIncrementPos(pos, 2, "%02x%02x dll-mfct (%s)",
                                   dll_mfct_b[0], dll_mfct_b[1], man.c_str());
 
@@ -852,7 +941,7 @@ bool Telegram::parseDLL(vector<uchar>::iterator &pos)
     dll_type = *(pos+1);
     addExplanationAndIncrementPos(pos, 1, "%02x dll-version", dll_version);
     addExplanationAndIncrementPos(pos, 1, "%02x dll-type (%s)", dll_type,
-                                  mediaType(dll_type, dll_mfct).c_str());
+                                  explain_ ? mediaType(dll_type, dll_mfct).c_str() : "");
 
     return true;
 }
@@ -881,7 +970,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
     int ci_field = *pos;
     if (!isCiFieldOfType(ci_field, CI_TYPE::ELL)) return true;
     addExplanationAndIncrementPos(pos, 1, "%02x ell-ci-field (%s)",
-                                  ci_field, ciType(ci_field).c_str());
+                                  ci_field, explain_ ? ciType(ci_field).c_str() : "");
     ell_ci = ci_field;
     int len = ciFieldLength(ell_ci);
 
@@ -890,7 +979,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
     // All ELL:s (including ELL I) start with cc,acc.
 
     ell_cc = *pos;
-    addExplanationAndIncrementPos(pos, 1, "%02x ell-cc (%s)", ell_cc, ccType(ell_cc).c_str());
+    addExplanationAndIncrementPos(pos, 1, "%02x ell-cc (%s)", ell_cc, explain_ ? ccType(ell_cc).c_str() : "");
 
     ell_acc = *pos;
     addExplanationAndIncrementPos(pos, 1, "%02x ell-acc", ell_acc);
@@ -923,7 +1012,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
         ell_mfct_b[0] = *(pos+0);
         ell_mfct_b[1] = *(pos+1);
         ell_mfct = ell_mfct_b[1] << 8 | ell_mfct_b[0];
-        string man = manufacturerFlag(ell_mfct);
+        string man = explain_ ? manufacturerFlag(ell_mfct).c_str() : "";
         addExplanationAndIncrementPos(pos, 2, "%02x%02x ell-mfct (%s)",
                                       ell_mfct_b[0], ell_mfct_b[1], man.c_str());
 
@@ -960,7 +1049,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
         ell_sn_time = (ell_sn >> 4)  & 0x1ffffff; // next 25 bits
         ell_sn_sec = (ell_sn >> 29) & 0x7; // next 3 bits.
         ell_sec_mode = fromIntToELLSecurityMode(ell_sn_sec);
-        string info = toString(ell_sec_mode);
+        string info = explain_ ? toString(ell_sec_mode) : "";
         addExplanationAndIncrementPos(pos, 4, "%02x%02x%02x%02x sn (%s)",
                                       ell_sn_b[0], ell_sn_b[1], ell_sn_b[2], ell_sn_b[3], info.c_str());
 
@@ -968,7 +1057,8 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
         {
             if (meter_keys)
             {
-                decrypt_ELL_AES_CTR(this, frame, pos, meter_keys->confidentiality_key);
+                const AESCMACKey *key = meter_keys->confidentialityKey();
+                decrypt_ELL_AES_CTR(this, frame, pos, key ? &key->rk : NULL);
                 // Actually this ctr decryption always succeeds, if wrong key, it will decrypt to garbage.
             }
             // Now the frame from pos and onwards has been decrypted, perhaps.
@@ -993,7 +1083,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
             decryption_failed = true;
             if (parser_warns_)
             {
-                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(this, dll_a))
+                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(&triggered_warning, dll_a))
                 {
                     // Print this warning only once! Unless you are using verbose or debug.
                     warning("(wmbus) decrypted payload crc failed check, did you use the correct decryption key? "
@@ -1003,7 +1093,7 @@ bool Telegram::parseELL(vector<uchar>::iterator &pos)
                             check  & 0xff, check >> 8,
                             dll_id_b[3], dll_id_b[2], dll_id_b[1], dll_id_b[0],
                             manufacturerFlag(dll_mfct).c_str(),
-                            manufacturer(dll_mfct).c_str(),
+                            manufacturer(dll_mfct),
                             dll_mfct,
                             mediaType(dll_type, dll_mfct).c_str(), dll_type,
                             dll_version);
@@ -1033,7 +1123,7 @@ bool Telegram::parseAFL(vector<uchar>::iterator &pos)
     int ci_field = *pos;
     if (!isCiFieldOfType(ci_field, CI_TYPE::AFL)) return true;
     addExplanationAndIncrementPos(pos, 1, "%02x afl-ci-field (%s)",
-                                  ci_field, ciType(ci_field).c_str());
+                                  ci_field, explain_ ? ciType(ci_field).c_str() : "");
     afl_ci = ci_field;
 
     afl_len = *pos;
@@ -1046,7 +1136,7 @@ bool Telegram::parseAFL(vector<uchar>::iterator &pos)
     afl_fc_b[0] = *(pos+0);
     afl_fc_b[1] = *(pos+1);
     afl_fc = afl_fc_b[1] << 8 | afl_fc_b[0];
-    string afl_fc_info = toStringFromAFLFC(afl_fc);
+    string afl_fc_info = explain_ ? toStringFromAFLFC(afl_fc) : "";
     addExplanationAndIncrementPos(pos, 2, "%02x%02x afl-fc (%s)",
                                   afl_fc_b[0], afl_fc_b[1], afl_fc_info.c_str());
 
@@ -1060,7 +1150,7 @@ bool Telegram::parseAFL(vector<uchar>::iterator &pos)
     if (has_control)
     {
         afl_mcl = *pos;
-        string afl_mcl_info = toStringFromAFLMC(afl_mcl);
+        string afl_mcl_info = explain_ ? toStringFromAFLMC(afl_mcl) : "";
         addExplanationAndIncrementPos(pos, 1, "%02x afl-mcl (%s)",
                                       afl_mcl, afl_mcl_info.c_str());
     }
@@ -1111,7 +1201,7 @@ bool Telegram::parseAFL(vector<uchar>::iterator &pos)
         {
             afl_mac_b.insert(afl_mac_b.end(), *(pos+i));
         }
-        string s = bin2hex(afl_mac_b);
+        string s = explain_ ? bin2hex(afl_mac_b) : "";
         addExplanationAndIncrementPos(pos, len, "%s afl-mac %d bytes", s.c_str(), len);
         must_check_mac = true;
     }
@@ -1192,8 +1282,7 @@ bool Telegram::parseTPLConfig(std::vector<uchar>::iterator &pos)
         tpl_sec_mode = fromIntToTPLSecurityMode(m);
     }
     bool has_cfg_ext = false;
-    string info = toStringFromTPLConfig(tpl_cfg);
-    info += " ";
+    string info = explain_ ? toStringFromTPLConfig(tpl_cfg)+" " : "";
     if (tpl_sec_mode == TPLSecurityMode::AES_CBC_IV) // Security mode 5
     {
         tpl_num_encr_blocks = (tpl_cfg >> 4) & 0x0f;
@@ -1216,8 +1305,6 @@ bool Telegram::parseTPLConfig(std::vector<uchar>::iterator &pos)
         if (tpl_kdf_selection == 1)
         {
             vector<uchar> input;
-            vector<uchar> mac;
-            mac.resize(16);
 
             // DC C ID 0x07 0x07 0x07 0x07 0x07 0x07 0x07
             // Derivation Constant DC = 0x00 = encryption from meter.
@@ -1252,21 +1339,16 @@ bool Telegram::parseTPLConfig(std::vector<uchar>::iterator &pos)
                 debug("(wmbus) no key, thus cannot execute kdf.\n");
                 return false;
             }
-            AES_CMAC(&meter_keys->confidentiality_key[0], &input[0], 16, &mac[0]);
-            string s = bin2hex(mac);
-            debug("(wmbus) ephemereal Kenc %s\n", s.c_str());
-            tpl_generated_key.clear();
-            tpl_generated_key.insert(tpl_generated_key.end(), mac.begin(), mac.end());
-
-            input[0] = 0x01; // DC 01 = generate ephemereal mac key from meter.
-            mac.clear();
-            mac.resize(16);
-            debugPayload("(wmbus) input to kdf for mac", input);
-            AES_CMAC(&meter_keys->confidentiality_key[0], &input[0], 16, &mac[0]);
-            s = bin2hex(mac);
-            debug("(wmbus) ephemereal Kmac %s\n", s.c_str());
-            tpl_generated_mac_key.clear();
-            tpl_generated_mac_key.insert(tpl_generated_mac_key.end(), mac.begin(), mac.end());
+            tpl_generated_keys = meter_keys->deriveKeys(&input[0]);
+            if (isDebugEnabled())
+            {
+                vector<uchar> key(tpl_generated_keys->kenc, tpl_generated_keys->kenc+16);
+                debug("(wmbus) ephemereal Kenc %s\n", bin2hex(key).c_str());
+                input[0] = 0x01; // DC 01 = generate ephemereal mac key from meter.
+                debugPayload("(wmbus) input to kdf for mac", input);
+                key.assign(tpl_generated_keys->kmac, tpl_generated_keys->kmac+16);
+                debug("(wmbus) ephemereal Kmac %s\n", bin2hex(key).c_str());
+            }
         }
     }
 
@@ -1282,7 +1364,7 @@ bool Telegram::parseShortTPL(std::vector<uchar>::iterator &pos)
 
     CHECK(1);
     tpl_sts = *pos;
-    addExplanationAndIncrementPos(pos, 1, "%02x tpl-sts-field (%s)", tpl_sts, decodeTPLStatusByte(tpl_sts, NULL).c_str());
+    addExplanationAndIncrementPos(pos, 1, "%02x tpl-sts-field (%s)", tpl_sts, explain_ ? decodeTPLStatusByte(tpl_sts, NULL).c_str() : "");
 
     bool ok = parseTPLConfig(pos);
     if (!ok) return false;
@@ -1316,7 +1398,7 @@ bool Telegram::parseLongTPL(std::vector<uchar>::iterator &pos)
     tpl_mfct_b[0] = *(pos+0);
     tpl_mfct_b[1] = *(pos+1);
     tpl_mfct = tpl_mfct_b[1] << 8 | tpl_mfct_b[0];
-    string man = manufacturerFlag(tpl_mfct);
+    string man = explain_ ? manufacturerFlag(tpl_mfct).c_str() : "";
     addExplanationAndIncrementPos(pos, 2, "%02x%02x tpl-mfct (%s)", tpl_mfct_b[0], tpl_mfct_b[1], man.c_str());
 
     CHECK(1);
@@ -1327,7 +1409,7 @@ bool Telegram::parseLongTPL(std::vector<uchar>::iterator &pos)
     CHECK(1);
     tpl_type = *(pos+0);
     tpl_a[5] = *(pos+0);
-    string info = mediaType(tpl_type, tpl_mfct);
+    string info = explain_ ? mediaType(tpl_type, tpl_mfct) : "";
     addExplanationAndIncrementPos(pos, 1, "%02x tpl-type (%s)", tpl_type, info.c_str());
 
     bool ok = parseShortTPL(pos);
@@ -1339,13 +1421,13 @@ bool Telegram::checkMAC(std::vector<uchar> &frame,
                         std::vector<uchar>::iterator from,
                         std::vector<uchar>::iterator to,
                         std::vector<uchar> &inmac,
-                        std::vector<uchar> &mackey)
+                        const AESCMACKey *mackey)
 {
     vector<uchar> input;
     vector<uchar> mac;
     mac.resize(16);
 
-    if (mackey.size() != 16) return false;
+    if (mackey == NULL) return false;
     if (inmac.size() == 0) return false;
 
     // AFL.MAC = CMAC (Kmac/Lmac,
@@ -1356,7 +1438,7 @@ bool Telegram::checkMAC(std::vector<uchar> &frame,
     input.insert(input.end(), from, to);
     string s = bin2hex(input);
     debug("(wmbus) input to mac %s\n", s.c_str());
-    AES_CMAC(&mackey[0], &input[0], input.size(), &mac[0]);
+    AES_CMAC(mackey, &input[0], input.size(), &mac[0]);
     string calculated = bin2hex(mac);
     debug("(wmbus) calculated mac %s\n", calculated.c_str());
     string received = bin2hex(inmac);
@@ -1390,7 +1472,8 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
         {
             addDefaultManufacturerKeyIfAny(frame, tpl_sec_mode, meter_keys);
         }
-        bool ok = decrypt_TPL_AES_CBC_IV(this, frame, pos, meter_keys->confidentiality_key);
+        const AESCMACKey *key = meter_keys->confidentialityKey();
+        bool ok = decrypt_TPL_AES_CBC_IV(this, frame, pos, key ? &key->rk : NULL);
         if (!ok) return false;
         // Now the frame from pos and onwards has been decrypted.
 
@@ -1399,14 +1482,14 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
         {
             if (parser_warns_)
             {
-                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(this, dll_a))
+                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(&triggered_warning, dll_a))
                 {
                     // Print this warning only once! Unless you are using verbose or debug.
                     warning("(wmbus) decrypted content failed check, did you use the correct decryption key? "
                             "Permanently ignoring telegrams from id: %02x%02x%02x%02x mfct: (%s) %s (0x%02x) type: %s (0x%02x) ver: 0x%02x\n",
                             dll_id_b[3], dll_id_b[2], dll_id_b[1], dll_id_b[0],
                             manufacturerFlag(dll_mfct).c_str(),
-                            manufacturer(dll_mfct).c_str(),
+                            manufacturer(dll_mfct),
                             dll_mfct,
                             mediaType(dll_type, dll_mfct).c_str(), dll_type,
                             dll_version);
@@ -1425,21 +1508,22 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
             addExplanationAndIncrementPos(pos, 2, "%02x%02x (already) decrypted check bytes", *(pos+0), *(pos+1));
             return true;
         }
-        bool mac_ok = checkMAC(frame, tpl_start, frame.end(), afl_mac_b, tpl_generated_mac_key);
+        bool mac_ok = checkMAC(frame, tpl_start, frame.end(), afl_mac_b,
+                               tpl_generated_keys ? &tpl_generated_keys->kmac_ck : NULL);
 
         // Do not attempt to decrypt if the mac has failed!
         if (!mac_ok)
         {
             if (parser_warns_)
             {
-                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(this, dll_a))
+                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(&triggered_warning, dll_a))
                 {
                     // Print this warning only once! Unless you are using verbose or debug.
                     warning("(wmbus) telegram mac check failed, did you use the correct decryption key? "
                             "Permanently ignoring telegrams from id: %02x%02x%02x%02x mfct: (%s) %s (0x%02x) type: %s (0x%02x) ver: 0x%02x\n",
                             dll_id_b[3], dll_id_b[2], dll_id_b[1], dll_id_b[0],
                             manufacturerFlag(dll_mfct).c_str(),
-                            manufacturer(dll_mfct).c_str(),
+                            manufacturer(dll_mfct),
                             dll_mfct,
                             mediaType(dll_type, dll_mfct).c_str(), dll_type,
                             dll_version);
@@ -1448,7 +1532,7 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
             return false;
         }
 
-        bool ok = decrypt_TPL_AES_CBC_NO_IV(this, frame, pos, tpl_generated_key);
+        bool ok = decrypt_TPL_AES_CBC_NO_IV(this, frame, pos, tpl_generated_keys ? &tpl_generated_keys->kenc_rk : NULL);
         if (!ok) return false;
 
         // Now the frame from pos and onwards has been decrypted.
@@ -1457,14 +1541,14 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
         {
             if (parser_warns_)
             {
-                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(this, dll_a))
+                if (isVerboseEnabled() || isDebugEnabled() || !warned_for_telegram_before(&triggered_warning, dll_a))
                 {
                     // Print this warning only once! Unless you are using verbose or debug.
                     warning("(wmbus) decrypted content failed check, did you use the correct decryption key? "
                             "Permanently ignoring telegrams from id: %02x%02x%02x%02x mfct: (%s) %s (0x%02x) type: %s (0x%02x) ver: 0x%02x\n",
                             dll_id_b[3], dll_id_b[2], dll_id_b[1], dll_id_b[0],
                             manufacturerFlag(dll_mfct).c_str(),
-                            manufacturer(dll_mfct).c_str(),
+                            manufacturer(dll_mfct),
                             dll_mfct,
                             mediaType(dll_type, dll_mfct).c_str(), dll_type,
                             dll_version);
@@ -1479,7 +1563,7 @@ bool Telegram::potentiallyDecrypt(vector<uchar>::iterator &pos)
         if (mustDecryptDiehlRealData(frame))
         {
             if (!meter_keys) return false;
-            bool ok = decryptDielhRealData(this, frame, pos, meter_keys->confidentiality_key);
+            bool ok = decryptDielhRealData(this, frame, pos, meter_keys);
             if (!ok) return false;
             // Now the frame from pos and onwards has been decrypted.
         }
@@ -1601,7 +1685,7 @@ bool Telegram::parseTPL(vector<uchar>::iterator &pos)
     tpl_start = pos;
 
     addExplanationAndIncrementPos(pos, 1, "%02x tpl-ci-field (%s)",
-                                  tpl_ci, ciType(tpl_ci).c_str());
+                                  tpl_ci, explain_ ? ciType(tpl_ci).c_str() : "");
     int len = ciFieldLength(tpl_ci);
 
     if (remaining < len+1) return expectedMore(__LINE__);
@@ -1644,7 +1728,7 @@ void Telegram::preProcess()
     }
 }
 
-bool Telegram::parse(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
+bool Telegram::parse(const vector<uchar> &input_frame, MeterKeys *mk, bool warn)
 {
     switch (about.type)
     {
@@ -1656,7 +1740,7 @@ bool Telegram::parse(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
     return false;
 }
 
-bool Telegram::parseHeader(vector<uchar> &input_frame)
+bool Telegram::parseHeader(const vector<uchar> &input_frame)
 {
     switch (about.type)
     {
@@ -1668,7 +1752,7 @@ bool Telegram::parseHeader(vector<uchar> &input_frame)
     return false;
 }
 
-bool Telegram::parseWMBUSHeader(vector<uchar> &input_frame)
+bool Telegram::parseWMBUSHeader(const vector<uchar> &input_frame)
 {
     assert(about.type == FrameType::WMBUS);
 
@@ -1707,7 +1791,7 @@ bool Telegram::parseWMBUSHeader(vector<uchar> &input_frame)
     return true;
 }
 
-bool Telegram::parseWMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
+bool Telegram::parseWMBUS(const vector<uchar> &input_frame, MeterKeys *mk, bool warn)
 {
     assert(about.type == FrameType::WMBUS);
 
@@ -1783,7 +1867,7 @@ bool Telegram::parseWMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
     return true;
 }
 
-bool Telegram::parseMBUSHeader(vector<uchar> &input_frame)
+bool Telegram::parseMBUSHeader(const vector<uchar> &input_frame)
 {
     assert(about.type == FrameType::MBUS);
 
@@ -1805,7 +1889,7 @@ bool Telegram::parseMBUSHeader(vector<uchar> &input_frame)
     return true;
 }
 
-bool Telegram::parseMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
+bool Telegram::parseMBUS(const vector<uchar> &input_frame, MeterKeys *mk, bool warn)
 {
     assert(about.type == FrameType::MBUS);
 
@@ -1835,14 +1919,14 @@ bool Telegram::parseMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
     return true;
 }
 
-bool Telegram::parseHANHeader(vector<uchar> &input_frame)
+bool Telegram::parseHANHeader(const vector<uchar> &input_frame)
 {
     assert(about.type == FrameType::HAN);
 
     return false;
 }
 
-bool Telegram::parseHAN(vector<uchar> &input_frame, MeterKeys *mk, bool warn)
+bool Telegram::parseHAN(const vector<uchar> &input_frame, MeterKeys *mk, bool warn)
 {
     assert(about.type == FrameType::HAN);
 
@@ -1858,7 +1942,7 @@ void Telegram::explainParse(string intro, int from)
 
 void detectMeterDrivers(int manufacturer, int media, int version, std::vector<std::string> *drivers);
 
-string Telegram::autoDetectPossibleDrivers()
+string Telegram::autoDetectPossibleDrivers() const
 {
     vector<string> drivers;
     detectMeterDrivers(dll_mfct, dll_type, dll_version, &drivers);
@@ -2016,7 +2100,602 @@ MeasurementType difMeasurementType(int dif)
     assert(0);
 }
 
-string vifType(int vif)
+struct VifInfo
+{
+    int vif;
+    // Divide the raw value with the scale to get the wmbusmeters default unit, -1 if not scalable.
+    double scale;
+    const char *key; // E.g. temperature energy power mass_flow volume_flow, NULL if unknown.
+    const char *unit; // E.g. m3 c kwh kw MJ MJh, NULL if unknown.
+    const char *description;
+};
+
+// Indexed by the vif without the extension bit.
+constexpr VifInfo vif_table_[] =
+{
+    // wmbusmeters always returns enery as kwh
+    { 0x00, 1000000.0, "energy", "kwh", "Energy mWh" },
+    { 0x01, 100000.0, "energy", "kwh", "Energy 10⁻² Wh" },
+    { 0x02, 10000.0, "energy", "kwh", "Energy 10⁻¹ Wh" },
+    { 0x03, 1000.0, "energy", "kwh", "Energy Wh" },
+    { 0x04, 100.0, "energy", "kwh", "Energy 10¹ Wh" },
+    { 0x05, 10.0, "energy", "kwh", "Energy 10² Wh" },
+    { 0x06, 1.0, "energy", "kwh", "Energy kWh" },
+    { 0x07, 0.1, "energy", "kwh", "Energy 10⁴ Wh" },
+
+    // or wmbusmeters always returns energy as MJ
+    { 0x08, 1000000.0, "energy", "MJ", "Energy J" },
+    { 0x09, 100000.0, "energy", "MJ", "Energy 10¹ J" },
+    { 0x0A, 10000.0, "energy", "MJ", "Energy 10² J" },
+    { 0x0B, 1000.0, "energy", "MJ", "Energy kJ" },
+    { 0x0C, 100.0, "energy", "MJ", "Energy 10⁴ J" },
+    { 0x0D, 10.0, "energy", "MJ", "Energy 10⁵ J" },
+    { 0x0E, 1.0, "energy", "MJ", "Energy MJ" },
+    { 0x0F, 0.1, "energy", "MJ", "Energy 10⁷ J" },
+
+    // wmbusmeters always returns volume as m3
+    { 0x10, 1000000.0, "volume", "m3", "Volume cm³" },
+    { 0x11, 100000.0, "volume", "m3", "Volume 10⁻⁵ m³" },
+    { 0x12, 10000.0, "volume", "m3", "Volume 10⁻⁴ m³" },
+    { 0x13, 1000.0, "volume", "m3", "Volume l" },
+    { 0x14, 100.0, "volume", "m3", "Volume 10⁻² m³" },
+    { 0x15, 10.0, "volume", "m3", "Volume 10⁻¹ m³" },
+    { 0x16, 1.0, "volume", "m3", "Volume m³" },
+    { 0x17, 0.1, "volume", "m3", "Volume 10¹ m³" },
+
+    // wmbusmeters always returns weight in kg
+    { 0x18, 1000.0, "mass", "kg", "Mass g" },
+    { 0x19, 100.0, "mass", "kg", "Mass 10⁻² kg" },
+    { 0x1A, 10.0, "mass", "kg", "Mass 10⁻¹ kg" },
+    { 0x1B, 1.0, "mass", "kg", "Mass kg" },
+    { 0x1C, 0.1, "mass", "kg", "Mass 10¹ kg" },
+    { 0x1D, 0.01, "mass", "kg", "Mass 10² kg" },
+    { 0x1E, 0.001, "mass", "kg", "Mass t" },
+    { 0x1F, 0.0001, "mass", "kg", "Mass 10⁴ kg" },
+
+    // wmbusmeters always returns time in hours
+    { 0x20, 3600.0, "on_time", "h", "On time seconds" },
+    { 0x21, 60.0, "on_time", "h", "On time minutes" },
+    { 0x22, 1.0, "on_time", "h", "On time hours" },
+    { 0x23, (1.0/24.0), "on_time", "h", "On time days" },
+    { 0x24, 3600.0, "operating_time", "h", "Operating time seconds" },
+    { 0x25, 60.0, "operating_time", "h", "Operating time minutes" },
+    { 0x26, 1.0, "operating_time", "h", "Operating time hours" },
+    { 0x27, (1.0/24.0), "operating_time", "h", "Operating time days" },
+
+    // wmbusmeters always returns power in kw
+    { 0x28, 1000000.0, "power", "kw", "Power mW" },
+    { 0x29, 100000.0, "power", "kw", "Power 10⁻² W" },
+    { 0x2A, 10000.0, "power", "kw", "Power 10⁻¹ W" },
+    { 0x2B, 1000.0, "power", "kw", "Power W" },
+    { 0x2C, 100.0, "power", "kw", "Power 10¹ W" },
+    { 0x2D, 10.0, "power", "kw", "Power 10² W" },
+    { 0x2E, 1.0, "power", "kw", "Power kW" },
+    { 0x2F, 0.1, "power", "kw", "Power 10⁴ W" },
+
+    // or wmbusmeters always returns power in MJh
+    { 0x30, 1000000.0, "power", "MJ", "Power J/h" },
+    { 0x31, 100000.0, "power", "MJ", "Power 10¹ J/h" },
+    { 0x32, 10000.0, "power", "MJ", "Power 10² J/h" },
+    { 0x33, 1000.0, "power", "MJ", "Power kJ/h" },
+    { 0x34, 100.0, "power", "MJ", "Power 10⁴ J/h" },
+    { 0x35, 10.0, "power", "MJ", "Power 10⁵ J/h" },
+    { 0x36, 1.0, "power", "MJ", "Power MJ/h" },
+    { 0x37, 0.1, "power", "MJ", "Power 10⁷ J/h" },
+
+    // wmbusmeters always returns volume flow in m3h
+    { 0x38, 1000000.0, "volume_flow", "m3/h", "Volume flow cm³/h" },
+    { 0x39, 100000.0, "volume_flow", "m3/h", "Volume flow 10⁻⁵ m³/h" },
+    { 0x3A, 10000.0, "volume_flow", "m3/h", "Volume flow 10⁻⁴ m³/h" },
+    { 0x3B, 1000.0, "volume_flow", "m3/h", "Volume flow l/h" },
+    { 0x3C, 100.0, "volume_flow", "m3/h", "Volume flow 10⁻² m³/h" },
+    { 0x3D, 10.0, "volume_flow", "m3/h", "Volume flow 10⁻¹ m³/h" },
+    { 0x3E, 1.0, "volume_flow", "m3/h", "Volume flow m³/h" },
+    { 0x3F, 0.1, "volume_flow", "m3/h", "Volume flow 10¹ m³/h" },
+
+    // wmbusmeters always returns volume flow in m3h
+    { 0x40, 600000000.0, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁷ m³/min" },
+    { 0x41, 60000000.0, "volume_flow_ext", "m3/h", "Volume flow ext. cm³/min" },
+    { 0x42, 6000000.0, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁵ m³/min" },
+    { 0x43, 600000.0, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁴ m³/min" },
+    { 0x44, 60000.0, "volume_flow_ext", "m3/h", "Volume flow ext. l/min" },
+    { 0x45, 6000.0, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻² m³/min" },
+    { 0x46, 600.0, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻¹ m³/min" },
+    { 0x47, 60.0, "volume_flow_ext", "m3/h", "Volume flow ext. m³/min" },
+
+    // this flow numbers will be small in the m3h unit, but it
+    // does not matter since double stores the scale factor in its exponent.
+    { 0x48, 1000000000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. mm³/s" },
+    { 0x49, 100000000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁸ m³/s" },
+    { 0x4A, 10000000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁷ m³/s" },
+    { 0x4B, 1000000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. cm³/s" },
+    { 0x4C, 100000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁵ m³/s" },
+    { 0x4D, 10000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻⁴ m³/s" },
+    { 0x4E, 1000.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. l/s" },
+    { 0x4F, 100.0*3600, "volume_flow_ext", "m3/h", "Volume flow ext. 10⁻² m³/s" },
+
+    // wmbusmeters always returns mass flow as kgh
+    { 0x50, 1000.0, "mass_flow", "kg/h", "Mass g/h" },
+    { 0x51, 100.0, "mass_flow", "kg/h", "Mass 10⁻² kg/h" },
+    { 0x52, 10.0, "mass_flow", "kg/h", "Mass 10⁻¹ kg/h" },
+    { 0x53, 1.0, "mass_flow", "kg/h", "Mass kg/h" },
+    { 0x54, 0.1, "mass_flow", "kg/h", "Mass 10¹ kg/h" },
+    { 0x55, 0.01, "mass_flow", "kg/h", "Mass 10² kg/h" },
+    { 0x56, 0.001, "mass_flow", "kg/h", "Mass t/h" },
+    { 0x57, 0.0001, "mass_flow", "kg/h", "Mass 10⁴ kg/h" },
+
+    // wmbusmeters always returns temperature in °C
+    { 0x58, 1000.0, "flow_temperature", "c", "Flow temperature 10⁻³ °C" },
+    { 0x59, 100.0, "flow_temperature", "c", "Flow temperature 10⁻² °C" },
+    { 0x5A, 10.0, "flow_temperature", "c", "Flow temperature 10⁻¹ °C" },
+    { 0x5B, 1.0, "flow_temperature", "c", "Flow temperature °C" },
+
+    // wmbusmeters always returns temperature in c
+    { 0x5C, 1000.0, "return_temperature", "c", "Return temperature 10⁻³ °C" },
+    { 0x5D, 100.0, "return_temperature", "c", "Return temperature 10⁻² °C" },
+    { 0x5E, 10.0, "return_temperature", "c", "Return temperature 10⁻¹ °C" },
+    { 0x5F, 1.0, "return_temperature", "c", "Return temperature °C" },
+
+    // or if Kelvin is used as a temperature, in K
+    // what kind of meter cares about -273.15 °C
+    // a flow pump for liquid helium perhaps?
+    { 0x60, 1000.0, "temperature_difference", "k", "Temperature difference mK" },
+    { 0x61, 100.0, "temperature_difference", "k", "Temperature difference 10⁻² K" },
+    { 0x62, 10.0, "temperature_difference", "k", "Temperature difference 10⁻¹ K" },
+    { 0x63, 1.0, "temperature_difference", "k", "Temperature difference K" },
+
+    // wmbusmeters always returns temperature in c
+    { 0x64, 1000.0, "external_temperature", "c", "External temperature 10⁻³ °C" },
+    { 0x65, 100.0, "external_temperature", "c", "External temperature 10⁻² °C" },
+    { 0x66, 10.0, "external_temperature", "c", "External temperature 10⁻¹ °C" },
+    { 0x67, 1.0, "external_temperature", "c", "External temperature °C" },
+
+    // wmbusmeters always returns pressure in bar
+    { 0x68, 1000.0, "pressure", "bar", "Pressure mbar" },
+    { 0x69, 100.0, "pressure", "bar", "Pressure 10⁻² bar" },
+    { 0x6A, 10.0, "pressure", "bar", "Pressure 10⁻1 bar" },
+    { 0x6B, 1.0, "pressure", "bar", "Pressure bar" },
+
+    { 0x6C, -1.0, "date", "", "Date type G" },
+    { 0x6D, -1.0, NULL, "", "Date and time type" },
+    { 0x6E, 1.0, "hca", "", "Units for H.C.A." },
+    { 0x6F, -1.0, "reserved", "", "Reserved" },
+
+    // wmbusmeters always returns time in hours
+    { 0x70, 3600.0, "average_duration", "h", "Averaging duration seconds" },
+    { 0x71, 60.0, "average_duration", "h", "Averaging duration minutes" },
+    { 0x72, 1.0, "average_duration", "h", "Averaging duration hours" },
+    { 0x73, (1.0/24.0), "average_duration", "h", "Averaging duration days" },
+    { 0x74, 3600.0, "actual_duration", "h", "Actuality duration seconds" },
+    { 0x75, 60.0, "actual_duration", "h", "Actuality duration minutes" },
+    { 0x76, 1.0, "actual_duration", "h", "Actuality duration hours" },
+    { 0x77, (1.0/24.0), "actual_duration", "h", "Actuality duration days" },
+
+    { 0x78, -1.0, "fabrication_no", "", "Fabrication no" },
+    { 0x79, -1.0, "enhanced_identification", "", "Enhanced identification" },
+    { 0x7A, -1.0, NULL, NULL, "?" },
+    { 0x7B, -1.0, NULL, NULL, "?" },
+    { 0x7C, -1.0, NULL, NULL, "VIF in following string (length in first byte)" },
+    { 0x7D, -1.0, NULL, NULL, "?" },
+    { 0x7E, -1.0, NULL, NULL, "Any VIF" },
+    { 0x7F, -1.0, NULL, NULL, "Manufacturer specific" },
+};
+
+static_assert(sizeof(vif_table_)/sizeof(vif_table_[0]) == 128, "the vif table must cover all vifs");
+
+constexpr bool isVifTableIndexed(int i)
+{
+    return i == 128 || (vif_table_[i].vif == i && isVifTableIndexed(i+1));
+}
+
+static_assert(isVifTableIndexed(0), "the vif table must be indexed by the vif");
+
+// The vife descriptions are indexed by the vife without the extension bit.
+
+// Vifes after the first extension vif 0xfb.
+constexpr const char *vife_7B_table_[] =
+{
+    "10^-1 MWh", // 00
+    "10^0 MWh", // 01
+    "Reserved", // 02
+    "Reserved", // 03
+    "Reserved", // 04
+    "Reserved", // 05
+    "Reserved", // 06
+    "Reserved", // 07
+    "10^-1 GJ", // 08
+    "10^0 GJ", // 09
+    "Reserved", // 0A
+    "Reserved", // 0B
+    "Reserved", // 0C
+    "Reserved", // 0D
+    "Reserved", // 0E
+    "Reserved", // 0F
+    "10^2 m3", // 10
+    "10^3 m3", // 11
+    "Reserved", // 12
+    "Reserved", // 13
+    "Reserved", // 14
+    "Reserved", // 15
+    "Reserved", // 16
+    "Reserved", // 17
+    "10^2 ton", // 18
+    "10^3 ton", // 19
+    "?", // 1A
+    "?", // 1B
+    "?", // 1C
+    "?", // 1D
+    "?", // 1E
+    "?", // 1F
+    "Volume feet", // 20
+    "0.1 feet^3", // 21
+    "0.1 american gallon", // 22
+    "american gallon", // 23
+    "0.001 american gallon/min", // 24
+    "american gallon/min", // 25
+    "american gallon/h", // 26
+    "Reserved", // 27
+    "10^-1 MW", // 28
+    "10^0 MW", // 29
+    "?", // 2A
+    "?", // 2B
+    "Reserved", // 2C
+    "Reserved", // 2D
+    "Reserved", // 2E
+    "Reserved", // 2F
+    "10^-1 GJ/h", // 30
+    "10^0 GJ/h", // 31
+    "Reserved", // 32
+    "Reserved", // 33
+    "Reserved", // 34
+    "Reserved", // 35
+    "Reserved", // 36
+    "Reserved", // 37
+    "Reserved", // 38
+    "Reserved", // 39
+    "Reserved", // 3A
+    "Reserved", // 3B
+    "Reserved", // 3C
+    "Reserved", // 3D
+    "Reserved", // 3E
+    "Reserved", // 3F
+    "Reserved", // 40
+    "Reserved", // 41
+    "Reserved", // 42
+    "Reserved", // 43
+    "Reserved", // 44
+    "Reserved", // 45
+    "Reserved", // 46
+    "Reserved", // 47
+    "Reserved", // 48
+    "Reserved", // 49
+    "Reserved", // 4A
+    "Reserved", // 4B
+    "Reserved", // 4C
+    "Reserved", // 4D
+    "Reserved", // 4E
+    "Reserved", // 4F
+    "Reserved", // 50
+    "Reserved", // 51
+    "Reserved", // 52
+    "Reserved", // 53
+    "Reserved", // 54
+    "Reserved", // 55
+    "Reserved", // 56
+    "Reserved", // 57
+    "Flow temperature 10^-3 Fahrenheit", // 58
+    "Flow temperature 10^-2 Fahrenheit", // 59
+    "Flow temperature 10^-1 Fahrenheit", // 5A
+    "Flow temperature 10^0 Fahrenheit", // 5B
+    "Return temperature 10^-3 Fahrenheit", // 5C
+    "Return temperature 10^-2 Fahrenheit", // 5D
+    "Return temperature 10^-1 Fahrenheit", // 5E
+    "Return temperature 10^0 Fahrenheit", // 5F
+    "Temperature difference 10^-3 Fahrenheit", // 60
+    "Temperature difference 10^-2 Fahrenheit", // 61
+    "Temperature difference 10^-1 Fahrenheit", // 62
+    "Temperature difference 10^0 Fahrenheit", // 63
+    "External temperature 10^-3 Fahrenheit", // 64
+    "External temperature 10^-2 Fahrenheit", // 65
+    "External temperature 10^-1 Fahrenheit", // 66
+    "External temperature 10^0 Fahrenheit", // 67
+    "Reserved", // 68
+    "Reserved", // 69
+    "Reserved", // 6A
+    "Reserved", // 6B
+    "Reserved", // 6C
+    "Reserved", // 6D
+    "Reserved", // 6E
+    "Reserved", // 6F
+    "Cold / Warm Temperature Limit 10^-3 Fahrenheit", // 70
+    "Cold / Warm Temperature Limit 10^-2 Fahrenheit", // 71
+    "Cold / Warm Temperature Limit 10^-1 Fahrenheit", // 72
+    "Cold / Warm Temperature Limit 10^0 Fahrenheit", // 73
+    "Cold / Warm Temperature Limit 10^-3 Celsius", // 74
+    "Cold / Warm Temperature Limit 10^-2 Celsius", // 75
+    "Cold / Warm Temperature Limit 10^-1 Celsius", // 76
+    "Cold / Warm Temperature Limit 10^0 Celsius", // 77
+    "Cumulative count max power 10^-3 W", // 78
+    "Cumulative count max power 10^-2 W", // 79
+    "Cumulative count max power 10^-1 W", // 7A
+    "Cumulative count max power 10^0 W", // 7B
+    "Cumulative count max power 10^1 W", // 7C
+    "Cumulative count max power 10^2 W", // 7D
+    "Cumulative count max power 10^3 W", // 7E
+    "Cumulative count max power 10^4 W", // 7F
+};
+
+// Vifes after the second extension vif 0xfd.
+constexpr const char *vife_7D_table_[] =
+{
+    "Credit of 10^-3 of the nominal local legal currency units", // 00
+    "Credit of 10^-2 of the nominal local legal currency units", // 01
+    "Credit of 10^-1 of the nominal local legal currency units", // 02
+    "Credit of 10^0 of the nominal local legal currency units", // 03
+    "Debit of 10^-3 of the nominal local legal currency units", // 04
+    "Debit of 10^-2 of the nominal local legal currency units", // 05
+    "Debit of 10^-1 of the nominal local legal currency units", // 06
+    "Debit of 10^0 of the nominal local legal currency units", // 07
+    "Access Number (transmission count)", // 08
+    "Medium (as in fixed header)", // 09
+    "Manufacturer (as in fixed header)", // 0A
+    "Parameter set identification", // 0B
+    "Model/Version", // 0C
+    "Hardware version #", // 0D
+    "Firmware version #", // 0E
+    "Software version #", // 0F
+    "Customer location", // 10
+    "Customer", // 11
+    "Access Code User", // 12
+    "Access Code Operator", // 13
+    "Access Code System Operator", // 14
+    "Access Code Developer", // 15
+    "Password", // 16
+    "Error flags (binary)", // 17
+    "Error mask", // 18
+    "Reserved", // 19
+    "Digital Output (binary)", // 1A
+    "Digital Input (binary)", // 1B
+    "Baudrate [Baud]", // 1C
+    "Response delay time [bittimes]", // 1D
+    "Retry", // 1E
+    "Reserved", // 1F
+    "First storage # for cyclic storage", // 20
+    "Last storage # for cyclic storage", // 21
+    "Size of storage block", // 22
+    "Reserved", // 23
+    "Storage interval [second(s)]", // 24
+    "Storage interval [minute(s)]", // 25
+    "Storage interval [hour(s)]", // 26
+    "Storage interval [day(s)]", // 27
+    "Storage interval month(s)", // 28
+    "Storage interval year(s)", // 29
+    "Reserved", // 2A
+    "Reserved", // 2B
+    "Duration since last readout [second(s)]", // 2C
+    "Duration since last readout [minute(s)]", // 2D
+    "Duration since last readout [hour(s)]", // 2E
+    "Duration since last readout [day(s)]", // 2F
+    "Start (date/time) of tariff", // 30
+    "Duration of tariff [minute(s)]", // 31
+    "Duration of tariff [hour(s)]", // 32
+    "Duration of tariff [day(s)]", // 33
+    "Period of tariff [second(s)]", // 34
+    "Period of tariff [minute(s)]", // 35
+    "Period of tariff [hour(s)]", // 36
+    "Period of tariff [day(s)]", // 37
+    "Period of tariff months(s)", // 38
+    "Period of tariff year(s)", // 39
+    "Dimensionless / no VIF", // 3A
+    "Reserved", // 3B
+    "Reserved", // 3C
+    "Reserved", // 3D
+    "Reserved", // 3E
+    "Reserved", // 3F
+    "10^-9 Volts", // 40
+    "10^-8 Volts", // 41
+    "10^-7 Volts", // 42
+    "10^-6 Volts", // 43
+    "10^-5 Volts", // 44
+    "10^-4 Volts", // 45
+    "10^-3 Volts", // 46
+    "10^-2 Volts", // 47
+    "10^-1 Volts", // 48
+    "10^0 Volts", // 49
+    "10^1 Volts", // 4A
+    "10^2 Volts", // 4B
+    "10^3 Volts", // 4C
+    "10^4 Volts", // 4D
+    "10^5 Volts", // 4E
+    "10^6 Volts", // 4F
+    "10^-12 Ampere", // 50
+    "10^-11 Ampere", // 51
+    "10^-10 Ampere", // 52
+    "10^-9 Ampere", // 53
+    "10^-8 Ampere", // 54
+    "10^-7 Ampere", // 55
+    "10^-6 Ampere", // 56
+    "10^-5 Ampere", // 57
+    "10^-4 Ampere", // 58
+    "10^-3 Ampere", // 59
+    "10^-2 Ampere", // 5A
+    "10^-1 Ampere", // 5B
+    "10^0 Ampere", // 5C
+    "10^1 Ampere", // 5D
+    "10^2 Ampere", // 5E
+    "10^3 Ampere", // 5F
+    "Reset counter", // 60
+    "Cumulation counter", // 61
+    "Control signal", // 62
+    "Day of week", // 63
+    "Week number", // 64
+    "Time point of day change", // 65
+    "State of parameter activation", // 66
+    "Special supplier information", // 67
+    "Duration since last cumulation [hour(s)]", // 68
+    "Duration since last cumulation [day(s)]", // 69
+    "Duration since last cumulation [month(s)]", // 6A
+    "Duration since last cumulation [year(s)]", // 6B
+    "Operating time battery [hour(s)]", // 6C
+    "Operating time battery [day(s)]", // 6D
+    "Operating time battery [month(s)]", // 6E
+    "Operating time battery [year(s)]", // 6F
+    "Date and time of battery change", // 70
+    "Reserved", // 71
+    "Reserved", // 72
+    "Reserved", // 73
+    "Reserved", // 74
+    "Reserved", // 75
+    "Reserved", // 76
+    "Reserved", // 77
+    "Reserved", // 78
+    "Reserved", // 79
+    "Reserved", // 7A
+    "Reserved", // 7B
+    "Reserved", // 7C
+    "Reserved", // 7D
+    "Reserved", // 7E
+    "Reserved", // 7F
+};
+
+// Combinable vifes after any other vif.
+constexpr const char *vife_table_[] =
+{
+    "?", // 00
+    "?", // 01
+    "?", // 02
+    "?", // 03
+    "?", // 04
+    "?", // 05
+    "?", // 06
+    "?", // 07
+    "?", // 08
+    "?", // 09
+    "?", // 0A
+    "?", // 0B
+    "?", // 0C
+    "?", // 0D
+    "?", // 0E
+    "?", // 0F
+    "?", // 10
+    "?", // 11
+    "?", // 12
+    "Reverse compact profile without register", // 13
+    "?", // 14
+    "?", // 15
+    "?", // 16
+    "?", // 17
+    "?", // 18
+    "?", // 19
+    "?", // 1A
+    "?", // 1B
+    "?", // 1C
+    "?", // 1D
+    "Compact profile with register", // 1E
+    "Compact profile without register", // 1F
+    "per second", // 20
+    "per minute", // 21
+    "per hour", // 22
+    "per day", // 23
+    "per week", // 24
+    "per month", // 25
+    "per year", // 26
+    "per revolution/measurement", // 27
+    "incr per input pulse on input channel 0", // 28
+    "incr per input pulse on input channel 1", // 29
+    "incr per output pulse on input channel 0", // 2A
+    "incr per output pulse on input channel 1", // 2B
+    "per litre", // 2C
+    "per m3", // 2D
+    "per kg", // 2E
+    "per kelvin", // 2F
+    "per kWh", // 30
+    "per GJ", // 31
+    "per kW", // 32
+    "per kelvin*litre", // 33
+    "per volt", // 34
+    "per ampere", // 35
+    "multiplied by s", // 36
+    "multiplied by s/V", // 37
+    "multiplied by s/A", // 38
+    "start date/time of a,b", // 39
+    "uncorrected meter unit", // 3A
+    "forward flow", // 3B
+    "backward flow", // 3C
+    "reserved for non-metric unit systems", // 3D
+    "value at base conditions c", // 3E
+    "obis-declaration", // 3F
+    "obis-declaration", // 40
+    "number of exceeds of lower limit", // 41
+    "date/time of beginning  of first lower limit exceed", // 42
+    "date/time of end  of first lower limit exceed", // 43
+    "?", // 44
+    "?", // 45
+    "date/time of beginning  of last lower limit exceed", // 46
+    "date/time of end  of last lower limit exceed", // 47
+    "upper limit", // 48
+    "number of exceeds of upper limit", // 49
+    "date/time of beginning  of first upper limit exceed", // 4A
+    "date/time of end  of first upper limit exceed", // 4B
+    "?", // 4C
+    "?", // 4D
+    "date/time of beginning  of last upper limit exceed", // 4E
+    "date/time of end  of last upper limit exceed", // 4F
+    "duration of limit exceed first lower  is 0", // 50
+    "duration of limit exceed first lower  is 1", // 51
+    "duration of limit exceed first lower  is 2", // 52
+    "duration of limit exceed first lower  is 3", // 53
+    "duration of limit exceed last lower  is 0", // 54
+    "duration of limit exceed last lower  is 1", // 55
+    "duration of limit exceed last lower  is 2", // 56
+    "duration of limit exceed last lower  is 3", // 57
+    "duration of limit exceed first upper  is 0", // 58
+    "duration of limit exceed first upper  is 1", // 59
+    "duration of limit exceed first upper  is 2", // 5A
+    "duration of limit exceed first upper  is 3", // 5B
+    "duration of limit exceed last upper  is 0", // 5C
+    "duration of limit exceed last upper  is 1", // 5D
+    "duration of limit exceed last upper  is 2", // 5E
+    "duration of limit exceed last upper  is 3", // 5F
+    "duration of a,b first  is 0", // 60
+    "duration of a,b first  is 1", // 61
+    "duration of a,b first  is 2", // 62
+    "duration of a,b first  is 3", // 63
+    "duration of a,b last  is 0", // 64
+    "duration of a,b last  is 1", // 65
+    "duration of a,b last  is 2", // 66
+    "duration of a,b last  is 3", // 67
+    "value during lower limit exceed", // 68
+    "leakage values", // 69
+    "date/time of a: beginning  of first upper ", // 6A
+    "date/time of a: end  of first upper ", // 6B
+    "value during upper limit exceed", // 6C
+    "overflow values", // 6D
+    "date/time of a: beginning  of last upper ", // 6E
+    "date/time of a: end  of last upper ", // 6F
+    "multiplicative correction factor: 10^-6", // 70
+    "multiplicative correction factor: 10^-5", // 71
+    "multiplicative correction factor: 10^-4", // 72
+    "multiplicative correction factor: 10^-3", // 73
+    "multiplicative correction factor: 10^-2", // 74
+    "multiplicative correction factor: 10^-1", // 75
+    "multiplicative correction factor: 10^0", // 76
+    "multiplicative correction factor: 10^1", // 77
+    "additive correction constant: unit of VIF * 10^-3", // 78
+    "additive correction constant: unit of VIF * 10^-2", // 79
+    "additive correction constant: unit of VIF * 10^-1", // 7A
+    "additive correction constant: unit of VIF * 10^0", // 7B
+    "additive correction constant: unit of VIF * 10^-3", // 7C
+    "additive correction constant: unit of VIF * 10^-2", // 7D
+    "additive correction constant: unit of VIF * 10^-1", // 7E
+    "additive correction constant: unit of VIF * 10^0", // 7F
+};
+
+static_assert(sizeof(vife_7B_table_)/sizeof(vife_7B_table_[0]) == 128, "the vife table must cover all vifes");
+static_assert(sizeof(vife_7D_table_)/sizeof(vife_7D_table_[0]) == 128, "the vife table must cover all vifes");
+static_assert(sizeof(vife_table_)/sizeof(vife_table_[0]) == 128, "the vife table must cover all vifes");
+
+const char *vifType(int vif)
 {
     int extension = vif & 0x80;
     int t = vif & 0x7f;
@@ -2031,1340 +2710,66 @@ string vifType(int vif)
         }
     }
 
-    switch (t) {
-    case 0x00: return "Energy mWh";
-    case 0x01: return "Energy 10⁻² Wh";
-    case 0x02: return "Energy 10⁻¹ Wh";
-    case 0x03: return "Energy Wh";
-    case 0x04: return "Energy 10¹ Wh";
-    case 0x05: return "Energy 10² Wh";
-    case 0x06: return "Energy kWh";
-    case 0x07: return "Energy 10⁴ Wh";
-
-    case 0x08: return "Energy J";
-    case 0x09: return "Energy 10¹ J";
-    case 0x0A: return "Energy 10² J";
-    case 0x0B: return "Energy kJ";
-    case 0x0C: return "Energy 10⁴ J";
-    case 0x0D: return "Energy 10⁵ J";
-    case 0x0E: return "Energy MJ";
-    case 0x0F: return "Energy 10⁷ J";
-
-    case 0x10: return "Volume cm³";
-    case 0x11: return "Volume 10⁻⁵ m³";
-    case 0x12: return "Volume 10⁻⁴ m³";
-    case 0x13: return "Volume l";
-    case 0x14: return "Volume 10⁻² m³";
-    case 0x15: return "Volume 10⁻¹ m³";
-    case 0x16: return "Volume m³";
-    case 0x17: return "Volume 10¹ m³";
-
-    case 0x18: return "Mass g";
-    case 0x19: return "Mass 10⁻² kg";
-    case 0x1A: return "Mass 10⁻¹ kg";
-    case 0x1B: return "Mass kg";
-    case 0x1C: return "Mass 10¹ kg";
-    case 0x1D: return "Mass 10² kg";
-    case 0x1E: return "Mass t";
-    case 0x1F: return "Mass 10⁴ kg";
-
-    case 0x20: return "On time seconds";
-    case 0x21: return "On time minutes";
-    case 0x22: return "On time hours";
-    case 0x23: return "On time days";
-
-    case 0x24: return "Operating time seconds";
-    case 0x25: return "Operating time minutes";
-    case 0x26: return "Operating time hours";
-    case 0x27: return "Operating time days";
-
-    case 0x28: return "Power mW";
-    case 0x29: return "Power 10⁻² W";
-    case 0x2A: return "Power 10⁻¹ W";
-    case 0x2B: return "Power W";
-    case 0x2C: return "Power 10¹ W";
-    case 0x2D: return "Power 10² W";
-    case 0x2E: return "Power kW";
-    case 0x2F: return "Power 10⁴ W";
-
-    case 0x30: return "Power J/h";
-    case 0x31: return "Power 10¹ J/h";
-    case 0x32: return "Power 10² J/h";
-    case 0x33: return "Power kJ/h";
-    case 0x34: return "Power 10⁴ J/h";
-    case 0x35: return "Power 10⁵ J/h";
-    case 0x36: return "Power MJ/h";
-    case 0x37: return "Power 10⁷ J/h";
-
-    case 0x38: return "Volume flow cm³/h";
-    case 0x39: return "Volume flow 10⁻⁵ m³/h";
-    case 0x3A: return "Volume flow 10⁻⁴ m³/h";
-    case 0x3B: return "Volume flow l/h";
-    case 0x3C: return "Volume flow 10⁻² m³/h";
-    case 0x3D: return "Volume flow 10⁻¹ m³/h";
-    case 0x3E: return "Volume flow m³/h";
-    case 0x3F: return "Volume flow 10¹ m³/h";
-
-    case 0x40: return "Volume flow ext. 10⁻⁷ m³/min";
-    case 0x41: return "Volume flow ext. cm³/min";
-    case 0x42: return "Volume flow ext. 10⁻⁵ m³/min";
-    case 0x43: return "Volume flow ext. 10⁻⁴ m³/min";
-    case 0x44: return "Volume flow ext. l/min";
-    case 0x45: return "Volume flow ext. 10⁻² m³/min";
-    case 0x46: return "Volume flow ext. 10⁻¹ m³/min";
-    case 0x47: return "Volume flow ext. m³/min";
-
-    case 0x48: return "Volume flow ext. mm³/s";
-    case 0x49: return "Volume flow ext. 10⁻⁸ m³/s";
-    case 0x4A: return "Volume flow ext. 10⁻⁷ m³/s";
-    case 0x4B: return "Volume flow ext. cm³/s";
-    case 0x4C: return "Volume flow ext. 10⁻⁵ m³/s";
-    case 0x4D: return "Volume flow ext. 10⁻⁴ m³/s";
-    case 0x4E: return "Volume flow ext. l/s";
-    case 0x4F: return "Volume flow ext. 10⁻² m³/s";
-
-    case 0x50: return "Mass g/h";
-    case 0x51: return "Mass 10⁻² kg/h";
-    case 0x52: return "Mass 10⁻¹ kg/h";
-    case 0x53: return "Mass kg/h";
-    case 0x54: return "Mass 10¹ kg/h";
-    case 0x55: return "Mass 10² kg/h";
-    case 0x56: return "Mass t/h";
-    case 0x57: return "Mass 10⁴ kg/h";
-
-    case 0x58: return "Flow temperature 10⁻³ °C";
-    case 0x59: return "Flow temperature 10⁻² °C";
-    case 0x5A: return "Flow temperature 10⁻¹ °C";
-    case 0x5B: return "Flow temperature °C";
-
-    case 0x5C: return "Return temperature 10⁻³ °C";
-    case 0x5D: return "Return temperature 10⁻² °C";
-    case 0x5E: return "Return temperature 10⁻¹ °C";
-    case 0x5F: return "Return temperature °C";
-
-    case 0x60: return "Temperature difference mK";
-    case 0x61: return "Temperature difference 10⁻² K";
-    case 0x62: return "Temperature difference 10⁻¹ K";
-    case 0x63: return "Temperature difference K";
-
-    case 0x64: return "External temperature 10⁻³ °C";
-    case 0x65: return "External temperature 10⁻² °C";
-    case 0x66: return "External temperature 10⁻¹ °C";
-    case 0x67: return "External temperature °C";
-
-    case 0x68: return "Pressure mbar";
-    case 0x69: return "Pressure 10⁻² bar";
-    case 0x6A: return "Pressure 10⁻1 bar";
-    case 0x6B: return "Pressure bar";
-
-    case 0x6C: return "Date type G";
-    case 0x6D: return "Date and time type";
-
-    case 0x6E: return "Units for H.C.A.";
-    case 0x6F: return "Reserved";
-
-    case 0x70: return "Averaging duration seconds";
-    case 0x71: return "Averaging duration minutes";
-    case 0x72: return "Averaging duration hours";
-    case 0x73: return "Averaging duration days";
-
-    case 0x74: return "Actuality duration seconds";
-    case 0x75: return "Actuality duration minutes";
-    case 0x76: return "Actuality duration hours";
-    case 0x77: return "Actuality duration days";
-
-    case 0x78: return "Fabrication no";
-    case 0x79: return "Enhanced identification";
-
-    case 0x7C: return "VIF in following string (length in first byte)";
-    case 0x7E: return "Any VIF";
-    case 0x7F: return "Manufacturer specific";
-    default: return "?";
-    }
+    return vif_table_[t].description;
 }
 
 double vifScale(int vif)
 {
     int t = vif & 0x7f;
+    double scale = vif_table_[t].scale;
 
-    switch (t) {
-        // wmbusmeters always returns enery as kwh
-    case 0x00: return 1000000.0; // Energy mWh
-    case 0x01: return 100000.0;  // Energy 10⁻² Wh
-    case 0x02: return 10000.0;   // Energy 10⁻¹ Wh
-    case 0x03: return 1000.0;    // Energy Wh
-    case 0x04: return 100.0;     // Energy 10¹ Wh
-    case 0x05: return 10.0;      // Energy 10² Wh
-    case 0x06: return 1.0;       // Energy kWh
-    case 0x07: return 0.1;       // Energy 10⁴ Wh
-
-        // or wmbusmeters always returns energy as MJ
-    case 0x08: return 1000000.0; // Energy J
-    case 0x09: return 100000.0;  // Energy 10¹ J
-    case 0x0A: return 10000.0;   // Energy 10² J
-    case 0x0B: return 1000.0;    // Energy kJ
-    case 0x0C: return 100.0;     // Energy 10⁴ J
-    case 0x0D: return 10.0;      // Energy 10⁵ J
-    case 0x0E: return 1.0;       // Energy MJ
-    case 0x0F: return 0.1;       // Energy 10⁷ J
-
-        // wmbusmeters always returns volume as m3
-    case 0x10: return 1000000.0; // Volume cm³
-    case 0x11: return 100000.0; // Volume 10⁻⁵ m³
-    case 0x12: return 10000.0; // Volume 10⁻⁴ m³
-    case 0x13: return 1000.0; // Volume l
-    case 0x14: return 100.0; // Volume 10⁻² m³
-    case 0x15: return 10.0; // Volume 10⁻¹ m³
-    case 0x16: return 1.0; // Volume m³
-    case 0x17: return 0.1; // Volume 10¹ m³
-
-        // wmbusmeters always returns weight in kg
-    case 0x18: return 1000.0; // Mass g
-    case 0x19: return 100.0;  // Mass 10⁻² kg
-    case 0x1A: return 10.0;   // Mass 10⁻¹ kg
-    case 0x1B: return 1.0;    // Mass kg
-    case 0x1C: return 0.1;    // Mass 10¹ kg
-    case 0x1D: return 0.01;   // Mass 10² kg
-    case 0x1E: return 0.001;  // Mass t
-    case 0x1F: return 0.0001; // Mass 10⁴ kg
-
-        // wmbusmeters always returns time in hours
-    case 0x20: return 3600.0;     // On time seconds
-    case 0x21: return 60.0;       // On time minutes
-    case 0x22: return 1.0;        // On time hours
-    case 0x23: return (1.0/24.0); // On time days
-
-    case 0x24: return 3600.0;     // Operating time seconds
-    case 0x25: return 60.0;       // Operating time minutes
-    case 0x26: return 1.0;        // Operating time hours
-    case 0x27: return (1.0/24.0); // Operating time days
-
-        // wmbusmeters always returns power in kw
-    case 0x28: return 1000000.0; // Power mW
-    case 0x29: return 100000.0; // Power 10⁻² W
-    case 0x2A: return 10000.0; // Power 10⁻¹ W
-    case 0x2B: return 1000.0; // Power W
-    case 0x2C: return 100.0; // Power 10¹ W
-    case 0x2D: return 10.0; // Power 10² W
-    case 0x2E: return 1.0; // Power kW
-    case 0x2F: return 0.1; // Power 10⁴ W
-
-        // or wmbusmeters always returns power in MJh
-    case 0x30: return 1000000.0; // Power J/h
-    case 0x31: return 100000.0; // Power 10¹ J/h
-    case 0x32: return 10000.0; // Power 10² J/h
-    case 0x33: return 1000.0; // Power kJ/h
-    case 0x34: return 100.0; // Power 10⁴ J/h
-    case 0x35: return 10.0; // Power 10⁵ J/h
-    case 0x36: return 1.0; // Power MJ/h
-    case 0x37: return 0.1; // Power 10⁷ J/h
-
-        // wmbusmeters always returns volume flow in m3h
-    case 0x38: return 1000000.0; // Volume flow cm³/h
-    case 0x39: return 100000.0; // Volume flow 10⁻⁵ m³/h
-    case 0x3A: return 10000.0; // Volume flow 10⁻⁴ m³/h
-    case 0x3B: return 1000.0; // Volume flow l/h
-    case 0x3C: return 100.0; // Volume flow 10⁻² m³/h
-    case 0x3D: return 10.0; // Volume flow 10⁻¹ m³/h
-    case 0x3E: return 1.0; // Volume flow m³/h
-    case 0x3F: return 0.1; // Volume flow 10¹ m³/h
-
-        // wmbusmeters always returns volume flow in m3h
-    case 0x40: return 600000000.0; // Volume flow ext. 10⁻⁷ m³/min
-    case 0x41: return 60000000.0; // Volume flow ext. cm³/min
-    case 0x42: return 6000000.0; // Volume flow ext. 10⁻⁵ m³/min
-    case 0x43: return 600000.0; // Volume flow ext. 10⁻⁴ m³/min
-    case 0x44: return 60000.0; // Volume flow ext. l/min
-    case 0x45: return 6000.0; // Volume flow ext. 10⁻² m³/min
-    case 0x46: return 600.0; // Volume flow ext. 10⁻¹ m³/min
-    case 0x47: return 60.0; // Volume flow ext. m³/min
-
-        // this flow numbers will be small in the m3h unit, but it
-        // does not matter since double stores the scale factor in its exponent.
-    case 0x48: return 1000000000.0*3600; // Volume flow ext. mm³/s
-    case 0x49: return 100000000.0*3600; // Volume flow ext. 10⁻⁸ m³/s
-    case 0x4A: return 10000000.0*3600; // Volume flow ext. 10⁻⁷ m³/s
-    case 0x4B: return 1000000.0*3600; // Volume flow ext. cm³/s
-    case 0x4C: return 100000.0*3600; // Volume flow ext. 10⁻⁵ m³/s
-    case 0x4D: return 10000.0*3600; // Volume flow ext. 10⁻⁴ m³/s
-    case 0x4E: return 1000.0*3600; // Volume flow ext. l/s
-    case 0x4F: return 100.0*3600; // Volume flow ext. 10⁻² m³/s
-
-        // wmbusmeters always returns mass flow as kgh
-    case 0x50: return 1000.0; // Mass g/h
-    case 0x51: return 100.0; // Mass 10⁻² kg/h
-    case 0x52: return 10.0; // Mass 10⁻¹ kg/h
-    case 0x53: return 1.0; // Mass kg/h
-    case 0x54: return 0.1; // Mass 10¹ kg/h
-    case 0x55: return 0.01; // Mass 10² kg/h
-    case 0x56: return 0.001; // Mass t/h
-    case 0x57: return 0.0001; // Mass 10⁴ kg/h
-
-        // wmbusmeters always returns temperature in °C
-    case 0x58: return 1000.0; // Flow temperature 10⁻³ °C
-    case 0x59: return 100.0; // Flow temperature 10⁻² °C
-    case 0x5A: return 10.0; // Flow temperature 10⁻¹ °C
-    case 0x5B: return 1.0; // Flow temperature °C
-
-        // wmbusmeters always returns temperature in c
-    case 0x5C: return 1000.0;  // Return temperature 10⁻³ °C
-    case 0x5D: return 100.0; // Return temperature 10⁻² °C
-    case 0x5E: return 10.0; // Return temperature 10⁻¹ °C
-    case 0x5F: return 1.0; // Return temperature °C
-
-        // or if Kelvin is used as a temperature, in K
-        // what kind of meter cares about -273.15 °C
-        // a flow pump for liquid helium perhaps?
-    case 0x60: return 1000.0; // Temperature difference mK
-    case 0x61: return 100.0; // Temperature difference 10⁻² K
-    case 0x62: return 10.0; // Temperature difference 10⁻¹ K
-    case 0x63: return 1.0; // Temperature difference K
-
-        // wmbusmeters always returns temperature in c
-    case 0x64: return 1000.0; // External temperature 10⁻³ °C
-    case 0x65: return 100.0; // External temperature 10⁻² °C
-    case 0x66: return 10.0; // External temperature 10⁻¹ °C
-    case 0x67: return 1.0; // External temperature °C
-
-        // wmbusmeters always returns pressure in bar
-    case 0x68: return 1000.0; // Pressure mbar
-    case 0x69: return 100.0; // Pressure 10⁻² bar
-    case 0x6A: return 10.0; // Pressure 10⁻1 bar
-    case 0x6B: return 1.0; // Pressure bar
-
-    case 0x6C: warning("(wmbus) warning: do not scale a date type!\n"); return -1.0; // Date type G
-    case 0x6E: return 1.0; // Units for H.C.A. are never scaled
-    case 0x6F: warning("(wmbus) warning: do not scale a reserved type!\n"); return -1.0; // Reserved
-
-        // wmbusmeters always returns time in hours
-    case 0x70: return 3600.0; // Averaging duration seconds
-    case 0x71: return 60.0; // Averaging duration minutes
-    case 0x72: return 1.0; // Averaging duration hours
-    case 0x73: return (1.0/24.0); // Averaging duration days
-
-    case 0x74: return 3600.0; // Actuality duration seconds
-    case 0x75: return 60.0; // Actuality duration minutes
-    case 0x76: return 1.0; // Actuality duration hours
-    case 0x77: return (1.0/24.0); // Actuality duration days
-
-    case 0x78: // Fabrication no
-    case 0x79: // Enhanced identification
-    case 0x80: // Address
-
-    case 0x7C: // VIF in following string (length in first byte)
-    case 0x7E: // Any VIF
-    case 0x7F: // Manufacturer specific
-
-    default: warning("(wmbus) warning: type %d cannot be scaled!\n", t);
-        return -1;
-    }
-}
-
-string vifKey(int vif)
-{
-    int t = vif & 0x7f;
-
-    switch (t) {
-
-    case 0x00:
-    case 0x01:
-    case 0x02:
-    case 0x03:
-    case 0x04:
-    case 0x05:
-    case 0x06:
-    case 0x07: return "energy";
-
-    case 0x08:
-    case 0x09:
-    case 0x0A:
-    case 0x0B:
-    case 0x0C:
-    case 0x0D:
-    case 0x0E:
-    case 0x0F: return "energy";
-
-    case 0x10:
-    case 0x11:
-    case 0x12:
-    case 0x13:
-    case 0x14:
-    case 0x15:
-    case 0x16:
-    case 0x17: return "volume";
-
-    case 0x18:
-    case 0x19:
-    case 0x1A:
-    case 0x1B:
-    case 0x1C:
-    case 0x1D:
-    case 0x1E:
-    case 0x1F: return "mass";
-
-    case 0x20:
-    case 0x21:
-    case 0x22:
-    case 0x23: return "on_time";
-
-    case 0x24:
-    case 0x25:
-    case 0x26:
-    case 0x27: return "operating_time";
-
-    case 0x28:
-    case 0x29:
-    case 0x2A:
-    case 0x2B:
-    case 0x2C:
-    case 0x2D:
-    case 0x2E:
-    case 0x2F: return "power";
-
-    case 0x30:
-    case 0x31:
-    case 0x32:
-    case 0x33:
-    case 0x34:
-    case 0x35:
-    case 0x36:
-    case 0x37: return "power";
-
-    case 0x38:
-    case 0x39:
-    case 0x3A:
-    case 0x3B:
-    case 0x3C:
-    case 0x3D:
-    case 0x3E:
-    case 0x3F: return "volume_flow";
-
-    case 0x40:
-    case 0x41:
-    case 0x42:
-    case 0x43:
-    case 0x44:
-    case 0x45:
-    case 0x46:
-    case 0x47: return "volume_flow_ext";
-
-    case 0x48:
-    case 0x49:
-    case 0x4A:
-    case 0x4B:
-    case 0x4C:
-    case 0x4D:
-    case 0x4E:
-    case 0x4F: return "volume_flow_ext";
-
-    case 0x50:
-    case 0x51:
-    case 0x52:
-    case 0x53:
-    case 0x54:
-    case 0x55:
-    case 0x56:
-    case 0x57: return "mass_flow";
-
-    case 0x58:
-    case 0x59:
-    case 0x5A:
-    case 0x5B: return "flow_temperature";
-
-    case 0x5C:
-    case 0x5D:
-    case 0x5E:
-    case 0x5F: return "return_temperature";
-
-    case 0x60:
-    case 0x61:
-    case 0x62:
-    case 0x63: return "temperature_difference";
-
-    case 0x64:
-    case 0x65:
-    case 0x66:
-    case 0x67: return "external_temperature";
-
-    case 0x68:
-    case 0x69:
-    case 0x6A:
-    case 0x6B: return "pressure";
-
-    case 0x6C: return "date"; // Date type G
-    case 0x6E: return "hca"; // Units for H.C.A.
-    case 0x6F: return "reserved"; // Reserved
-
-    case 0x70:
-    case 0x71:
-    case 0x72:
-    case 0x73: return "average_duration";
-
-    case 0x74:
-    case 0x75:
-    case 0x76:
-    case 0x77: return "actual_duration";
-
-    case 0x78: return "fabrication_no"; // Fabrication no
-    case 0x79: return "enhanced_identification"; // Enhanced identification
-
-    case 0x7C: // VIF in following string (length in first byte)
-    case 0x7E: // Any VIF
-    case 0x7F: // Manufacturer specific
-
-    default: warning("(wmbus) warning: generic type %d cannot be scaled!\n", t);
-        return "unknown";
+    if (scale < 0) {
+        switch (t) {
+        case 0x6C: warning("(wmbus) warning: do not scale a date type!\n"); break;
+        case 0x6F: warning("(wmbus) warning: do not scale a reserved type!\n"); break;
+        default: warning("(wmbus) warning: type %d cannot be scaled!\n", t); break;
+        }
     }
+    return scale;
 }
 
-string vifUnit(int vif)
+const char *vifKey(int vif)
 {
     int t = vif & 0x7f;
+    const char *key = vif_table_[t].key;
 
-    switch (t) {
-
-    case 0x00:
-    case 0x01:
-    case 0x02:
-    case 0x03:
-    case 0x04:
-    case 0x05:
-    case 0x06:
-    case 0x07: return "kwh";
-
-    case 0x08:
-    case 0x09:
-    case 0x0A:
-    case 0x0B:
-    case 0x0C:
-    case 0x0D:
-    case 0x0E:
-    case 0x0F: return "MJ";
-
-    case 0x10:
-    case 0x11:
-    case 0x12:
-    case 0x13:
-    case 0x14:
-    case 0x15:
-    case 0x16:
-    case 0x17: return "m3";
-
-    case 0x18:
-    case 0x19:
-    case 0x1A:
-    case 0x1B:
-    case 0x1C:
-    case 0x1D:
-    case 0x1E:
-    case 0x1F: return "kg";
-
-    case 0x20:
-    case 0x21:
-    case 0x22:
-    case 0x23:
-    case 0x24:
-    case 0x25:
-    case 0x26:
-    case 0x27: return "h";
-
-    case 0x28:
-    case 0x29:
-    case 0x2A:
-    case 0x2B:
-    case 0x2C:
-    case 0x2D:
-    case 0x2E:
-    case 0x2F: return "kw";
-
-    case 0x30:
-    case 0x31:
-    case 0x32:
-    case 0x33:
-    case 0x34:
-    case 0x35:
-    case 0x36:
-    case 0x37: return "MJ";
-
-    case 0x38:
-    case 0x39:
-    case 0x3A:
-    case 0x3B:
-    case 0x3C:
-    case 0x3D:
-    case 0x3E:
-    case 0x3F: return "m3/h";
-
-    case 0x40:
-    case 0x41:
-    case 0x42:
-    case 0x43:
-    case 0x44:
-    case 0x45:
-    case 0x46:
-    case 0x47: return "m3/h";
-
-    case 0x48:
-    case 0x49:
-    case 0x4A:
-    case 0x4B:
-    case 0x4C:
-    case 0x4D:
-    case 0x4E:
-    case 0x4F: return "m3/h";
-
-    case 0x50:
-    case 0x51:
-    case 0x52:
-    case 0x53:
-    case 0x54:
-    case 0x55:
-    case 0x56:
-    case 0x57: return "kg/h";
-
-    case 0x58:
-    case 0x59:
-    case 0x5A:
-    case 0x5B: return "c";
-
-    case 0x5C:
-    case 0x5D:
-    case 0x5E:
-    case 0x5F: return "c";
-
-    case 0x60:
-    case 0x61:
-    case 0x62:
-    case 0x63: return "k";
-
-    case 0x64:
-    case 0x65:
-    case 0x66:
-    case 0x67: return "c";
-
-    case 0x68:
-    case 0x69:
-    case 0x6A:
-    case 0x6B: return "bar";
-
-    case 0x6C: return ""; // Date type G
-    case 0x6D: return ""; // ??
-    case 0x6E: return ""; // Units for H.C.A.
-    case 0x6F: return ""; // Reserved
-
-    case 0x70:
-    case 0x71:
-    case 0x72:
-    case 0x73: return "h";
-
-    case 0x74:
-    case 0x75:
-    case 0x76:
-    case 0x77: return "h";
-
-    case 0x78: return ""; // Fabrication no
-    case 0x79: return ""; // Enhanced identification
-
-    case 0x7C: // VIF in following string (length in first byte)
-    case 0x7E: // Any VIF
-    case 0x7F: // Manufacturer specific
-
-    default: warning("(wmbus) warning: generic type %d cannot be scaled!\n", t);
+    if (key == NULL) {
+        warning("(wmbus) warning: generic type %d cannot be scaled!\n", t);
         return "unknown";
     }
+    return key;
 }
 
-const char *timeNN(int nn) {
-    switch (nn) {
-    case 0: return "second(s)";
-    case 1: return "minute(s)";
-    case 2: return "hour(s)";
-    case 3: return "day(s)";
-    }
-    return "?";
-}
-
-const char *timePP(int nn) {
-    switch (nn) {
-    case 0: return "hour(s)";
-    case 1: return "day(s)";
-    case 2: return "month(s)";
-    case 3: return "year(s)";
-    }
-    return "?";
-}
-
-string vif_7B_FirstExtensionType(uchar dif, uchar vif, uchar vife)
+const char *vifUnit(int vif)
 {
-    assert(vif == 0xfb);
-
-    if ((vife & 0x7e) == 0x00) {
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d MWh", n-1);
-        return s;
-    }
-
-    if (((vife & 0x7e) == 0x02) ||
-        ((vife & 0x7c) == 0x04)) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7e) == 0x08) {
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d GJ", n-1);
-        return s;
-    }
-
-    if ((vife & 0x7e) == 0x0a ||
-        (vife & 0x7c) == 0x0c) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7e) == 0x10) {
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d m3", n+2);
-        return s;
-    }
-
-    if ((vife & 0x7e) == 0x12 ||
-        (vife & 0x7c) == 0x14) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7e) == 0x18) {
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d ton", n+2);
-        return s;
-    }
-
-    if ( (vif & 0x7e) >= 0x1a && (vif & 0x7e) <= 0x20) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7f) == 0x21) {
-        return "0.1 feet^3";
-    }
-
-    if ((vife & 0x7f) == 0x22) {
-        return "0.1 american gallon";
-    }
-
-    if ((vife & 0x7f) == 0x23) {
-        return "american gallon";
-    }
-
-    if ((vife & 0x7f) == 0x24) {
-        return "0.001 american gallon/min";
-    }
-
-    if ((vife & 0x7f) == 0x25) {
-        return "american gallon/min";
-    }
-
-    if ((vife & 0x7f) == 0x26) {
-        return "american gallon/h";
-    }
-
-    if ((vife & 0x7f) == 0x27) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7f) == 0x20) {
-        return "Volume feet";
-    }
-
-    if ((vife & 0x7f) == 0x21) {
-        return "Volume 0.1 feet";
-    }
-
-    if ((vife & 0x7e) == 0x28) {
-        // Come again? A unit of 1MW...do they intend to use m-bus to track the
-        // output from a nuclear power plant?
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d MW", n-1);
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x29 ||
-        (vife & 0x7c) == 0x2c) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7e) == 0x30) {
-        int n = vife & 0x01;
-        string s;
-        strprintf(s, "10^%d GJ/h", n-1);
-        return s;
-    }
-
-    if ((vife & 0x7f) >= 0x32 && (vife & 0x7c) <= 0x57) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7c) == 0x58) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Flow temperature 10^%d Fahrenheit", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x5c) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Return temperature 10^%d Fahrenheit", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x60) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Temperature difference 10^%d Fahrenheit", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x64) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "External temperature 10^%d Fahrenheit", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x78) == 0x68) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7c) == 0x70) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Cold / Warm Temperature Limit 10^%d Fahrenheit", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x74) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Cold / Warm Temperature Limit 10^%d Celsius", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x78) == 0x78) {
-        int nnn = vife & 0x07;
-        string s;
-        strprintf(s, "Cumulative count max power 10^%d W", nnn-3);
-        return s;
-    }
-
-    return "?";
-}
-
-string vif_7D_SecondExtensionType(uchar dif, uchar vif, uchar vife)
-{
-    assert(vif == 0xfd);
-
-    if ((vife & 0x7c) == 0x00) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Credit of 10^%d of the nominal local legal currency units", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x04) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Debit of 10^%d of the nominal local legal currency units", nn-3);
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x08) {
-        return "Access Number (transmission count)";
-    }
-
-    if ((vife & 0x7f) == 0x09) {
-        return "Medium (as in fixed header)";
-    }
-
-    if ((vife & 0x7f) == 0x0a) {
-        return "Manufacturer (as in fixed header)";
-    }
-
-    if ((vife & 0x7f) == 0x0b) {
-        return "Parameter set identification";
-    }
-
-    if ((vife & 0x7f) == 0x0c) {
-        return "Model/Version";
-    }
-
-    if ((vife & 0x7f) == 0x0d) {
-        return "Hardware version #";
-    }
-
-    if ((vife & 0x7f) == 0x0e) {
-        return "Firmware version #";
-    }
-
-    if ((vife & 0x7f) == 0x0f) {
-        return "Software version #";
-    }
-
-    if ((vife & 0x7f) == 0x10) {
-        return "Customer location";
-    }
-
-    if ((vife & 0x7f) == 0x11) {
-        return "Customer";
-    }
-
-    if ((vife & 0x7f) == 0x12) {
-        return "Access Code User";
-    }
-
-    if ((vife & 0x7f) == 0x13) {
-        return "Access Code Operator";
-    }
-
-    if ((vife & 0x7f) == 0x14) {
-        return "Access Code System Operator";
-    }
-
-    if ((vife & 0x7f) == 0x15) {
-        return "Access Code Developer";
-    }
-
-    if ((vife & 0x7f) == 0x16) {
-        return "Password";
-    }
-
-    if ((vife & 0x7f) == 0x17) {
-        return "Error flags (binary)";
-    }
-
-    if ((vife & 0x7f) == 0x18) {
-        return "Error mask";
-    }
-
-    if ((vife & 0x7f) == 0x19) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7f) == 0x1a) {
-        return "Digital Output (binary)";
-    }
-
-    if ((vife & 0x7f) == 0x1b) {
-        return "Digital Input (binary)";
-    }
-
-    if ((vife & 0x7f) == 0x1c) {
-        return "Baudrate [Baud]";
-    }
-
-    if ((vife & 0x7f) == 0x1d) {
-        return "Response delay time [bittimes]";
-    }
-
-    if ((vife & 0x7f) == 0x1e) {
-        return "Retry";
-    }
-
-    if ((vife & 0x7f) == 0x1f) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7f) == 0x20) {
-        return "First storage # for cyclic storage";
-    }
-
-    if ((vife & 0x7f) == 0x21) {
-        return "Last storage # for cyclic storage";
-    }
-
-    if ((vife & 0x7f) == 0x22) {
-        return "Size of storage block";
-    }
-
-    if ((vife & 0x7f) == 0x23) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7c) == 0x24) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Storage interval [%s]", timeNN(nn));
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x28) {
-        return "Storage interval month(s)";
-    }
-
-    if ((vife & 0x7f) == 0x29) {
-        return "Storage interval year(s)";
-    }
-
-    if ((vife & 0x7f) == 0x2a) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7f) == 0x2b) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7c) == 0x2c) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Duration since last readout [%s]", timeNN(nn));
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x30) {
-        return "Start (date/time) of tariff";
-    }
-
-    if ((vife & 0x7c) == 0x30) {
-        int nn = vife & 0x03;
-        string s;
-        // nn == 0 (seconds) is not expected here! According to m-bus spec.
-        strprintf(s, "Duration of tariff [%s]", timeNN(nn));
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x34) {
-        int nn = vife & 0x03;
-        string s;
-        strprintf(s, "Period of tariff [%s]", timeNN(nn));
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x38) {
-        return "Period of tariff months(s)";
-    }
-
-    if ((vife & 0x7f) == 0x39) {
-        return "Period of tariff year(s)";
-    }
-
-    if ((vife & 0x7f) == 0x3a) {
-        return "Dimensionless / no VIF";
-    }
-
-    if ((vife & 0x7f) == 0x3b) {
-        return "Reserved";
-    }
-
-    if ((vife & 0x7c) == 0x3c) {
-        // int xx = vife & 0x03;
-        return "Reserved";
-    }
-
-    if ((vife & 0x70) == 0x40) {
-        int nnnn = vife & 0x0f;
-        string s;
-        strprintf(s, "10^%d Volts", nnnn-9);
-        return s;
-    }
-
-    if ((vife & 0x70) == 0x50) {
-        int nnnn = vife & 0x0f;
-        string s;
-        strprintf(s, "10^%d Ampere", nnnn-12);
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x60) {
-        return "Reset counter";
-    }
-
-    if ((vife & 0x7f) == 0x61) {
-        return "Cumulation counter";
-    }
-
-    if ((vife & 0x7f) == 0x62) {
-        return "Control signal";
-    }
-
-    if ((vife & 0x7f) == 0x63) {
-        return "Day of week";
-    }
-
-    if ((vife & 0x7f) == 0x64) {
-        return "Week number";
-    }
-
-    if ((vife & 0x7f) == 0x65) {
-        return "Time point of day change";
-    }
-
-    if ((vife & 0x7f) == 0x66) {
-        return "State of parameter activation";
-    }
-
-    if ((vife & 0x7f) == 0x67) {
-        return "Special supplier information";
-    }
-
-    if ((vife & 0x7c) == 0x68) {
-        int pp = vife & 0x03;
-        string s;
-        strprintf(s, "Duration since last cumulation [%s]", timePP(pp));
-        return s;
-    }
-
-    if ((vife & 0x7c) == 0x6c) {
-        int pp = vife & 0x03;
-        string s;
-        strprintf(s, "Operating time battery [%s]", timePP(pp));
-        return s;
-    }
-
-    if ((vife & 0x7f) == 0x70) {
-        return "Date and time of battery change";
-    }
+    int t = vif & 0x7f;
+    const char *unit = vif_table_[t].unit;
 
-    if ((vife & 0x7f) >= 0x71) {
-        return "Reserved";
+    if (unit == NULL) {
+        warning("(wmbus) warning: generic type %d cannot be scaled!\n", t);
+        return "unknown";
     }
-    return "?";
+    return unit;
 }
 
-string vif_6F_ThirdExtensionType(uchar dif, uchar vif, uchar vife)
+const char *vifeType(int dif, int vif, int vife)
 {
-    assert(vif == 0xef);
-    return "?";
-}
+    vife = vife & 0x7f; // Strip the bit signifying more vifes after this.
 
-string vifeType(int dif, int vif, int vife)
-{
     if (vif == 0xfb) { // 0x7b without high bit
-        return vif_7B_FirstExtensionType(dif, vif, vife);
+        return vife_7B_table_[vife];
     }
     if (vif == 0xfd) { // 0x7d without high bit
-        return vif_7D_SecondExtensionType(dif, vif, vife);
+        return vife_7D_table_[vife];
     }
     if (vif == 0xef) { // 0x6f without high bit
-        return vif_6F_ThirdExtensionType(dif, vif, vife);
-    }
-    vife = vife & 0x7f; // Strip the bit signifying more vifes after this.
-    if (vife == 0x1f) {
-        return "Compact profile without register";
-    }
-    if (vife == 0x13) {
-        return "Reverse compact profile without register";
-    }
-    if (vife == 0x1e) {
-        return "Compact profile with register";
-    }
-    if (vife == 0x20) {
-        return "per second";
-    }
-    if (vife == 0x21) {
-        return "per minute";
-    }
-    if (vife == 0x22) {
-        return "per hour";
-    }
-    if (vife == 0x23) {
-        return "per day";
-    }
-    if (vife == 0x24) {
-        return "per week";
-    }
-    if (vife == 0x25) {
-        return "per month";
-    }
-    if (vife == 0x26) {
-        return "per year";
-    }
-    if (vife == 0x27) {
-        return "per revolution/measurement";
-    }
-    if (vife == 0x28) {
-        return "incr per input pulse on input channel 0";
-    }
-    if (vife == 0x29) {
-        return "incr per input pulse on input channel 1";
-    }
-    if (vife == 0x2a) {
-        return "incr per output pulse on input channel 0";
-    }
-    if (vife == 0x2b) {
-        return "incr per output pulse on input channel 1";
-    }
-    if (vife == 0x2c) {
-        return "per litre";
-    }
-    if (vife == 0x2d) {
-        return "per m3";
-    }
-    if (vife == 0x2e) {
-        return "per kg";
-    }
-    if (vife == 0x2f) {
-        return "per kelvin";
-    }
-    if (vife == 0x30) {
-        return "per kWh";
-    }
-    if (vife == 0x31) {
-        return "per GJ";
-    }
-    if (vife == 0x32) {
-        return "per kW";
-    }
-    if (vife == 0x33) {
-        return "per kelvin*litre";
-    }
-    if (vife == 0x34) {
-        return "per volt";
-    }
-    if (vife == 0x35) {
-        return "per ampere";
-    }
-    if (vife == 0x36) {
-        return "multiplied by s";
-    }
-    if (vife == 0x37) {
-        return "multiplied by s/V";
-    }
-    if (vife == 0x38) {
-        return "multiplied by s/A";
-    }
-    if (vife == 0x39) {
-        return "start date/time of a,b";
-    }
-    if (vife == 0x3a) {
-        return "uncorrected meter unit";
-    }
-    if (vife == 0x3b) {
-        return "forward flow";
-    }
-    if (vife == 0x3c) {
-        return "backward flow";
+        return "?";
     }
-    if (vife == 0x3d) {
-        return "reserved for non-metric unit systems";
-    }
-    if (vife == 0x3e) {
-        return "value at base conditions c";
-    }
-    if (vife == 0x3f) {
-        return "obis-declaration";
-    }
-    if (vife == 0x40) {
-        return "obis-declaration";
-    }
-    if (vife == 0x40) {
-        return "lower limit";
-    }
-    if (vife == 0x48) {
-        return "upper limit";
-    }
-    if (vife == 0x41) {
-        return "number of exceeds of lower limit";
-    }
-    if (vife == 0x49) {
-        return "number of exceeds of upper limit";
-    }
-    if ((vife & 0x72) == 0x42) {
-        string msg = "date/time of ";
-        if (vife & 0x01) msg += "end ";
-        else msg += "beginning ";
-        msg +=" of ";
-        if (vife & 0x04) msg += "last ";
-        else msg += "first ";
-        if (vife & 0x08) msg += "upper ";
-        else msg += "lower ";
-        msg += "limit exceed";
-        return msg;
-    }
-    if ((vife & 0x70) == 0x50) {
-        string msg = "duration of limit exceed ";
-        if (vife & 0x04) msg += "last ";
-        else msg += "first ";
-        if (vife & 0x08) msg += "upper ";
-        else msg += "lower ";
-        int nn = vife & 0x03;
-        msg += " is "+to_string(nn);
-        return msg;
-    }
-    if ((vife & 0x78) == 0x60) {
-        string msg = "duration of a,b ";
-        if (vife & 0x04) msg += "last ";
-        else msg += "first ";
-        int nn = vife & 0x03;
-        msg += " is "+to_string(nn);
-        return msg;
-    }
-    if ((vife & 0x7B) == 0x68) {
-        string msg = "value during ";
-        if (vife & 0x04) msg += "upper ";
-        else msg += "lower ";
-        msg += "limit exceed";
-        return msg;
-    }
-    if (vife == 0x69) {
-        return "leakage values";
-    }
-    if (vife == 0x6d) {
-        return "overflow values";
-    }
-    if ((vife & 0x7a) == 0x6a) {
-        string msg = "date/time of a: ";
-        if (vife & 0x01) msg += "end ";
-        else msg += "beginning ";
-        msg +=" of ";
-        if (vife & 0x04) msg += "last ";
-        else msg += "first ";
-        if (vife & 0x08) msg += "upper ";
-        else msg += "lower ";
-        return msg;
-    }
-    if ((vife & 0x78) == 0x70) {
-        int nnn = vife & 0x07;
-        return "multiplicative correction factor: 10^"+to_string(nnn-6);
-    }
-    if ((vife & 0x78) == 0x78) {
-        int nn = vife & 0x03;
-        return "additive correction constant: unit of VIF * 10^"+to_string(nn-3);
-    }
-    if (vife == 0x7c) {
-        return "extension of combinable vife";
-    }
-    if (vife == 0x7d) {
-        return "multiplicative correction factor for value";
-    }
-    if (vife == 0x7e) {
-        return "future value";
-    }
-    if (vif == 0x7f) {
+    const char *s = vife_table_[vife];
+    if (vif == 0x7f && !strcmp(s, "?")) {
         return "manufacturer specific";
     }
-    return "?";
-}
-
-double toDoubleFromBytes(vector<uchar> &bytes, int len) {
-    double d = 0;
-    for (int i=0; i<len; ++i) {
-        double x = bytes[i];
-        d += x*(256^i);
-    }
-    return d;
-}
-
-double toDoubleFromBCD(vector<uchar> &bytes, int len) {
-    double d = 0;
-    for (int i=0; i<len; ++i) {
-        double x = bytes[i]&0xf;
-        d += x*(10^(i*2));
-        double xx = bytes[i]>>4;
-        d += xx*(10^(1+i*2));
-    }
-    return d;
+    return s;
 }
 
 double dataAsDouble(int dif, int vif, int vife, string data)
@@ -3373,25 +2778,30 @@ double dataAsDouble(int dif, int vif, int vife, string data)
     hex2bin(data, &bytes);
 
     int t = dif & 0x0f;
+    size_t len = difLenBytes(dif);
     switch (t) {
     case 0x0: return 0.0;
-    case 0x1: return toDoubleFromBytes(bytes, 1);
-    case 0x2: return toDoubleFromBytes(bytes, 2);
-    case 0x3: return toDoubleFromBytes(bytes, 3);
-    case 0x4: return toDoubleFromBytes(bytes, 4);
-    case 0x5: return -1;  //  How is REAL stored?
-    case 0x6: return toDoubleFromBytes(bytes, 6);
+    case 0x1:
+    case 0x2:
+    case 0x3:
+    case 0x4:
+    case 0x6:
         // Note that for 64 bit data, storing it into a double might lose precision
         // since the mantissa is less than 64 bit. It is unlikely that anyone
         // really needs true 64 bit precision in their measurements from a physical meter though.
-    case 0x7: return toDoubleFromBytes(bytes, 8);
+    case 0x7:
+        if (bytes.size() < len) return -1;
+        return decodeBinary(&bytes[0], len);
+    case 0x5: return -1;  //  How is REAL stored?
     case 0x8: return -1; // Selection for Readout?
-    case 0x9: return toDoubleFromBCD(bytes, 1);
-    case 0xA: return toDoubleFromBCD(bytes, 2);
-    case 0xB: return toDoubleFromBCD(bytes, 3);
-    case 0xC: return toDoubleFromBCD(bytes, 4);
+    case 0x9:
+    case 0xA:
+    case 0xB:
+    case 0xC:
+    case 0xE:
+        if (bytes.size() < len) return -1;
+        return decodeBCD(&bytes[0], len);
     case 0xD: return -1; // variable length
-    case 0xE: return toDoubleFromBCD(bytes, 6);
     case 0xF: return -1; // Special Functions
     }
     return -1;
@@ -3399,40 +2809,15 @@ double dataAsDouble(int dif, int vif, int vife, string data)
 
 uint64_t dataAsUint64(int dif, int vif, int vife, string data)
 {
-    vector<uchar> bytes;
-    hex2bin(data, &bytes);
-
-    int t = dif & 0x0f;
-    switch (t) {
-    case 0x0: return 0.0;
-    case 0x1: return toDoubleFromBytes(bytes, 1);
-    case 0x2: return toDoubleFromBytes(bytes, 2);
-    case 0x3: return toDoubleFromBytes(bytes, 3);
-    case 0x4: return toDoubleFromBytes(bytes, 4);
-    case 0x5: return -1;  //  How is REAL stored?
-    case 0x6: return toDoubleFromBytes(bytes, 6);
-        // Note that for 64 bit data, storing it into a double might lose precision
-        // since the mantissa is less than 64 bit. It is unlikely that anyone
-        // really needs true 64 bit precision in their measurements from a physical meter though.
-    case 0x7: return toDoubleFromBytes(bytes, 8);
-    case 0x8: return -1; // Selection for Readout?
-    case 0x9: return toDoubleFromBCD(bytes, 1);
-    case 0xA: return toDoubleFromBCD(bytes, 2);
-    case 0xB: return toDoubleFromBCD(bytes, 3);
-    case 0xC: return toDoubleFromBCD(bytes, 4);
-    case 0xD: return -1; // variable length
-    case 0xE: return toDoubleFromBCD(bytes, 6);
-    case 0xF: return -1; // Special Functions
-    }
-    return -1;
+    return dataAsDouble(dif, vif, vife, data);
 }
 
 string formatData(int dif, int vif, int vife, string data)
 {
     string r;
 
-    int t = vif & 0x7f;
-    if (t >= 0 && t <= 0x77 && !(t >= 0x6c && t<=0x6f)) {
+    const char *unit = vif_table_[vif & 0x7f].unit;
+    if (unit != NULL && unit[0] != 0) {
         // These are vif codes with an understandable key and unit.
         double val = dataAsDouble(dif, vif, vife, data);
         strprintf(r, "%d", val);
@@ -3565,7 +2950,7 @@ string WMBusCommonImplementation::alias()
     return alias_;
 }
 
-void WMBusCommonImplementation::onTelegram(function<bool(AboutTelegram&,vector<uchar>)> cb)
+void WMBusCommonImplementation::onTelegram(function<bool(AboutTelegram&,const vector<uchar>&)> cb)
 {
     telegram_listeners_.push_back(cb);
 }
@@ -3582,13 +2967,14 @@ void setIgnoreDuplicateTelegrams(bool idt)
     ignore_duplicate_telegrams_ = idt;
 }
 
-bool WMBusCommonImplementation::handleTelegram(AboutTelegram &about, vector<uchar> frame)
+bool WMBusCommonImplementation::handleTelegram(AboutTelegram &about, const vector<uchar> &frame)
 {
     bool handled = false;
     last_received_ = time(NULL);
 
-    if (ignore_duplicate_telegrams_ && seen_this_telegram_before(frame))
+    if (ignore_duplicate_telegrams_ && seen_this_telegram_before(frame, last_received_))
     {
+        duplicates_ignored_++;
         verbose("(wmbus) skipping already handled telegram.\n");
         return true;
     }
@@ -3605,6 +2991,11 @@ bool WMBusCommonImplementation::handleTelegram(AboutTelegram &about, vector<ucha
     return handled;
 }
 
+size_t WMBusCommonImplementation::numDuplicatesIgnored()
+{
+    return duplicates_ignored_;
+}
+
 void WMBusCommonImplementation::protocolErrorDetected()
 {
     protocol_error_count_++;
@@ -4051,7 +3442,9 @@ bool trimCRCsFrameFormatA(std::vector<uchar> &payload)
     size_t len = payload.size();
     debugPayload("(wmbus) trimming frame A", payload);
 
-    vector<uchar> out;
+    // The crcs are removed in place, the data blocks are moved down
+    // over the crcs and out is the size of the trimmed payload so far.
+    size_t out = 0;
 
     uint16_t calc_crc = crc16_EN13757(&payload[0], 10);
     uint16_t check_crc = payload[10] << 8 | payload[11];
@@ -4061,7 +3454,7 @@ bool trimCRCsFrameFormatA(std::vector<uchar> &payload)
         debug("(wmbus) ff a dll crc first (calculated %04x) did not match (expected %04x) for bytes 0-%zu!\n", calc_crc, check_crc, 10);
         return false;
     }
-    out.insert(out.end(), payload.begin(), payload.begin()+10);
+    out = 10;
     debug("(wmbus) ff a dll crc 0-%zu %04x ok\n", 10-1, calc_crc);
 
     size_t pos = 12;
@@ -4076,7 +3469,8 @@ bool trimCRCsFrameFormatA(std::vector<uchar> &payload)
                   calc_crc, check_crc, pos, to-1);
             return false;
         }
-        out.insert(out.end(), payload.begin()+pos, payload.begin()+pos+16);
+        memmove(&payload[out], &payload[pos], 16);
+        out += 16;
         debug("(wmbus) ff a dll crc mid %zu-%zu %04x ok\n", pos, to-1, calc_crc);
     }
 
@@ -4092,17 +3486,16 @@ bool trimCRCsFrameFormatA(std::vector<uchar> &payload)
                   calc_crc, check_crc, pos, tto-1);
             return false;
         }
-        out.insert(out.end(), payload.begin()+pos, payload.begin()+tto);
+        memmove(&payload[out], &payload[pos], blen);
+        out += blen;
         debug("(wmbus) ff a dll crc final %zu-%zu %04x ok\n", pos, tto-1, calc_crc);
     }
 
-    out[0] = out.size()-1;
-    size_t new_len = out[0]+1;
-    size_t old_size = payload.size();
-    payload = out;
-    size_t new_size = payload.size();
+    payload.resize(out);
+    payload[0] = out-1;
+    size_t new_len = payload[0]+1;
 
-    debug("(wmbus) trimmed %zu crc bytes from frame a and ignored %zu suffix bytes.\n", (len-new_len), (old_size-new_size)-(len-new_len));
+    debug("(wmbus) trimmed %zu crc bytes from frame a and ignored %zu suffix bytes.\n", (len-new_len), (len-out)-(len-new_len));
     debugPayload("(wmbus) trimmed  frame A", payload);
 
     return true;
@@ -4117,7 +3510,6 @@ bool trimCRCsFrameFormatB(std::vector<uchar> &payload)
     size_t len = payload.size();
     debugPayload("(wmbus) trimming frame B", payload);
 
-    vector<uchar> out;
     size_t crc1_pos, crc2_pos;
     if (len <= 128)
     {
@@ -4139,12 +3531,14 @@ bool trimCRCsFrameFormatB(std::vector<uchar> &payload)
         return false;
     }
 
-    out.insert(out.end(), payload.begin(), payload.begin()+crc1_pos);
+    // The first block stays where it is, only the second block is moved down over the first crc.
+    size_t out = crc1_pos;
     debug("(wmbus) ff b dll crc first 0-%zu %04x ok\n", crc1_pos, calc_crc);
 
     if (crc2_pos > 0)
     {
-        calc_crc = crc16_EN13757(&payload[crc1_pos+2], crc2_pos);
+        size_t blen = crc2_pos-(crc1_pos+2);
+        calc_crc = crc16_EN13757(&payload[crc1_pos+2], blen);
         check_crc = payload[crc2_pos] << 8 | payload[crc2_pos+1];
 
         if (calc_crc != check_crc)
@@ -4154,17 +3548,16 @@ bool trimCRCsFrameFormatB(std::vector<uchar> &payload)
             return false;
         }
 
-        out.insert(out.end(), payload.begin()+crc1_pos+2, payload.begin()+crc2_pos);
+        memmove(&payload[out], &payload[crc1_pos+2], blen);
+        out += blen;
         debug("(wmbus) ff b dll crc final %zu-%zu %04x ok\n", crc1_pos+2, crc2_pos, calc_crc);
     }
 
-    out[0] = out.size()-1;
-    size_t new_len = out[0]+1;
-    size_t old_size = payload.size();
-    payload = out;
-    size_t new_size = payload.size();
+    payload.resize(out);
+    payload[0] = out-1;
+    size_t new_len = payload[0]+1;
 
-    debug("(wmbus) trimmed %zu crc bytes from frame b and ignored %zu suffix bytes.\n", (len-new_len), (old_size-new_size)-(len-new_len));
+    debug("(wmbus) trimmed %zu crc bytes from frame b and ignored %zu suffix bytes.\n", (len-new_len), (len-out)-(len-new_len));
     debugPayload("(wmbus) trimmed  frame B", payload);
 
     return true;
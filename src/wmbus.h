@@ -18,6 +18,7 @@
 #ifndef WMBUS_H
 #define WMBUS_H
 
+#include"aescmac.h"
 #include"manufacturers.h"
 #include"serial.h"
 #include"util.h"
@@ -57,6 +58,10 @@ const char *toLowerCaseString(WMBusDeviceType t);
 WMBusDeviceType toWMBusDeviceType(string &t);
 
 void setIgnoreDuplicateTelegrams(bool idt);
+// A telegram identical to one received, by any bus device, within this many seconds is a duplicate.
+void setDuplicateTelegramsWindow(int seconds);
+// Return true if the frame is a duplicate, otherwise remember it as received now.
+bool seen_this_telegram_before(const vector<uchar> &frame, time_t now);
 
 // In link mode S1, is used when both the transmitter and receiver are stationary.
 // It can be transmitted relatively seldom.
@@ -304,15 +309,65 @@ struct DVEntry
     int storagenr {};
     int tariff {};
     int subunit {};
-    string value;
+    // The dif and vif bytes of the key, valid if has_difvif is set.
+    bool has_difvif {};
+    uchar dif {};
+    uchar vif {};
 
     DVEntry() {}
-    DVEntry(MeasurementType mt, int vi, int st, int ta, int su, string &val) :
-    type(mt), value_information(vi), storagenr(st), tariff(ta), subunit(su), value(val) {}
+    // The value is a view into the telegram frame the entry was parsed from,
+    // it is only valid as long as that frame is neither modified nor freed.
+    DVEntry(MeasurementType mt, int vi, int st, int ta, int su, uchar di, uchar vf,
+            const uchar *data, size_t len) :
+    type(mt), value_information(vi), storagenr(st), tariff(ta), subunit(su),
+    has_difvif(true), dif(di), vif(vf), data_(data), len_(len) {}
+    // Drivers that decode vendor specific data supply the value as a hex string.
+    DVEntry(MeasurementType mt, int vi, int st, int ta, int su, string &val);
+
+    const uchar *bytes() const { return owned_.size() > 0 ? &owned_[0] : data_; }
+    size_t length() const { return owned_.size() > 0 ? owned_.size() : len_; }
+    // The value as a hex string.
+    string value() const;
+
+private:
+    const uchar *data_ {};
+    size_t len_ {};
+    vector<uchar> owned_;
 };
 
 using namespace std;
 
+// An index over the parsed dv entries of a telegram, sorted on the value information,
+// so that findKey does not have to scan all entries for every field a driver looks up.
+struct DVIndex
+{
+    // Index all the values, replacing what was indexed before.
+    void rebuild(const std::map<std::string,std::pair<int,DVEntry>> &values);
+    // Find the first key, in the order of the keys, that matches.
+    bool find(MeasurementType mt, int vi_low, int vi_high, int storagenr, int tariffnr, string *key);
+
+private:
+    struct Entry
+    {
+        int value_information;
+        const string *key;
+        const DVEntry *entry;
+    };
+    vector<Entry> entries_;
+    bool sorted_ = true;
+};
+
+// The ephemeral keys Kenc and Kmac that the kdf derives from the
+// confidentiality key, the counter and the meter id (security mode 7).
+struct DerivedKeys
+{
+    uchar input[16]; // The kdf input for Kenc, Kmac uses the same input with DC=0x01.
+    uchar kenc[16];
+    uchar kmac[16];
+    AESRoundKeys kenc_rk;
+    AESCMACKey kmac_ck;
+};
+
 struct MeterKeys
 {
     vector<uchar> confidentiality_key;
@@ -320,6 +375,23 @@ struct MeterKeys
 
     bool hasConfidentialityKey() { return confidentiality_key.size() > 0; }
     bool hasAuthenticationKey() { return authentication_key.size() > 0; }
+
+    // The confidentiality key expanded for aes and cmac, or NULL if the key is not 16 bytes.
+    // The expansion is reused for every telegram and redone only when the key has changed.
+    const AESCMACKey *confidentialityKey();
+    // Run the kdf for this input (DC=0x00), the keys derived for the last input are remembered.
+    // Returns NULL if there is no confidentiality key.
+    const DerivedKeys *deriveKeys(const uchar *input);
+
+    // Diehl real data: the index of the LFSR key that decoded the last telegram, it is tried first.
+    size_t diehl_last_good_key {};
+
+private:
+    bool expanded_ {};
+    uchar expanded_from_[16] {};
+    AESCMACKey expanded_key_ {};
+    bool derived_ {};
+    DerivedKeys derived_keys_ {};
 };
 
 enum class FrameType
@@ -348,6 +420,12 @@ struct AboutTelegram
 
 struct Telegram
 {
+    Telegram() {}
+    // The parsed values are views into the frame and the index points into the values,
+    // a copy would point into the original telegram. Parse the frame again instead.
+    Telegram(const Telegram &) = delete;
+    Telegram &operator=(const Telegram &) = delete;
+
     AboutTelegram about;
 
     // If a warning is printed mark this.
@@ -433,8 +511,7 @@ struct Telegram
     int tpl_num_encr_blocks {};
     int tpl_cfg_ext {}; // 1 byte
     int tpl_kdf_selection {}; // 1 byte
-    vector<uchar> tpl_generated_key; // 16 bytes
-    vector<uchar> tpl_generated_mac_key; // 16 bytes
+    const DerivedKeys *tpl_generated_keys {}; // Kenc and Kmac, owned by the meter keys.
 
     bool  tpl_id_found {}; // If set to true, then tpl_id_b contains valid values.
     vector<uchar> tpl_a; // A field 6 bytes
@@ -459,17 +536,17 @@ struct Telegram
 
     bool handled {}; // Set to true, when a meter has accepted the telegram.
 
-    bool parseHeader(vector<uchar> &input_frame);
-    bool parse(vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+    bool parseHeader(const vector<uchar> &input_frame);
+    bool parse(const vector<uchar> &input_frame, MeterKeys *mk, bool warn);
 
-    bool parseMBUSHeader(vector<uchar> &input_frame);
-    bool parseMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+    bool parseMBUSHeader(const vector<uchar> &input_frame);
+    bool parseMBUS(const vector<uchar> &input_frame, MeterKeys *mk, bool warn);
 
-    bool parseWMBUSHeader(vector<uchar> &input_frame);
-    bool parseWMBUS(vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+    bool parseWMBUSHeader(const vector<uchar> &input_frame);
+    bool parseWMBUS(const vector<uchar> &input_frame, MeterKeys *mk, bool warn);
 
-    bool parseHANHeader(vector<uchar> &input_frame);
-    bool parseHAN(vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+    bool parseHANHeader(const vector<uchar> &input_frame);
+    bool parseHAN(const vector<uchar> &input_frame, MeterKeys *mk, bool warn);
 
     void print();
 
@@ -479,14 +556,20 @@ struct Telegram
     void addExplanationAndIncrementPos(vector<uchar>::iterator &pos, int len, const char* fmt, ...);
     void addMoreExplanation(int pos, const char* fmt, ...);
     void explainParse(string intro, int from);
+    // Explanations are only recorded when enabled for this parse, since
+    // formatting them for every field of every telegram is expensive.
+    void enableExplanations(bool e) { explain_ = e; }
+    bool explanationsEnabled() const { return explain_; }
 
-    bool isSimulated() { return is_simulated_; }
+    bool isSimulated() const { return is_simulated_; }
     void markAsSimulated() { is_simulated_ = true; }
 
     // Extracted mbus values.
     std::map<std::string,std::pair<int,DVEntry>> values;
+    // Index over the values, used by findKey.
+    DVIndex dv_index;
 
-    string autoDetectPossibleDrivers();
+    string autoDetectPossibleDrivers() const;
 
     // part of original telegram bytes, only filled if pre-processing modifies it
     vector<uchar> original;
@@ -495,6 +578,7 @@ private:
 
     bool is_simulated_ {};
     bool parser_warns_ = true;
+    bool explain_ {};
     MeterKeys *meter_keys {};
 
     // Fixes quirks from non-compliant meters to make telegram compatible with the standard
@@ -532,7 +616,7 @@ private:
                   std::vector<uchar>::iterator from,
                   std::vector<uchar>::iterator to,
                   std::vector<uchar> &mac,
-                  std::vector<uchar> &mackey);
+                  const AESCMACKey *mackey);
     bool findFormatBytesFromKnownMeterSignatures(std::vector<uchar> *format_bytes);
 };
 
@@ -568,7 +652,7 @@ struct WMBus
     virtual int numConcurrentLinkModes() = 0;
     virtual bool canSetLinkModes(LinkModeSet lms) = 0;
     virtual void setLinkModes(LinkModeSet lms) = 0;
-    virtual void onTelegram(function<bool(AboutTelegram&,vector<uchar>)> cb) = 0;
+    virtual void onTelegram(function<bool(AboutTelegram&,const vector<uchar>&)> cb) = 0;
     virtual void sendTelegram(Telegram *t) = 0;
     virtual SerialDevice *serial() = 0;
     // Return true of the serial has been overridden, usually with stdin or a file.
@@ -593,6 +677,8 @@ struct WMBus
     // Remember how this device was detected.
     virtual void setDetected(Detected detected) = 0;
     virtual Detected *getDetected() = 0;
+    // The number of telegrams from this device that were ignored as duplicates.
+    virtual size_t numDuplicatesIgnored() = 0;
     virtual ~WMBus() = 0;
 };
 
@@ -639,8 +725,17 @@ shared_ptr<WMBus> openSimulator(Detected detected,
                                 shared_ptr<SerialCommunicationManager> manager,
                                 shared_ptr<SerialDevice> serial_override);
 
-string manufacturer(int m_field);
-string manufacturerFlag(int m_field);
+// The three letter flag is returned by value, to avoid allocating
+// a string every time a telegram is printed.
+struct ManufacturerFlag
+{
+    char flag[4];
+    const char *c_str() const { return flag; }
+    operator string() const { return flag; }
+};
+
+const char *manufacturer(int m_field);
+ManufacturerFlag manufacturerFlag(int m_field);
 string mediaType(int a_field_device_type, int m_field);
 string mediaTypeJSON(int a_field_device_type, int m_field);
 bool isCiFieldOfType(int ci_field, CI_TYPE type);
@@ -650,10 +745,10 @@ string cType(int c_field);
 string ccType(int cc_field);
 string difType(int dif);
 double vifScale(int vif);
-string vifKey(int vif); // E.g. temperature energy power mass_flow volume_flow
-string vifUnit(int vif); // E.g. m3 c kwh kw MJ MJh
-string vifType(int vif); // Long description
-string vifeType(int dif, int vif, int vife); // Long description
+const char *vifKey(int vif); // E.g. temperature energy power mass_flow volume_flow
+const char *vifUnit(int vif); // E.g. m3 c kwh kw MJ MJh
+const char *vifType(int vif); // Long description
+const char *vifeType(int dif, int vif, int vife); // Long description
 string formatData(int dif, int vif, int vife, string data);
 
 // Decode the status byte in the TPL with a map that gives the
@@ -713,7 +808,7 @@ Detected detectWMBusDeviceOnTTY(string tty,
                                 shared_ptr<SerialCommunicationManager> handler);
 
 // Remember meters id/mfct/ver/type combos that we should only warn once for.
-bool warned_for_telegram_before(Telegram *t, vector<uchar> &dll_a);
+bool warned_for_telegram_before(bool *triggered_warning, const vector<uchar> &dll_a);
 
 ////////////////// MBUS
 
@@ -35,9 +35,9 @@ struct WMBusCommonImplementation : public virtual WMBus
     string hr();
     bool isSerial();
     WMBusDeviceType type();
-    void onTelegram(function<bool(AboutTelegram&,vector<uchar>)> cb);
+    void onTelegram(function<bool(AboutTelegram&,const vector<uchar>&)> cb);
     void sendTelegram(Telegram *t);
-    bool handleTelegram(AboutTelegram &about, vector<uchar> frame);
+    bool handleTelegram(AboutTelegram &about, const vector<uchar> &frame);
     void checkStatus();
     bool isWorking();
     string dongleId();
@@ -59,6 +59,7 @@ struct WMBusCommonImplementation : public virtual WMBus
     void close();
     void setDetected(Detected detected) { detected_ = detected; }
     Detected *getDetected() { return &detected_; }
+    size_t numDuplicatesIgnored();
     void markAsNoLongerSerial();
 
     protected:
@@ -81,9 +82,10 @@ struct WMBusCommonImplementation : public virtual WMBus
     // Uses a serial tty?
     bool is_serial_ {};
     bool is_working_ {};
-    vector<function<bool(AboutTelegram&,vector<uchar>)>> telegram_listeners_;
+    vector<function<bool(AboutTelegram&,const vector<uchar>&)>> telegram_listeners_;
     WMBusDeviceType type_ {};
     int protocol_error_count_ {};
+    size_t duplicates_ignored_ {};
     time_t timeout_ {}; // If longer silence than timeout, then reset dongle! It might have hanged!
     string expected_activity_ {}; // During which times should we care about timeouts?
     time_t last_received_ {}; // When as the last telegram reception?
@@ -23,15 +23,18 @@
 #include<assert.h>
 #include<memory.h>
 
-bool decrypt_ELL_AES_CTR(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, vector<uchar> &aeskey)
+bool decrypt_ELL_AES_CTR(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, const AESRoundKeys *aeskey)
 {
-    if (aeskey.size() == 0) return true;
+    if (aeskey == NULL) return true;
 
-    vector<uchar> encrypted_bytes;
-    vector<uchar> decrypted_bytes;
-    encrypted_bytes.insert(encrypted_bytes.end(), pos, frame.end());
-    frame.erase(pos, frame.end());
-    debugPayload("(ELL) decrypting", encrypted_bytes);
+    // The payload is decrypted in place, CTR mode only xors the bytes.
+    uchar *data = frame.data() + (pos - frame.begin());
+    size_t data_len = frame.end() - pos;
+    if (isDebugEnabled())
+    {
+        vector<uchar> encrypted_bytes(pos, frame.end());
+        debugPayload("(ELL) decrypting", encrypted_bytes);
+    }
 
     uchar iv[16];
     int i=0;
@@ -48,41 +51,26 @@ bool decrypt_ELL_AES_CTR(Telegram *t, vector<uchar> &frame, vector<uchar>::itera
     // BC
     iv[i++] = 0;
 
-    vector<uchar> ivv(iv, iv+16);
-    string s = bin2hex(ivv);
-    debug("(ELL) IV %s\n", s.c_str());
-
-    int block = 0;
-    for (size_t offset = 0; offset < encrypted_bytes.size(); offset += 16)
+    if (isDebugEnabled())
     {
-        size_t block_size = 16;
-        if (offset + block_size > encrypted_bytes.size())
+        vector<uchar> ivv(iv, iv+16);
+        string s = bin2hex(ivv);
+        debug("(ELL) IV %s\n", s.c_str());
+        for (size_t offset = 0, block = 0; offset < data_len; offset += 16, ++block)
         {
-            block_size = encrypted_bytes.size() - offset;
+            size_t block_size = data_len-offset < 16 ? data_len-offset : 16;
+            debug("(ELL) block %zu block_size %zu offset %zu\n", block, block_size, offset);
         }
+    }
 
-        assert(block_size > 0 && block_size <= 16);
-
-        // Generate the pseudo-random bits from the IV and the key.
-        uchar xordata[16];
-        AES_ECB_encrypt(iv, &aeskey[0], xordata, 16);
-
-        // Xor the data with the pseudo-random bits to decrypt into tmp.
-        uchar tmp[block_size];
-        xorit(xordata, &encrypted_bytes[offset], tmp, block_size);
-
-        debug("(ELL) block %d block_size %d offset %zu\n", block, block_size, offset);
-        block++;
-
-        vector<uchar> tmpv(tmp, tmp+block_size);
-        debugPayload("(ELL) decrypted", tmpv);
-
-        decrypted_bytes.insert(decrypted_bytes.end(), tmpv.begin(), tmpv.end());
+    // The keystream for all blocks is generated in batches and xored into the payload.
+    AES_CTR_xcrypt(aeskey, iv, data, data_len);
 
-        incrementIV(iv, sizeof(iv));
+    if (isDebugEnabled())
+    {
+        vector<uchar> decrypted_bytes(pos, frame.end());
+        debugPayload("(ELL) decrypted", decrypted_bytes);
     }
-    debugPayload("(ELL) decrypted", decrypted_bytes);
-    frame.insert(frame.end(), decrypted_bytes.begin(), decrypted_bytes.end());
     return true;
 }
 
@@ -92,16 +80,19 @@ string frameTypeKamstrupC1(int ft) {
     return "?";
 }
 
-bool decrypt_TPL_AES_CBC_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, vector<uchar> &aeskey)
+bool decrypt_TPL_AES_CBC_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, const AESRoundKeys *aeskey)
 {
-    if (aeskey.size() == 0) return true;
+    if (aeskey == NULL) return true;
 
-    vector<uchar> buffer;
-    buffer.insert(buffer.end(), pos, frame.end());
-    frame.erase(pos, frame.end());
-    debugPayload("(TPL) decrypting", buffer);
+    uchar *data = frame.data() + (pos - frame.begin());
+    size_t buffer_size = frame.end() - pos;
+    if (isDebugEnabled())
+    {
+        vector<uchar> buffer(pos, frame.end());
+        debugPayload("(TPL) decrypting", buffer);
+    }
 
-    size_t len = buffer.size();
+    size_t len = buffer_size;
 
     if (t->tpl_num_encr_blocks)
     {
@@ -109,7 +100,7 @@ bool decrypt_TPL_AES_CBC_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::it
     }
 
     debug("(TPL) num encrypted blocks %d (%d bytes and remaining unencrypted %d bytes)\n",
-          t->tpl_num_encr_blocks, len, buffer.size()-len);
+          t->tpl_num_encr_blocks, len, buffer_size-len);
 
     // The content should be a multiple of 16 since we are using AES CBC mode.
     if (len % 16 != 0)
@@ -144,36 +135,34 @@ bool decrypt_TPL_AES_CBC_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::it
     // ACC
     for (int j=0; j<8; ++j) { iv[i++] = t->tpl_acc; }
 
-    vector<uchar> ivv(iv, iv+16);
-    string s = bin2hex(ivv);
-    debug("(TPL) IV %s\n", s.c_str());
+    if (isDebugEnabled())
+    {
+        vector<uchar> ivv(iv, iv+16);
+        string s = bin2hex(ivv);
+        debug("(TPL) IV %s\n", s.c_str());
+    }
 
-    uchar buffer_data[buffer.size()];
-    memcpy(buffer_data, &buffer[0], buffer.size());
-    uchar decrypted_data[buffer.size()];
-    AES_CBC_decrypt_buffer(decrypted_data, buffer_data, len, &aeskey[0], iv);
+    // Decrypt in place, the unencrypted bytes after len stay as they are.
+    if (len > buffer_size) len = buffer_size - buffer_size % 16;
+    AES_CBC_decrypt_in_place(aeskey, data, len, iv);
 
-    frame.insert(frame.end(), decrypted_data, decrypted_data+len);
     debugPayload("(TPL) decrypted ", frame, pos);
-
-    if (len < buffer.size())
-    {
-        frame.insert(frame.end(), buffer_data+len, buffer_data+buffer.size());
-        debugPayload("(TPL) appended  ", frame, pos);
-    }
     return true;
 }
 
-bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, vector<uchar> &aeskey)
+bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, vector<uchar> &frame, vector<uchar>::iterator &pos, const AESRoundKeys *aeskey)
 {
-    if (aeskey.size() == 0) return true;
+    if (aeskey == NULL) return true;
 
-    vector<uchar> buffer;
-    buffer.insert(buffer.end(), pos, frame.end());
-    frame.erase(pos, frame.end());
-    debugPayload("(TPL) decrypting", buffer);
+    uchar *data = frame.data() + (pos - frame.begin());
+    size_t buffer_size = frame.end() - pos;
+    if (isDebugEnabled())
+    {
+        vector<uchar> buffer(pos, frame.end());
+        debugPayload("(TPL) decrypting", buffer);
+    }
 
-    size_t len = buffer.size();
+    size_t len = buffer_size;
 
     if (t->tpl_num_encr_blocks)
     {
@@ -181,7 +170,7 @@ bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, vector<uchar> &frame, vector<uchar>:
     }
 
     debug("(TPL) num encrypted blocks %d (%d bytes and remaining unencrypted %d bytes)\n",
-          t->tpl_num_encr_blocks, len, buffer.size()-len);
+          t->tpl_num_encr_blocks, len, buffer_size-len);
 
     // The content should be a multiple of 16 since we are using AES CBC mode.
     if (len % 16 != 0)
@@ -196,21 +185,44 @@ bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, vector<uchar> &frame, vector<uchar>:
     uchar iv[16];
     memset(iv, 0, sizeof(iv));
 
-    vector<uchar> ivv(iv, iv+16);
-    string s = bin2hex(ivv);
-    debug("(TPL) IV %s\n", s.c_str());
+    if (isDebugEnabled())
+    {
+        vector<uchar> ivv(iv, iv+16);
+        string s = bin2hex(ivv);
+        debug("(TPL) IV %s\n", s.c_str());
+    }
 
-    uchar buffer_data[buffer.size()];
-    memcpy(buffer_data, &buffer[0], buffer.size());
-    uchar decrypted_data[buffer.size()];
-    AES_CBC_decrypt_buffer(decrypted_data, buffer_data, buffer.size(), &aeskey[0], iv);
+    // The unencrypted tail is appended after the decrypted bytes, keep a copy of it.
+    vector<uchar> tail;
+    if (len < buffer_size)
+    {
+        tail.assign(data+len, data+buffer_size);
+    }
 
-    frame.insert(frame.end(), decrypted_data, decrypted_data+buffer.size());
+    // Decrypt the full blocks in place. A trailing partial block is decrypted
+    // as if it was padded with zeros and xored with the previous cipher block.
+    size_t full = buffer_size - buffer_size % 16;
+    size_t extra = buffer_size % 16;
+    uchar prev[16];
+    memcpy(prev, full >= 16 ? data+full-16 : iv, 16);
+    AES_CBC_decrypt_in_place(aeskey, data, full, iv);
+    if (extra)
+    {
+        uchar block[16];
+        memset(block, 0, sizeof(block));
+        memcpy(block, data+full, extra);
+        aesBackend()->decryptBlock(aeskey, block, block);
+        xorit(prev, block, block, extra);
+        memcpy(data+full, block, extra);
+    }
     debugPayload("(TPL) decrypted ", frame, pos);
 
-    if (len < buffer.size())
+    if (len < buffer_size)
     {
-        frame.insert(frame.end(), buffer_data+len, buffer_data+buffer.size());
+        // Keep the unencrypted tail after the decrypted bytes, as before.
+        size_t offset = pos - frame.begin();
+        frame.insert(frame.end(), tail.begin(), tail.end());
+        pos = frame.begin()+offset;
         debugPayload("(TPL) appended  ", frame, pos);
     }
 
@@ -36,6 +36,9 @@ if [ "$?" != "0" ]; then RC="1"; fi
 tests/test_aes.sh $PROG
 if [ "$?" != "0" ]; then RC="1"; fi
 
+tests/test_decode_threads.sh $PROG
+if [ "$?" != "0" ]; then RC="1"; fi
+
 tests/test_key_warnings.sh $PROG
 if [ "$?" != "0" ]; then RC="1"; fi
 
@@ -45,6 +48,9 @@ if [ "$?" != "0" ]; then RC="1"; fi
 tests/test_shell2.sh $PROG
 if [ "$?" != "0" ]; then RC="1"; fi
 
+tests/test_pipe_shell.sh $PROG
+if [ "$?" != "0" ]; then RC="1"; fi
+
 tests/test_meterfiles.sh $PROG
 if [ "$?" != "0" ]; then RC="1"; fi
 
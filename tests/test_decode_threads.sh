@@ -0,0 +1,84 @@
+#!/bin/sh
+
+PROG="$1"
+
+mkdir -p testoutput
+
+TEST=testoutput
+
+TESTNAME="Test decode threads"
+TESTRESULT="ERROR"
+
+# The meters are decoded in parallel, only the order for each meter is kept.
+cat simulations/simulation_c1.txt | grep '^{' | grep -v 00012811 | sort > $TEST/test_expected.txt
+$PROG --format=json --decodethreads=4 simulations/simulation_c1.txt \
+      MyHeater multical302 67676767 NOKEY \
+      MyTapWater multical21 76348799 NOKEY \
+      MyWater flowiq2200 52525252 NOKEY \
+      Vadden multical21 44556677 NOKEY \
+      MyElement qcaloric 78563412 NOKEY \
+      Rum cma12w 66666666 NOKEY \
+      My403Cooling multical403 78780102 NOKEY \
+      Heat multical603 36363636 NOKEY \
+      Heater multical803 80808081 NOKEY \
+      myomnipower omnipower 32666857 NOKEY \
+      Vatten weh_07 86868686 NOKEY \
+      > $TEST/test_output.txt 2> $TEST/test_stderr.txt
+
+if [ "$?" = "0" ]
+then
+    cat $TEST/test_output.txt | sed 's/"timestamp":"....-..-..T..:..:..Z"/"timestamp":"1111-11-11T11:11:11Z"/' | sort > $TEST/test_responses.txt
+    diff $TEST/test_expected.txt $TEST/test_responses.txt
+    if [ "$?" = "0" ]
+    then
+        echo OK: $TESTNAME
+        TESTRESULT="OK"
+    fi
+else
+    echo "wmbusmeters returned error code: $?"
+    cat $TEST/test_output.txt
+    cat $TEST/test_stderr.txt
+fi
+
+if [ "$TESTRESULT" = "ERROR" ]
+then
+    echo ERROR: $TESTNAME
+    exit 1
+fi
+
+TESTNAME="Test decode threads with oneshot and a wildcard template"
+TESTRESULT="ERROR"
+
+# A meter created from the template prints its update while another decode thread
+# prints and checks if all meters have been updated. This must not deadlock.
+RC="0"
+for i in 1 2 3 4 5
+do
+    timeout 20 $PROG --format=json --decodethreads=4 --oneshot --verbose simulations/simulation_c1.txt \
+            Many auto '*' NOKEY \
+            > $TEST/test_output.txt 2> $TEST/test_stderr.txt
+    if [ "$?" != "0" ]
+    then
+        RC="1"
+        break
+    fi
+done
+
+if [ "$RC" = "0" ]
+then
+    RES=$(cat $TEST/test_stderr.txt | grep -o "(main) all meters have received at least one update, stopping." | tail -n 1)
+    if [ "$RES" = "(main) all meters have received at least one update, stopping." ]
+    then
+        echo OK: $TESTNAME
+        TESTRESULT="OK"
+    fi
+else
+    echo "wmbusmeters hung or returned an error"
+    cat $TEST/test_stderr.txt
+fi
+
+if [ "$TESTRESULT" = "ERROR" ]
+then
+    echo ERROR: $TESTNAME
+    exit 1
+fi
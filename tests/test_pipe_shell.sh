@@ -0,0 +1,34 @@
+#!/bin/sh
+
+PROG="$1"
+
+mkdir -p testoutput
+TEST=testoutput
+
+TESTNAME="Test pipe shell receiving json lines on stdin"
+TESTRESULT="ERROR"
+
+cat > $TEST/test_expected.txt <<EOF2
+{"media":"warm water","meter":"supercom587","name":"MyWarmWater","id":"12345678","total_m3":5.548,"timestamp":"1111-11-11T11:11:11Z"}
+{"media":"water","meter":"supercom587","name":"MyColdWater","id":"11111111","total_m3":4.989,"timestamp":"1111-11-11T11:11:11Z"}
+EOF2
+
+rm -f $TEST/test_pipe.txt
+$PROG --pipeshell="cat >> $TEST/test_pipe.txt" simulations/simulation_t1.txt \
+      MyWarmWater supercom587 12345678 NOKEY \
+      MyColdWater supercom587 11111111 NOKEY > $TEST/test_output.txt 2> $TEST/test_stderr.txt
+if [ "$?" = "0" ]
+then
+    cat $TEST/test_pipe.txt | sed 's/"timestamp":"....-..-..T..:..:..Z"/"timestamp":"1111-11-11T11:11:11Z"/' > $TEST/test_responses.txt
+    diff $TEST/test_expected.txt $TEST/test_responses.txt
+    if [ "$?" = "0" ]
+    then
+        TESTRESULT="OK"
+    fi
+fi
+
+echo $TESTRESULT: $TESTNAME
+if [ "$TESTRESULT" = "ERROR" ]
+then
+    exit 1
+fi